@@ -2,6 +2,8 @@
 
 pod2man -n bt-adapter -c "bluez-tools" -r "" man/bt-adapter.pod > ../src/bt-adapter.1
 pod2man -n bt-agent -c "bluez-tools" -r "" man/bt-agent.pod > ../src/bt-agent.1
+pod2man -n bt-audit -c "bluez-tools" -r "" man/bt-audit.pod > ../src/bt-audit.1
+pod2man -n bt-daemon -c "bluez-tools" -r "" man/bt-daemon.pod > ../src/bt-daemon.1
 pod2man -n bt-device -c "bluez-tools" -r "" man/bt-device.pod > ../src/bt-device.1
 
 # pod2man -n bt-monitor -c "bluez-tools" -r "" man/bt-monitor.pod > ../src/bt-monitor.1
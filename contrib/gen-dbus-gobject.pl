@@ -23,7 +23,7 @@
 
 use strict;
 
-die "usage: -header|source FILE <hid>\n" unless $ARGV[0] && $ARGV[1] && $ARGV[0] =~ /^-(header|source)$/;
+die "usage: -header|source FILE <hid>\n       -info-header|info-source FILE.xml\n" unless $ARGV[0] && $ARGV[1] && $ARGV[0] =~ /^-(header|source|info-header|info-source)$/;
 
 sub parse_doc_api {
     my ($doc_api_file, $hierarchy_id) = @_;
@@ -606,7 +606,7 @@ static void _{\$object}_set_property(GObject *object, guint property_id, const G
 static void _{\$object}_create_gdbus_proxy({\$Object} *self, const gchar *dbus_service_name, const gchar *dbus_object_path, GError **error)
 {
 	g_assert({\$OBJECT}_IS(self));
-	self->priv->proxy = g_dbus_proxy_new_sync({\$conn}, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, {\$OBJECT}_DBUS_INTERFACE, NULL, error);
+	self->priv->proxy = g_dbus_proxy_new_sync({\$conn}, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, {\$OBJECT}_DBUS_INTERFACE, dbus_call_cancellable(), error);
 
 	if(self->priv->proxy == NULL)
 		return;
@@ -731,11 +731,11 @@ EOT
             "\tg_assert({\$OBJECT}_IS(self));\n";
             
 		if($m{'ret'} eq 'void') {
-			$methods .= "\tg_dbus_proxy_call_sync(self->priv->proxy, \"$method\", ".($in_args eq '' ? "NULL" : generate_g_variant_params($m{'args'})).", G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);\n";
+			$methods .= "\tg_dbus_proxy_call_sync(self->priv->proxy, \"$method\", ".($in_args eq '' ? "NULL" : generate_g_variant_params($m{'args'})).", G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);\n";
 		} else {				
 			$methods .= "\t".(is_const_type($m{'ret'}) eq 1 ? "const " : "").get_g_type($m{'ret'})."ret = ".get_default_value(get_g_type($m{'ret'})).";\n".
-				"\tGVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, \"$method\", ".($in_args eq '' ? "NULL" : generate_g_variant_params($m{'args'})).", G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);\n".
-				"\tif (proxy_ret != NULL)\n".
+				"\tGVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, \"$method\", ".($in_args eq '' ? "NULL" : generate_g_variant_params($m{'args'})).", G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);\n".
+				"\tif (proxy_ret == NULL)\n".
 				"\t\treturn ".get_default_value(get_g_type($m{'ret'})).";\n".
 				"\tproxy_ret = g_variant_get_child_value(proxy_ret, 0);\n";
 				
@@ -989,6 +989,188 @@ EOT
     return $output;
 }
 
+# Objects we export ourselves (agents) are described by introspection XML
+sub parse_introspection_xml {
+    my $xml_file = shift;
+
+    my %data;
+    my $method;
+
+    open INPUT, "<$xml_file" or die "Can't open '$xml_file': $!\n";
+    while(<INPUT>) {
+        if (/<interface name="([^"]+)">/) {
+            die "only one interface per file is supported\n" if defined $data{'intf'};
+            $data{'intf'} = $1;
+            @{$data{'methods'}} = ();
+        } elsif (/<method name="(\w+)"\s*(\/?)>/) {
+            die "invalid file format (1)\n" unless defined $data{'intf'};
+            $method = {name => $1, in => [], out => []};
+            push @{$data{'methods'}}, $method;
+            undef $method if $2 eq '/';
+        } elsif (/<arg name="(\w+)" direction="(in|out)" type="([^"]+)"\s*\/>/) {
+            die "invalid file format (2)\n" unless defined $method;
+            push @{$method->{$2}}, {name => $1, type => $3};
+        } elsif (/<\/method>/) {
+            undef $method;
+        } elsif (/<(signal|property)\b/) {
+            die "$1 is not supported in exported objects\n";
+        }
+    }
+    close INPUT;
+
+    die "invalid file format (3)\n" unless defined $data{'intf'};
+
+    return \%data;
+}
+
+sub get_info_names {
+    my $intf = shift;
+    my $obj = (split /\./, $intf)[-1];
+
+    $obj =~ s/\d+$//;
+    $obj = "Obex".$obj if $intf =~ /obex/i;
+
+    return ($obj, lc join('_', $obj =~ /([A-Z]+[a-z]*)/g), uc join('_', $obj =~ /([A-Z]+[a-z]*)/g));
+}
+
+sub generate_info_header {
+    my $node = shift;
+
+    my $HEADER_TEMPLATE = <<EOT;
+#ifndef __{\$OBJECT}_INTERFACE_H
+#define __{\$OBJECT}_INTERFACE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <gio/gio.h>
+
+/*
+ * Compiled introspection data for {\$intf}, exported by us.
+ * Method calls are dispatched by {\$object}_method_id(), which maps the
+ * invocation's method info back to its index without comparing names.
+ */
+typedef enum {
+{METHOD_IDS}	{\$OBJECT}_N_METHODS
+} {\$Object}MethodId;
+
+GDBusInterfaceInfo *{\$object}_interface_info(void);
+{\$Object}MethodId {\$object}_method_id(GDBusMethodInvocation *invocation);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __{\$OBJECT}_INTERFACE_H */
+EOT
+
+    my ($obj, $obj_lc, $obj_uc) = get_info_names($node->{'intf'});
+
+    my $method_ids = "";
+    for my $m (@{$node->{'methods'}}) {
+        $method_ids .= "\t{\$OBJECT}_METHOD_".(uc join('_', $m->{'name'} =~ /([A-Z]+[a-z]*)/g)).",\n";
+    }
+
+    my $output = "$HEADER\n$HEADER_TEMPLATE";
+    $output =~ s/{METHOD_IDS}/$method_ids/;
+    $output =~ s/{\$intf}/$node->{'intf'}/g;
+    $output =~ s/{\$OBJECT}/$obj_uc/g;
+    $output =~ s/{\$Object}/$obj/g;
+    $output =~ s/{\$object}/$obj_lc/g;
+
+    return $output;
+}
+
+sub generate_info_source {
+    my $node = shift;
+
+    my $SOURCE_TEMPLATE = <<EOT;
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <gio/gio.h>
+
+#include "{\$object}_interface.h"
+
+{ARG_INFOS}static const GDBusMethodInfo _{\$object}_methods[] = {
+{METHOD_INFOS}};
+
+static const GDBusMethodInfo * const _{\$object}_method_pointers[] = {
+{METHOD_POINTERS}	NULL
+};
+
+static const GDBusInterfaceInfo _{\$object}_interface_info = {
+	-1,
+	(gchar *) "{\$intf}",
+	(GDBusMethodInfo **) &_{\$object}_method_pointers,
+	NULL,
+	NULL,
+	NULL
+};
+
+GDBusInterfaceInfo *{\$object}_interface_info(void)
+{
+	return (GDBusInterfaceInfo *) &_{\$object}_interface_info;
+}
+
+{\$Object}MethodId {\$object}_method_id(GDBusMethodInvocation *invocation)
+{
+	const GDBusMethodInfo *info = g_dbus_method_invocation_get_method_info(invocation);
+
+	if (info < _{\$object}_methods || info >= _{\$object}_methods + {\$OBJECT}_N_METHODS)
+		return {\$OBJECT}_N_METHODS;
+	return ({\$Object}MethodId) (info - _{\$object}_methods);
+}
+EOT
+
+    my ($obj, $obj_lc, $obj_uc) = get_info_names($node->{'intf'});
+
+    my $arg_infos = "";
+    my $method_infos = "";
+    my $method_pointers = "";
+    my $n = 0;
+    for my $m (@{$node->{'methods'}}) {
+        my $m_lc = lc join('_', $m->{'name'} =~ /([A-Z]+[a-z]*)/g);
+        my %args_ref = (in => 'NULL', out => 'NULL');
+
+        for my $direction ('in', 'out') {
+            next unless @{$m->{$direction}} > 0;
+            my $pointers = "";
+            for my $arg (@{$m->{$direction}}) {
+                $arg_infos .= "static const GDBusArgInfo _{\$object}_${m_lc}_${direction}_$arg->{'name'} = {-1, (gchar *) \"$arg->{'name'}\", (gchar *) \"$arg->{'type'}\", NULL};\n";
+                $pointers .= "&_{\$object}_${m_lc}_${direction}_$arg->{'name'}, ";
+            }
+            $arg_infos .= "static const GDBusArgInfo * const _{\$object}_${m_lc}_${direction}_args[] = {${pointers}NULL};\n\n";
+            $args_ref{$direction} = "(GDBusArgInfo **) &_{\$object}_${m_lc}_${direction}_args";
+        }
+
+        $method_infos .= "\t{-1, (gchar *) \"$m->{'name'}\", $args_ref{'in'}, $args_ref{'out'}, NULL},\n";
+        $method_pointers .= "\t&_{\$object}_methods[$n],\n";
+        $n++;
+    }
+
+    my $output = "$HEADER\n$SOURCE_TEMPLATE";
+    $output =~ s/{ARG_INFOS}/$arg_infos/;
+    $output =~ s/{METHOD_INFOS}/$method_infos/;
+    $output =~ s/{METHOD_POINTERS}/$method_pointers/;
+    $output =~ s/{\$intf}/$node->{'intf'}/g;
+    $output =~ s/{\$OBJECT}/$obj_uc/g;
+    $output =~ s/{\$Object}/$obj/g;
+    $output =~ s/{\$object}/$obj_lc/g;
+
+    return $output;
+}
+
+if ($ARGV[0] =~ /^-info-/) {
+    my $info = parse_introspection_xml($ARGV[1]);
+
+    print generate_info_header($info) if $ARGV[0] eq '-info-header';
+    print generate_info_source($info) if $ARGV[0] eq '-info-source';
+    exit 0;
+}
+
 my $data = parse_doc_api($ARGV[1], $ARGV[2]);
 
 print generate_header($data) if $ARGV[0] eq '-header';
@@ -18,6 +18,11 @@ echo "Generating agent manager header"
 echo "Generating agent manager source"
 ./gen-dbus-gobject.pl -source bluez-api-${API_VERSION}/agent-api.txt 1 > out/agent_manager.c
 
+echo "Generating agent interface info header"
+./gen-dbus-gobject.pl -info-header bluez-api-${API_VERSION}/agent.xml > out/agent_interface.h
+echo "Generating agent interface info source"
+./gen-dbus-gobject.pl -info-source bluez-api-${API_VERSION}/agent.xml > out/agent_interface.c
+
 # echo "Generating agent header"
 # ./gen-dbus-gobject.pl -header bluez-api-${API_VERSION}/agent-api.txt 2 > out/agent.h
 # echo "Generating agent source"
@@ -149,6 +154,11 @@ echo "Generating obex agent manager header"
 echo "Generating obex agent manager source"
 ./gen-dbus-gobject.pl -source bluez-api-${API_VERSION}/obex-agent-api.txt 1 > out/obex/obex_agent_manager.c
 
+echo "Generating obex agent interface info header"
+./gen-dbus-gobject.pl -info-header bluez-api-${API_VERSION}/obex_agent.xml > out/obex/obex_agent_interface.h
+echo "Generating obex agent interface info source"
+./gen-dbus-gobject.pl -info-source bluez-api-${API_VERSION}/obex_agent.xml > out/obex/obex_agent_interface.c
+
 # echo "Generating obex agent header"
 # ./gen-dbus-gobject.pl -header bluez-api-${API_VERSION}/obex-agent-api.txt 2 > out/obex/obex_agent.h
 # echo "Generating obex agent source"
@@ -19,6 +19,9 @@
 #include "lib/dbus-common.h"
 #include "lib/bluez-api.h"
 #include "lib/helpers.h"
+#include "lib/commands.h"
+#include "lib/command-socket.h"
+#include "lib/batch.h"
 
 static void _adapter_property_changed(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
 {
@@ -78,6 +81,8 @@ static gboolean discover_arg = FALSE;
 static gboolean set_arg = FALSE;
 static gchar *set_property_arg = NULL;
 static gchar *set_value_arg = NULL;
+static gchar *batch_arg = NULL;
+static gchar *timeout_arg = NULL;
 
 static GOptionEntry entries[] = {
     {"list", 'l', 0, G_OPTION_ARG_NONE, &list_arg, "List all available adapters", NULL},
@@ -85,6 +90,8 @@ static GOptionEntry entries[] = {
     {"info", 'i', 0, G_OPTION_ARG_NONE, &info_arg, "Show adapter info", NULL},
     {"discover", 'd', 0, G_OPTION_ARG_NONE, &discover_arg, "Discover remote devices", NULL},
     {"set", 's', 0, G_OPTION_ARG_NONE, &set_arg, "Set adapter property", NULL},
+    {"batch", 0, 0, G_OPTION_ARG_FILENAME, &batch_arg, "Read commands from a file (- for stdin)", "<file|->"},
+    {"timeout", 0, 0, G_OPTION_ARG_STRING, &timeout_arg, "Give up on a bluetooth call after this many seconds", "<sec>"},
     {NULL}
 };
 
@@ -99,6 +106,11 @@ int main(int argc, char *argv[])
     /* Query current locale */
     setlocale(LC_CTYPE, "");
 
+    /* Let a running bt-daemon execute the command if we are asked to */
+    int forwarded_status = EXIT_SUCCESS;
+    if (command_socket_forward("bt-adapter", argc, argv, &forwarded_status))
+        exit(forwarded_status);
+
     // g_type_init(); // DEPRECATED
     dbus_init();
 
@@ -115,6 +127,12 @@ int main(int argc, char *argv[])
                                      "     Pairable\n"
                                      "     PairableTimeout\n"
                                      "     Powered\n\n"
+                                     "Batch Options:\n"
+                                     "  --batch <file|->\n"
+                                     "  Runs one command per line, each one of:\n"
+                                     "     list\n"
+                                     "     info\n"
+                                     "     set <property> <value>\n\n"
                                      "Report bugs to <"PACKAGE_BUGREPORT">."
                                      "Project home page <"PACKAGE_URL">."
                                      );
@@ -125,7 +143,7 @@ int main(int argc, char *argv[])
         g_print("Try `%s --help` for more information.\n", g_get_prgname());
         exit(EXIT_FAILURE);
     }
-    else if (!list_arg && !info_arg && !discover_arg && !set_arg)
+    else if (!list_arg && !info_arg && !discover_arg && !set_arg && !batch_arg)
     {
         g_print("%s", g_option_context_get_help(context, FALSE, NULL));
         exit(EXIT_FAILURE);
@@ -139,6 +157,11 @@ int main(int argc, char *argv[])
 
     g_option_context_free(context);
 
+    gint timeout_msec = -1;
+    if (timeout_arg && !dbus_call_timeout_parse(timeout_arg, &timeout_msec, &error))
+        exit_if_error(error);
+    dbus_set_call_timeout(timeout_msec);
+
     if (!dbus_system_connect(&error))
     {
         g_printerr("Couldn't connect to DBus system bus: %s\n", error->message);
@@ -155,54 +178,20 @@ int main(int argc, char *argv[])
 
     Manager *manager = g_object_new(MANAGER_TYPE, NULL);
 
-    if (list_arg)
+    if (batch_arg)
     {
-        const GPtrArray *adapters_list = manager_get_adapters(manager);
-        g_assert(adapters_list != NULL);
-
-        if (adapters_list->len == 0)
-        {
-            g_print("No adapters found\n");
+        if (!batch_run(BATCH_ADAPTER, adapter_arg, batch_arg))
+            exit(EXIT_FAILURE);
+    }
+    else if (list_arg)
+    {
+        if (!adapter_command_list())
             exit(EXIT_FAILURE);
-        }
-
-        g_print("Available adapters:\n");
-        for (int i = 0; i < adapters_list->len; i++)
-        {
-            const gchar *adapter_path = g_ptr_array_index(adapters_list, i);
-            Adapter *adapter = adapter_new(adapter_path);
-            g_print("%s (%s)\n", adapter_get_name(adapter, &error), adapter_get_address(adapter, &error));
-            g_object_unref(adapter);
-        }
     }
     else if (info_arg)
     {
-        Adapter *adapter = find_adapter(adapter_arg, &error);
-        exit_if_error(error);
-
-        gchar *adapter_intf = g_path_get_basename(adapter_get_dbus_object_path(adapter));
-        g_print("[%s]\n", adapter_intf);
-        g_print("  Name: %s\n", adapter_get_name(adapter, &error));
-        g_print("  Address: %s\n", adapter_get_address(adapter, &error));
-        g_print("  Alias: %s [rw]\n", adapter_get_alias(adapter, &error));
-        g_print("  Class: 0x%x\n", adapter_get_class(adapter, &error));
-        g_print("  Discoverable: %d [rw]\n", adapter_get_discoverable(adapter, &error));
-        g_print("  DiscoverableTimeout: %d [rw]\n", adapter_get_discoverable_timeout(adapter, &error));
-        g_print("  Discovering: %d\n", adapter_get_discovering(adapter, &error));
-        g_print("  Pairable: %d [rw]\n", adapter_get_pairable(adapter, &error));
-        g_print("  PairableTimeout: %d [rw]\n", adapter_get_pairable_timeout(adapter, &error));
-        g_print("  Powered: %d [rw]\n", adapter_get_powered(adapter, &error));
-        g_print("  UUIDs: [");
-        const gchar **uuids = adapter_get_uuids(adapter, &error);
-        for (int j = 0; uuids[j] != NULL; j++)
-        {
-            if (j > 0) g_print(", ");
-            g_print("%s", uuid2name(uuids[j]));
-        }
-        g_print("]\n");
-
-        g_free(adapter_intf);
-        g_object_unref(adapter);
+        if (!adapter_command_info(adapter_arg))
+            exit(EXIT_FAILURE);
     }
     else if (discover_arg)
     {
@@ -242,86 +231,18 @@ int main(int argc, char *argv[])
         set_property_arg = argv[1];
         set_value_arg = argv[2];
 
-        Adapter *adapter = find_adapter(adapter_arg, &error);
-        exit_if_error(error);
-
-        GVariant *v = NULL;
-
-        if (g_strcmp0(set_property_arg, "Alias") == 0)
-        {
-            v = g_variant_new_string(set_value_arg);
-        }
-        else if (
-                g_strcmp0(set_property_arg, "Discoverable") == 0 ||
-                g_strcmp0(set_property_arg, "Pairable") == 0 ||
-                g_strcmp0(set_property_arg, "Powered") == 0
-                )
-        {
-            if (g_strcmp0(set_value_arg, "0") == 0 || g_ascii_strcasecmp(set_value_arg, "FALSE") == 0 || g_ascii_strcasecmp(set_value_arg, "OFF") == 0)
-            {
-                v = g_variant_new_boolean(FALSE);
-            }
-            else if (g_strcmp0(set_value_arg, "1") == 0 || g_ascii_strcasecmp(set_value_arg, "TRUE") == 0 || g_ascii_strcasecmp(set_value_arg, "ON") == 0)
-            {
-                v = g_variant_new_boolean(TRUE);
-            }
-            else
-            {
-                g_print("%s: Invalid boolean value: %s\n", g_get_prgname(), set_value_arg);
-                g_print("Try `%s --help` for more information.\n", g_get_prgname());
-                exit(EXIT_FAILURE);
-            }
-        }
-        else if (
-                g_strcmp0(set_property_arg, "DiscoverableTimeout") == 0 ||
-                g_strcmp0(set_property_arg, "PairableTimeout") == 0
-                )
+        GVariant *v = adapter_property_value_parse(set_property_arg, set_value_arg, &error);
+        if (v == NULL)
         {
-            v = g_variant_new_uint32((guint32) atoi(set_value_arg));
-        }
-        else
-        {
-            g_print("%s: Invalid property: %s\n", g_get_prgname(), set_property_arg);
+            g_print("%s: %s\n", g_get_prgname(), error->message);
             g_print("Try `%s --help` for more information.\n", g_get_prgname());
             exit(EXIT_FAILURE);
         }
 
-        GVariant *props = adapter_get_properties(adapter, &error);
-        exit_if_error(error);
-        
-        if(g_ascii_strcasecmp(set_property_arg, "Alias") == 0)
-            adapter_set_alias(adapter, g_variant_get_string(v, NULL), &error);
-        else if(g_ascii_strcasecmp(set_property_arg, "Discoverable") == 0)
-            adapter_set_discoverable(adapter, g_variant_get_boolean(v), &error);
-        else if(g_ascii_strcasecmp(set_property_arg, "DiscoverableTimeout") == 0)
-            adapter_set_discoverable_timeout(adapter, g_variant_get_uint32(v), &error);
-        else if(g_ascii_strcasecmp(set_property_arg, "Pairable") == 0)
-            adapter_set_pairable(adapter, g_variant_get_boolean(v), &error);
-        else if(g_ascii_strcasecmp(set_property_arg, "PairableTimeout") == 0)
-            adapter_set_pairable_timeout(adapter, g_variant_get_uint32(v), &error);
-        else if(g_ascii_strcasecmp(set_property_arg, "Powered") == 0)
-            adapter_set_powered(adapter, g_variant_get_boolean(v), &error);
-        
-        exit_if_error(error);
-        
-        GVariant *old_value = g_variant_lookup_value(props, set_property_arg, NULL);
-        g_assert(old_value != NULL);
-        if (g_variant_type_equal(G_VARIANT_TYPE_STRING, g_variant_get_type(old_value)))
-        {
-            g_print("%s: %s -> %s\n", set_property_arg, g_variant_get_string(old_value, NULL), g_variant_get_string(v, NULL));
-        }
-        else if (g_variant_type_equal(G_VARIANT_TYPE_BOOLEAN, g_variant_get_type(old_value)))
-        {
-            g_print("%s: %u -> %u\n", set_property_arg, g_variant_get_boolean(old_value), g_variant_get_boolean(v));
-        }
-        else if (g_variant_type_equal(G_VARIANT_TYPE_UINT32, g_variant_get_type(old_value)))
-        {
-            g_print("%s: %u -> %u\n", set_property_arg, g_variant_get_uint32(old_value), g_variant_get_uint32(v));
-        }
-        g_variant_unref(props);
-
-        // g_variant_unref(v); /* Floating references do not need to be unref */
-        g_object_unref(adapter);
+        g_variant_ref_sink(v);
+        if (!adapter_command_set(adapter_arg, set_property_arg, v))
+            exit(EXIT_FAILURE);
+        g_variant_unref(v);
     }
 
     g_object_unref(manager);
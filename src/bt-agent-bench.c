@@ -0,0 +1,540 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/*
+ * Pairing throughput of bt-agent against a mock bluetoothd.
+ *
+ * Plays org.bluez on a private bus (never the real system bus), starts
+ * bt-agent in the foreground once per mode and fires RequestPinCode,
+ * RequestConfirmation and AuthorizeService at it from many simulated
+ * devices at once, then reports requests/sec and reply latencies.
+ *
+ * Not installed; build with `make bt-agent-bench` and run e.g.:
+ *
+ *   eval $(dbus-launch --sh-syntax)
+ *   DBUS_SYSTEM_BUS_ADDRESS=$DBUS_SESSION_BUS_ADDRESS ./bt-agent-bench
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <locale.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "lib/dbus-common.h"
+#include "lib/helpers.h"
+#include "lib/bluez-api.h"
+#include "lib/agent-helper.h"
+
+#define BENCH_ADAPTER_PATH "/org/bluez/hci0"
+#define BENCH_AGENT_START_TIMEOUT 10 /* sec */
+
+static const gchar *_bench_mock_xml =
+    "<node>"
+    "  <interface name='org.freedesktop.DBus.ObjectManager'>"
+    "    <method name='GetManagedObjects'>"
+    "      <arg name='objects' direction='out' type='a{oa{sa{sv}}}'/>"
+    "    </method>"
+    "  </interface>"
+    "  <interface name='org.bluez.AgentManager1'>"
+    "    <method name='RegisterAgent'>"
+    "      <arg name='agent' direction='in' type='o'/>"
+    "      <arg name='capability' direction='in' type='s'/>"
+    "    </method>"
+    "    <method name='UnregisterAgent'>"
+    "      <arg name='agent' direction='in' type='o'/>"
+    "    </method>"
+    "    <method name='RequestDefaultAgent'>"
+    "      <arg name='agent' direction='in' type='o'/>"
+    "    </method>"
+    "  </interface>"
+    "  <interface name='org.bluez.Device1'>"
+    "    <property name='Address' type='s' access='read'/>"
+    "    <property name='Alias' type='s' access='read'/>"
+    "    <property name='Paired' type='b' access='read'/>"
+    "  </interface>"
+    "</node>";
+
+typedef enum {
+    BENCH_MODE_NO_PINS,     /* no PIN's file: pairing requests are rejected */
+    BENCH_MODE_PIN_FILE,    /* one PIN per device MAC */
+    BENCH_MODE_CATCH_ALL    /* a single `*` entry */
+} BenchMode;
+
+static const gchar *_bench_mode_names[] = {"none", "pin-file", "catch-all"};
+
+typedef struct {
+    guint ok;
+    guint rejected;
+    guint failed;
+    GArray *latencies; /* gint64 usec, one per reply */
+} BenchStats;
+
+typedef struct {
+    BenchMode mode;
+    guint device;
+    gint64 started;
+} BenchCall;
+
+static GDBusNodeInfo *mock_info = NULL;
+static gchar *agent_owner = NULL;
+static gboolean agent_default = FALSE;
+
+static guint requests_sent = 0;
+static guint requests_done = 0;
+static BenchStats stats;
+
+static gint devices_arg = 100;
+static gint requests_arg = 3000;
+static gint parallel_arg = 32;
+static gchar *agent_arg = NULL;
+static gchar *modes_arg = NULL;
+static gboolean hidden_arg = FALSE;
+
+static GOptionEntry entries[] = {
+    {"agent", 0, 0, G_OPTION_ARG_FILENAME, &agent_arg, "bt-agent binary to run (default: ./bt-agent)", "<path>"},
+    {"devices", 0, 0, G_OPTION_ARG_INT, &devices_arg, "Number of simulated devices (default: 100)", "<n>"},
+    {"requests", 'n', 0, G_OPTION_ARG_INT, &requests_arg, "Requests per mode (default: 3000)", "<n>"},
+    {"parallel", 'j', 0, G_OPTION_ARG_INT, &parallel_arg, "Requests in flight at once (default: 32)", "<n>"},
+    {"modes", 'm', 0, G_OPTION_ARG_STRING, &modes_arg, "Comma separated: none,pin-file,catch-all (default: all)", "<list>"},
+    {"hidden", 0, 0, G_OPTION_ARG_NONE, &hidden_arg, "Leave devices out of GetManagedObjects so the agent has to look each one up", NULL},
+    {NULL}
+};
+
+static gchar *_bench_device_address(guint i)
+{
+    return g_strdup_printf("00:00:00:00:%02X:%02X", (i >> 8) & 0xff, i & 0xff);
+}
+
+static gchar *_bench_device_path(guint i)
+{
+    return g_strdup_printf(BENCH_ADAPTER_PATH "/dev_00_00_00_00_%02X_%02X", (i >> 8) & 0xff, i & 0xff);
+}
+
+static guint32 _bench_device_passkey(BenchMode mode, guint i)
+{
+    return mode == BENCH_MODE_PIN_FILE ? 100000 + i : 0;
+}
+
+static GVariant *_bench_device_property(guint i, const gchar *property_name)
+{
+    if (g_strcmp0(property_name, "Address") == 0)
+        return g_variant_new_take_string(_bench_device_address(i));
+    else if (g_strcmp0(property_name, "Alias") == 0)
+        return g_variant_new_take_string(g_strdup_printf("Bench %u", i));
+    else if (g_strcmp0(property_name, "Paired") == 0)
+        return g_variant_new_boolean(TRUE);
+    return NULL;
+}
+
+static GVariant *_bench_device_get_property(GDBusConnection *connection, const gchar *sender, const gchar *object_path, const gchar *interface_name, const gchar *property_name, GError **error, gpointer user_data)
+{
+    return _bench_device_property(GPOINTER_TO_UINT(user_data), property_name);
+}
+
+static void _bench_manager_method_call(GDBusConnection *connection, const gchar *sender, const gchar *object_path, const gchar *interface_name, const gchar *method_name, GVariant *parameters, GDBusMethodInvocation *invocation, gpointer user_data)
+{
+    if (g_strcmp0(method_name, "GetManagedObjects") == 0)
+    {
+        GVariantBuilder objects;
+        g_variant_builder_init(&objects, G_VARIANT_TYPE("a{oa{sa{sv}}}"));
+
+        for (guint i = 0; !hidden_arg && i < (guint) devices_arg; i++)
+        {
+            gchar *path = _bench_device_path(i);
+            g_variant_builder_open(&objects, G_VARIANT_TYPE("{oa{sa{sv}}}"));
+            g_variant_builder_add(&objects, "o", path);
+            g_variant_builder_open(&objects, G_VARIANT_TYPE("a{sa{sv}}"));
+            g_variant_builder_open(&objects, G_VARIANT_TYPE("{sa{sv}}"));
+            g_variant_builder_add(&objects, "s", DEVICE_DBUS_INTERFACE);
+            g_variant_builder_open(&objects, G_VARIANT_TYPE("a{sv}"));
+            g_variant_builder_add(&objects, "{sv}", "Address", _bench_device_property(i, "Address"));
+            g_variant_builder_add(&objects, "{sv}", "Alias", _bench_device_property(i, "Alias"));
+            g_variant_builder_add(&objects, "{sv}", "Paired", _bench_device_property(i, "Paired"));
+            g_variant_builder_close(&objects);
+            g_variant_builder_close(&objects);
+            g_variant_builder_close(&objects);
+            g_variant_builder_close(&objects);
+            g_free(path);
+        }
+
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(a{oa{sa{sv}}})", &objects));
+    }
+    else if (g_strcmp0(method_name, "RegisterAgent") == 0)
+    {
+        g_free(agent_owner);
+        agent_owner = g_strdup(sender);
+        g_dbus_method_invocation_return_value(invocation, NULL);
+    }
+    else if (g_strcmp0(method_name, "RequestDefaultAgent") == 0)
+    {
+        agent_default = TRUE;
+        g_dbus_method_invocation_return_value(invocation, NULL);
+    }
+    else if (g_strcmp0(method_name, "UnregisterAgent") == 0)
+    {
+        g_dbus_method_invocation_return_value(invocation, NULL);
+    }
+}
+
+static gboolean _bench_mock_register(GDBusConnection *conn, GError **error)
+{
+    static const GDBusInterfaceVTable manager_vtable = {_bench_manager_method_call, NULL, NULL};
+    static const GDBusInterfaceVTable device_vtable = {NULL, _bench_device_get_property, NULL};
+
+    mock_info = g_dbus_node_info_new_for_xml(_bench_mock_xml, error);
+    if (!mock_info)
+        return FALSE;
+
+    if (!g_dbus_connection_register_object(conn, MANAGER_DBUS_PATH, g_dbus_node_info_lookup_interface(mock_info, MANAGER_DBUS_INTERFACE), &manager_vtable, NULL, NULL, error))
+        return FALSE;
+    if (!g_dbus_connection_register_object(conn, BLUEZ_DBUS_BASE_PATH, g_dbus_node_info_lookup_interface(mock_info, AGENT_MANAGER_DBUS_INTERFACE), &manager_vtable, NULL, NULL, error))
+        return FALSE;
+
+    for (guint i = 0; i < (guint) devices_arg; i++)
+    {
+        gchar *path = _bench_device_path(i);
+        guint id = g_dbus_connection_register_object(conn, path, g_dbus_node_info_lookup_interface(mock_info, DEVICE_DBUS_INTERFACE), &device_vtable, GUINT_TO_POINTER(i), NULL, error);
+        g_free(path);
+        if (!id)
+            return FALSE;
+    }
+
+    /* Refuse to stand in for a bluetoothd that is already there */
+    GVariant *ret = g_dbus_connection_call_sync(conn, "org.freedesktop.DBus", "/org/freedesktop/DBus", "org.freedesktop.DBus", "RequestName", g_variant_new("(su)", BLUEZ_DBUS_SERVICE_NAME, 0x4 /* DO_NOT_QUEUE */), G_VARIANT_TYPE("(u)"), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+    if (!ret)
+        return FALSE;
+
+    guint32 reply = 0;
+    g_variant_get(ret, "(u)", &reply);
+    g_variant_unref(ret);
+    if (reply != 1 /* PRIMARY_OWNER */)
+    {
+        g_set_error(error, g_quark_from_string("bluez-tools"), 1, "%s is already owned on this bus", BLUEZ_DBUS_SERVICE_NAME);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gchar *_bench_write_pins(BenchMode mode, const gchar *dir, GError **error)
+{
+    if (mode == BENCH_MODE_NO_PINS)
+        return NULL;
+
+    GString *pins = g_string_new(NULL);
+    if (mode == BENCH_MODE_CATCH_ALL)
+    {
+        g_string_append(pins, "*\t000000\n");
+    }
+    else
+    {
+        for (guint i = 0; i < (guint) devices_arg; i++)
+        {
+            gchar *address = _bench_device_address(i);
+            g_string_append_printf(pins, "%s\t%u\n", address, _bench_device_passkey(mode, i));
+            g_free(address);
+        }
+    }
+
+    gchar *filename = g_build_filename(dir, "pins", NULL);
+    gboolean written = g_file_set_contents(filename, pins->str, pins->len, error);
+    g_string_free(pins, TRUE);
+    if (!written)
+    {
+        g_free(filename);
+        return NULL;
+    }
+    return filename;
+}
+
+static gboolean _bench_timeout(gpointer data)
+{
+    *(gboolean *) data = TRUE;
+    return G_SOURCE_REMOVE;
+}
+
+static void _bench_issue(GDBusConnection *conn, BenchMode mode);
+
+static void _bench_reply(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    BenchCall *call = user_data;
+    GError *error = NULL;
+    GVariant *ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source_object), res, &error);
+    gint64 latency = g_get_monotonic_time() - call->started;
+
+    g_array_append_val(stats.latencies, latency);
+    if (ret)
+    {
+        stats.ok++;
+        g_variant_unref(ret);
+    }
+    else
+    {
+        gchar *name = g_dbus_error_get_remote_error(error);
+        if (g_strcmp0(name, "org.bluez.Error.Rejected") == 0)
+            stats.rejected++;
+        else
+            stats.failed++;
+        g_free(name);
+        g_error_free(error);
+    }
+
+    requests_done++;
+    _bench_issue(G_DBUS_CONNECTION(source_object), call->mode);
+    g_free(call);
+}
+
+/* Keeps --parallel requests in flight, cycling through the three methods and all devices */
+static void _bench_issue(GDBusConnection *conn, BenchMode mode)
+{
+    while (requests_sent < (guint) requests_arg && requests_sent - requests_done < (guint) parallel_arg)
+    {
+        BenchCall *call = g_new0(BenchCall, 1);
+        call->mode = mode;
+        call->device = requests_sent % devices_arg;
+
+        gchar *path = _bench_device_path(call->device);
+        const gchar *method_name;
+        GVariant *parameters;
+        switch (requests_sent % 3)
+        {
+        case 0:
+            method_name = "RequestPinCode";
+            parameters = g_variant_new("(o)", path);
+            break;
+        case 1:
+            method_name = "RequestConfirmation";
+            parameters = g_variant_new("(ou)", path, _bench_device_passkey(mode, call->device));
+            break;
+        default:
+            method_name = "AuthorizeService";
+            parameters = g_variant_new("(os)", path, "00001124-0000-1000-8000-00805f9b34fb");
+            break;
+        }
+        g_free(path);
+
+        requests_sent++;
+        call->started = g_get_monotonic_time();
+        g_dbus_connection_call(conn, agent_owner, AGENT_PATH, AGENT_DBUS_INTERFACE, method_name, parameters, NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, _bench_reply, call);
+    }
+}
+
+static gint _bench_compare_latency(gconstpointer a, gconstpointer b)
+{
+    gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+    return x < y ? -1 : x > y;
+}
+
+static gdouble _bench_percentile(GArray *sorted, gdouble p)
+{
+    if (sorted->len == 0)
+        return 0;
+    guint i = (guint) (p * (sorted->len - 1) + 0.5);
+    return g_array_index(sorted, gint64, i) / 1000.0;
+}
+
+static void _bench_agent_exited(GPid pid, gint status, gpointer user_data)
+{
+    *(gboolean *) user_data = TRUE;
+    g_spawn_close_pid(pid);
+}
+
+/* Stops the agent we spawned and waits until it is gone, and off the bus with it */
+static void _bench_stop_agent(GPid pid)
+{
+    gboolean exited = FALSE, timed_out = FALSE;
+    g_child_watch_add(pid, _bench_agent_exited, &exited);
+
+    kill(pid, SIGTERM);
+    guint timeout_id = g_timeout_add_seconds(BENCH_AGENT_START_TIMEOUT, _bench_timeout, &timed_out);
+    while (!exited && !timed_out)
+        g_main_context_iteration(NULL, TRUE);
+    if (!timed_out)
+        g_source_remove(timeout_id);
+
+    /* Still there: the next mode must not find it holding the agent */
+    if (!exited)
+    {
+        kill(pid, SIGKILL);
+        while (!exited)
+            g_main_context_iteration(NULL, TRUE);
+    }
+}
+
+static gboolean _bench_run_mode(GDBusConnection *conn, BenchMode mode, const gchar *dir, GError **error)
+{
+    gchar *pin_file = _bench_write_pins(mode, dir, error);
+    if (mode != BENCH_MODE_NO_PINS && !pin_file)
+        return FALSE;
+
+    /* Admission control would turn the load into rejections; measure request handling itself */
+    gchar *argv[] = {agent_arg, "--capability", "NoInputNoOutput", "--rate-limit", "0", "--max-pending", "0", pin_file ? "--pin" : NULL, pin_file, NULL};
+    g_free(agent_owner);
+    agent_owner = NULL;
+    agent_default = FALSE;
+    /* In the foreground: the PID stays ours to stop, and its request log stays out of the table */
+    GPid agent_pid = 0;
+    if (!g_spawn_async(NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_STDOUT_TO_DEV_NULL, NULL, NULL, &agent_pid, error))
+    {
+        g_free(pin_file);
+        return FALSE;
+    }
+
+    gboolean timed_out = FALSE;
+    guint timeout_id = g_timeout_add_seconds(BENCH_AGENT_START_TIMEOUT, _bench_timeout, &timed_out);
+    while (!(agent_owner && agent_default) && !timed_out)
+        g_main_context_iteration(NULL, TRUE);
+    if (timed_out)
+    {
+        g_set_error(error, g_quark_from_string("bluez-tools"), 1, "%s did not register an agent", agent_arg);
+        _bench_stop_agent(agent_pid);
+        if (pin_file)
+            g_unlink(pin_file);
+        g_free(pin_file);
+        return FALSE;
+    }
+    g_source_remove(timeout_id);
+
+    memset(&stats, 0, sizeof(stats));
+    stats.latencies = g_array_sized_new(FALSE, FALSE, sizeof(gint64), requests_arg);
+    requests_sent = requests_done = 0;
+
+    gint64 started = g_get_monotonic_time();
+    _bench_issue(conn, mode);
+    while (requests_done < (guint) requests_arg)
+        g_main_context_iteration(NULL, TRUE);
+    gdouble elapsed = (g_get_monotonic_time() - started) / (gdouble) G_USEC_PER_SEC;
+
+    g_array_sort(stats.latencies, _bench_compare_latency);
+    g_print("%-10s %8u %8u %8u %8u %10.0f %8.2f %8.2f %8.2f %8.2f\n", _bench_mode_names[mode], requests_done, stats.ok, stats.rejected, stats.failed,
+            elapsed > 0 ? requests_done / elapsed : 0,
+            _bench_percentile(stats.latencies, 0.50), _bench_percentile(stats.latencies, 0.90), _bench_percentile(stats.latencies, 0.99), _bench_percentile(stats.latencies, 1.0));
+    g_array_free(stats.latencies, TRUE);
+
+    _bench_stop_agent(agent_pid);
+
+    if (pin_file)
+        g_unlink(pin_file);
+    g_free(pin_file);
+    return TRUE;
+}
+
+int main(int argc, char *argv[])
+{
+    GError *error = NULL;
+    GOptionContext *context;
+
+    /* Query current locale */
+    setlocale(LC_CTYPE, "");
+
+    dbus_init();
+
+    context = g_option_context_new("- pairing throughput of bt-agent against a mock bluetoothd");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_set_summary(context, "Version "PACKAGE_VERSION);
+    g_option_context_set_description(context,
+                                     "Runs on the bus given by DBUS_SYSTEM_BUS_ADDRESS, which must be\n"
+                                     "a private bus where nothing owns org.bluez yet, e.g.:\n"
+                                     "  eval $(dbus-launch --sh-syntax)\n"
+                                     "  DBUS_SYSTEM_BUS_ADDRESS=$DBUS_SESSION_BUS_ADDRESS bt-agent-bench\n\n"
+                                     "Report bugs to <"PACKAGE_BUGREPORT">."
+                                     "Project home page <"PACKAGE_URL">."
+                                     );
+
+    if (!g_option_context_parse(context, &argc, &argv, &error))
+    {
+        g_print("%s: %s\n", g_get_prgname(), error->message);
+        g_print("Try `%s --help` for more information.\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+    g_option_context_free(context);
+
+    if (!g_getenv("DBUS_SYSTEM_BUS_ADDRESS"))
+    {
+        g_printerr("%s: DBUS_SYSTEM_BUS_ADDRESS is not set, refusing to run on the real system bus\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+    if (devices_arg <= 0 || devices_arg > 0x10000 || requests_arg <= 0 || parallel_arg <= 0)
+    {
+        g_printerr("%s: --devices must be 1..65536, --requests and --parallel positive\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+    if (!agent_arg)
+        agent_arg = g_strdup("./bt-agent");
+
+    gboolean run_mode[G_N_ELEMENTS(_bench_mode_names)] = {FALSE,};
+    gchar **modes = g_strsplit(modes_arg ? modes_arg : "none,pin-file,catch-all", ",", -1);
+    for (gchar **m = modes; *m; m++)
+    {
+        guint i;
+        for (i = 0; i < G_N_ELEMENTS(_bench_mode_names); i++)
+            if (g_strcmp0(*m, _bench_mode_names[i]) == 0)
+                break;
+        if (i == G_N_ELEMENTS(_bench_mode_names))
+        {
+            g_printerr("%s: Invalid mode: %s\n", g_get_prgname(), *m);
+            exit(EXIT_FAILURE);
+        }
+        run_mode[i] = TRUE;
+    }
+    g_strfreev(modes);
+
+    if (!dbus_system_connect(&error))
+    {
+        g_printerr("Couldn't connect to DBus system bus: %s\n", error->message);
+        exit(EXIT_FAILURE);
+    }
+
+    if (!_bench_mock_register(system_conn, &error))
+        exit_if_error(error);
+
+    gchar *dir = g_dir_make_tmp("bt-agent-bench-XXXXXX", &error);
+    exit_if_error(error);
+
+    g_print("%d devices, %d requests per mode, %d in flight%s\n\n", devices_arg, requests_arg, parallel_arg, hidden_arg ? ", devices looked up on demand" : "");
+    g_print("%-10s %8s %8s %8s %8s %10s %8s %8s %8s %8s\n", "mode", "requests", "ok", "rejected", "failed", "req/s", "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+    for (guint i = 0; i < G_N_ELEMENTS(_bench_mode_names); i++)
+    {
+        if (run_mode[i] && !_bench_run_mode(system_conn, i, dir, &error))
+        {
+            g_rmdir(dir);
+            exit_if_error(error);
+        }
+    }
+
+    g_rmdir(dir);
+    g_free(dir);
+    g_dbus_node_info_unref(mock_info);
+    g_free(agent_owner);
+
+    exit(EXIT_SUCCESS);
+}
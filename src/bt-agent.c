@@ -45,11 +45,25 @@
 static gboolean need_unregister = TRUE;
 static GMainLoop *mainloop = NULL;
 
-static GHashTable *pin_hash_table = NULL;
+/* Wait for writes to the PIN's file to settle before reloading it */
+#define PIN_RELOAD_DELAY 300 /* msec */
+
+/* Everything loaded from the PIN's file, swapped in and out as a whole */
+typedef struct {
+	GHashTable *table;	/* text file */
+	PinDb *db;		/* or compiled database */
+	PinRules *rules;	/* wildcard entries of either */
+} PinSet;
+
+static PinSet *pins = NULL;
 static gchar *pin_arg = NULL;
+static GFileMonitor *pin_monitor = NULL;
+static guint pin_reload_timeout_id = 0;
+static gboolean pin_reload_running = FALSE;
+static gboolean pin_reload_again = FALSE;
 
 // Not touching this for now. It seems to work.
-static void _read_pin_file(const gchar *filename, GHashTable *pin_hash_table, gboolean first_run)
+static gboolean _read_pin_file(const gchar *filename, GHashTable *pin_hash_table, gboolean first_run)
 {
 	g_assert(filename != NULL && strlen(filename) > 0);
 	g_assert(pin_hash_table != NULL);
@@ -61,7 +75,7 @@ static void _read_pin_file(const gchar *filename, GHashTable *pin_hash_table, gb
 			g_printerr("%s: %s\n", filename, strerror(errno));
 			exit(EXIT_FAILURE);
 		} else {
-			return;
+			return FALSE;
 		}
 	}
 	if (!S_ISREG(sbuf.st_mode)) {
@@ -69,7 +83,7 @@ static void _read_pin_file(const gchar *filename, GHashTable *pin_hash_table, gb
 			g_printerr("%s: It's not a regular file\n", filename);
 			exit(EXIT_FAILURE);
 		} else {
-			return;
+			return FALSE;
 		}
 	}
 	if (sbuf.st_mode & S_IROTH) {
@@ -83,7 +97,7 @@ static void _read_pin_file(const gchar *filename, GHashTable *pin_hash_table, gb
 			g_printerr("%s: %s\n", filename, strerror(errno));
 			exit(EXIT_FAILURE);
 		} else {
-			return;
+			return FALSE;
 		}
 	}
 
@@ -124,7 +138,132 @@ static void _read_pin_file(const gchar *filename, GHashTable *pin_hash_table, gb
 
 	first_run = FALSE;
 
-	return;
+	return TRUE;
+}
+
+static void _pin_set_free(gpointer data)
+{
+	PinSet *set = data;
+
+	if (!set)
+		return;
+	pin_rules_free(set->rules);
+	if (set->table)
+		g_hash_table_unref(set->table);
+	pin_db_free(set->db);
+	g_free(set);
+}
+
+static void _collect_pin_pattern(gpointer key, gpointer value, gpointer user_data)
+{
+	if (pin_rules_is_pattern(key))
+		g_hash_table_insert(user_data, key, value);
+}
+
+/* Loads a text PIN's file or a compiled database, NULL if it can't be used */
+static PinSet *_pin_set_load(const gchar *filename, gboolean first_run, GError **error)
+{
+	PinSet *set = g_new0(PinSet, 1);
+
+	if (pin_db_file_is_compiled(filename)) {
+		set->db = pin_db_open(filename, error);
+		if (!set->db) {
+			g_free(set);
+			return NULL;
+		}
+
+		/* Rules point into the mapping and live exactly as long as it */
+		GHashTable *patterns = g_hash_table_new(g_str_hash, g_str_equal);
+		pin_db_foreach(set->db, _collect_pin_pattern, patterns);
+		set->rules = pin_rules_new(patterns);
+		g_hash_table_unref(patterns);
+	} else {
+		set->table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+		if (!_read_pin_file(filename, set->table, first_run)) {
+			g_set_error(error, g_quark_from_string("bluez-tools"), 1, "%s: Can't read PIN's file", filename);
+			_pin_set_free(set);
+			return NULL;
+		}
+		set->rules = pin_rules_new(set->table);
+	}
+
+	return set;
+}
+
+/* Requests in flight keep using the old set until this returns; nothing is ever half loaded */
+static void _pin_set_install(PinSet *set)
+{
+	set_agent_pin_table(set ? set->table : NULL);
+	set_agent_pin_database(set ? set->db : NULL);
+	set_agent_pin_rules(set ? set->rules : NULL);
+	_pin_set_free(pins);
+	pins = set;
+}
+
+static void _pin_reload_start();
+
+static void _pin_reload_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+	GError *error = NULL;
+	PinSet *set = _pin_set_load(task_data, FALSE, &error);
+
+	if (set)
+		g_task_return_pointer(task, set, _pin_set_free);
+	else
+		g_task_return_error(task, error);
+}
+
+static void _pin_reload_done(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	GError *error = NULL;
+	PinSet *set = g_task_propagate_pointer(G_TASK(res), &error);
+
+	if (set) {
+		_pin_set_install(set);
+		g_print("PIN's file reloaded\n");
+	} else {
+		g_printerr("%s (keeping the previous PINs)\n", error->message);
+		g_error_free(error);
+	}
+
+	pin_reload_running = FALSE;
+	if (pin_reload_again) {
+		pin_reload_again = FALSE;
+		_pin_reload_start();
+	}
+}
+
+/* Parses the PIN's file in a worker thread so requests are never held up by a reload */
+static void _pin_reload_start()
+{
+	if (pin_reload_running) {
+		pin_reload_again = TRUE;
+		return;
+	}
+	pin_reload_running = TRUE;
+
+	GTask *task = g_task_new(NULL, NULL, _pin_reload_done, NULL);
+	g_task_set_task_data(task, g_strdup(pin_arg), g_free);
+	g_task_run_in_thread(task, _pin_reload_thread);
+	g_object_unref(task);
+}
+
+static gboolean _pin_reload_timeout(gpointer data)
+{
+	pin_reload_timeout_id = 0;
+	_pin_reload_start();
+	return G_SOURCE_REMOVE;
+}
+
+static void _pin_file_changed(GFileMonitor *monitor, GFile *file, GFile *other_file, GFileMonitorEvent event_type, gpointer user_data)
+{
+	if (event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED || event_type == G_FILE_MONITOR_EVENT_PRE_UNMOUNT || event_type == G_FILE_MONITOR_EVENT_UNMOUNTED)
+		return;
+
+	/* Debounce: an editor or a copy produces a burst of events, reload once it is over */
+	if (pin_reload_timeout_id)
+		g_source_remove(pin_reload_timeout_id);
+	pin_reload_timeout_id = g_timeout_add(PIN_RELOAD_DELAY, _pin_reload_timeout, NULL);
 }
 
 static gboolean
@@ -137,7 +276,7 @@ usr1_signal_handler(gpointer data)
 
         /* Re-read PIN's file */
         g_print("Re-reading PIN's file\n");
-        _read_pin_file(pin_arg, pin_hash_table, FALSE);
+        _pin_reload_start();
 
         return G_SOURCE_CONTINUE;
 }
@@ -153,11 +292,25 @@ term_signal_handler(gpointer data)
 
 static gchar *capability_arg = NULL;
 static gboolean daemon_arg = FALSE;
+static gchar *timeout_arg = NULL;
+static gint rate_limit_arg = AGENT_DEFAULT_RATE_LIMIT;
+static gint max_pending_arg = AGENT_DEFAULT_MAX_PENDING;
+static gchar *compile_pins_arg = NULL;
+static gchar *audit_log_arg = NULL;
+static gint audit_size_arg = AUDIT_LOG_DEFAULT_CAPACITY;
+static gchar **adapter_policy_arg = NULL;
 
 static GOptionEntry entries[] = {
 	{"capability", 'c', 0, G_OPTION_ARG_STRING, &capability_arg, "Agent capability", "<capability>"},
+	{"adapter-policy", 0, 0, G_OPTION_ARG_STRING_ARRAY, &adapter_policy_arg, "Answer requests for the devices of an adapter by this policy (repeatable)", "<name|mac>=<policy>"},
 	{"pin", 'p', 0, G_OPTION_ARG_STRING, &pin_arg, "Path to the PIN's file"},
+	{"compile-pins", 0, 0, G_OPTION_ARG_FILENAME, &compile_pins_arg, "Compile the PIN's file into a database and exit", "<file>"},
 	{"daemon", 'd', 0, G_OPTION_ARG_NONE, &daemon_arg, "Run in background (as daemon)"},
+	{"timeout", 0, 0, G_OPTION_ARG_STRING, &timeout_arg, "Give up on a bluetooth call after this many seconds", "<sec>"},
+	{"rate-limit", 0, 0, G_OPTION_ARG_INT, &rate_limit_arg, "Reject a device's requests beyond n per minute (0: no limit)", "<n>"},
+	{"max-pending", 0, 0, G_OPTION_ARG_INT, &max_pending_arg, "Reject requests while n device lookups are in flight (0: no limit)", "<n>"},
+	{"audit-log", 0, 0, G_OPTION_ARG_FILENAME, &audit_log_arg, "Record every accept/reject decision in this file (see bt-audit)", "<file>"},
+	{"audit-size", 0, 0, G_OPTION_ARG_INT, &audit_size_arg, "Records kept in a new audit log before the oldest are overwritten", "<n>"},
 	{NULL}
 };
 
@@ -181,7 +334,11 @@ int main(int argc, char *argv[])
 			"   DisplayOnly\n"
 			"   DisplayYesNo (default)\n"
 			"   KeyboardOnly\n"
+			"   KeyboardDisplay\n"
 			"   NoInputNoOutput\n\n"
+			"`policy` is one of the capabilities, or Reject\n\n"
+			"`--pin` accepts a text PIN's file or a database made with\n"
+			"`--pin <text file> --compile-pins <database>`\n\n"
 			"Report bugs to <"PACKAGE_BUGREPORT">."
 			"Project home page <"PACKAGE_URL">."
 			);
@@ -197,6 +354,7 @@ int main(int argc, char *argv[])
 				g_strcmp0(capability_arg, "DisplayOnly") != 0 &&
 				g_strcmp0(capability_arg, "DisplayYesNo") != 0 &&
 				g_strcmp0(capability_arg, "KeyboardOnly") != 0 &&
+				g_strcmp0(capability_arg, "KeyboardDisplay") != 0 &&
 				g_strcmp0(capability_arg, "NoInputNoOutput") != 0
 				) {
 			g_print("%s: Invalid capability: %s\n", g_get_prgname(), capability_arg);
@@ -207,8 +365,38 @@ int main(int argc, char *argv[])
 		capability_arg = "DisplayYesNo"; // default value
 	}
 
+	if (rate_limit_arg < 0 || max_pending_arg < 0) {
+		g_print("%s: --rate-limit and --max-pending can't be negative\n", g_get_prgname());
+		exit(EXIT_FAILURE);
+	}
+
+	if (audit_size_arg <= 0) {
+		g_print("%s: --audit-size must be positive\n", g_get_prgname());
+		exit(EXIT_FAILURE);
+	}
+
 	g_option_context_free(context);
 
+	/* Compile the PIN's file; does not need the bus */
+	if (compile_pins_arg) {
+		if (!pin_arg) {
+			g_print("%s: --compile-pins needs the PIN's file (--pin)\n", g_get_prgname());
+			exit(EXIT_FAILURE);
+		}
+		GHashTable *pin_hash_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+		_read_pin_file(pin_arg, pin_hash_table, TRUE);
+		if (!pin_db_write(pin_hash_table, compile_pins_arg, &error))
+			exit_if_error(error);
+		g_print("%u PIN(s) written to %s\n", g_hash_table_size(pin_hash_table), compile_pins_arg);
+		g_hash_table_unref(pin_hash_table);
+		exit(EXIT_SUCCESS);
+	}
+
+	gint timeout_msec = -1;
+	if (timeout_arg && !dbus_call_timeout_parse(timeout_arg, &timeout_msec, &error))
+		exit_if_error(error);
+	dbus_set_call_timeout(timeout_msec);
+
 	if (!dbus_system_connect(&error))
         {
 		g_printerr("Couldn't connect to DBus system bus: %s\n", error->message);
@@ -226,20 +414,58 @@ int main(int argc, char *argv[])
 	/* Read PIN's file */
 	if (pin_arg)
         {
-		pin_hash_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
-		_read_pin_file(pin_arg, pin_hash_table, TRUE);
+		_pin_set_install(_pin_set_load(pin_arg, TRUE, &error));
+		exit_if_error(error);
+	}
+
+	/* Mapped now, so the fork below and the reply path never touch the file */
+	AuditLog *audit_log = NULL;
+	if (audit_log_arg)
+        {
+		audit_log = audit_log_open(audit_log_arg, audit_size_arg, &error);
+		exit_if_error(error);
+		set_agent_audit_log(audit_log);
 	}
 
 	mainloop = g_main_loop_new(NULL, FALSE);
 
 	Manager *manager = g_object_new(MANAGER_TYPE, NULL);
+
+	/* Answer requests from memory instead of querying every device on the bus */
+	ObjectModel *model = object_model_new(&error);
+	exit_if_error(error);
+	object_model_set_default(model);
+
+	/* Requests are routed by the device's Adapter property, so key the policies by adapter path */
+	for (gchar **p = adapter_policy_arg; p && *p; p++) {
+		gchar **spec = g_strsplit(*p, "=", 2);
+		AgentPolicy policy;
+
+		if (g_strv_length(spec) != 2 || !agent_policy_from_string(spec[1], &policy)) {
+			g_print("%s: Invalid adapter policy: %s\n", g_get_prgname(), *p);
+			g_print("Try `%s --help` for more information.\n", g_get_prgname());
+			exit(EXIT_FAILURE);
+		}
+
+		Adapter *adapter = find_adapter(spec[0], &error);
+		exit_if_error(error);
+		if (!adapter) {
+			g_printerr("%s: Adapter not found: %s\n", g_get_prgname(), spec[0]);
+			exit(EXIT_FAILURE);
+		}
+		set_agent_adapter_policy(adapter_get_dbus_object_path(adapter), policy);
+		g_object_unref(adapter);
+		g_strfreev(spec);
+	}
         
         AgentManager *agent_manager = agent_manager_new();
 
+        set_agent_rate_limit(rate_limit_arg, max_pending_arg);
+
         if(daemon_arg)
-            register_agent_callbacks(FALSE, pin_hash_table, mainloop, &error);
+            register_agent_callbacks(FALSE, NULL, mainloop, &error);
         else
-            register_agent_callbacks(TRUE, pin_hash_table, mainloop, &error);
+            register_agent_callbacks(TRUE, NULL, mainloop, &error);
         
         exit_if_error(error);
         
@@ -277,9 +503,28 @@ int main(int argc, char *argv[])
 	g_unix_signal_add (SIGTERM, term_signal_handler, NULL);
 	g_unix_signal_add (SIGINT, term_signal_handler, NULL);
 	g_unix_signal_add (SIGUSR1, usr1_signal_handler, NULL);
+	/* Don't wait for a stuck call to return before handling the above */
+	dbus_cancel_calls_on_signal(SIGTERM);
+	dbus_cancel_calls_on_signal(SIGINT);
+
+	/* Created after the fork: the monitor relies on a GLib worker thread */
+	if (pin_arg) {
+		GFile *pin_file = g_file_new_for_commandline_arg(pin_arg);
+		pin_monitor = g_file_monitor_file(pin_file, G_FILE_MONITOR_NONE, NULL, &error);
+		g_object_unref(pin_file);
+		if (pin_monitor)
+			g_signal_connect(pin_monitor, "changed", G_CALLBACK(_pin_file_changed), NULL);
+		else {
+			g_printerr("%s: can't watch for changes (%s), use SIGUSR1 to reload\n", pin_arg, error->message);
+			g_clear_error(&error);
+		}
+	}
 
 	g_main_loop_run(mainloop);
 
+	/* The signal that got us here cancelled the calls, not the cleanup */
+	dbus_set_call_cancellable(NULL);
+
 	if (need_unregister) {
                 g_print("unregistering agent...\n");
                 agent_manager_unregister_agent(agent_manager, AGENT_PATH, &error);
@@ -289,8 +534,15 @@ int main(int argc, char *argv[])
 	g_main_loop_unref(mainloop);
 
         unregister_agent_callbacks(NULL);
+	if (pin_monitor)
+		g_object_unref(pin_monitor);
+	_pin_set_install(NULL);
+	set_agent_audit_log(NULL);
+	audit_log_close(audit_log);
         g_object_unref(agent_manager);
 	g_object_unref(manager);
+	object_model_set_default(NULL);
+	g_object_unref(model);
 
 	dbus_disconnect();
 
@@ -0,0 +1,203 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "lib/helpers.h"
+#include "lib/audit-log.h"
+#include "lib/bluez/agent_interface.h"
+
+#define AUDIT_FOLLOW_INTERVAL 200 /* msec */
+
+static gchar *device_arg = NULL;
+static gchar *method_arg = NULL;
+static gboolean accepted_arg = FALSE;
+static gboolean rejected_arg = FALSE;
+static gint last_arg = 0;
+static gboolean follow_arg = FALSE;
+
+static GOptionEntry entries[] = {
+    {"device", 'd', 0, G_OPTION_ARG_STRING, &device_arg, "Only records of this device (MAC prefix or alias)", "<name|mac>"},
+    {"method", 'm', 0, G_OPTION_ARG_STRING, &method_arg, "Only records of this agent method", "<method>"},
+    {"accepted", 'a', 0, G_OPTION_ARG_NONE, &accepted_arg, "Only accepted requests"},
+    {"rejected", 'r', 0, G_OPTION_ARG_NONE, &rejected_arg, "Only rejected requests"},
+    {"last", 'n', 0, G_OPTION_ARG_INT, &last_arg, "Only the last n records (before filtering)", "<n>"},
+    {"follow", 'f', 0, G_OPTION_ARG_NONE, &follow_arg, "Keep printing new records as they are written"},
+    {NULL}
+};
+
+static gint method_filter = -1;
+
+static const gchar *_method_name(guint method)
+{
+    GDBusInterfaceInfo *info = agent_interface_info();
+    return method < AGENT_N_METHODS ? info->methods[method]->name : "Unknown";
+}
+
+static gboolean _record_matches(const AuditRecord *record)
+{
+    if (accepted_arg && record->decision != AUDIT_DECISION_ACCEPTED)
+        return FALSE;
+    if (rejected_arg && record->decision != AUDIT_DECISION_REJECTED)
+        return FALSE;
+    if (method_filter >= 0 && record->method != method_filter)
+        return FALSE;
+    if (device_arg &&
+        g_ascii_strncasecmp(record->address, device_arg, strlen(device_arg)) != 0 &&
+        g_strcmp0(record->alias, device_arg) != 0)
+        return FALSE;
+    return TRUE;
+}
+
+static void _record_print(const AuditRecord *record)
+{
+    GDateTime *time = g_date_time_new_from_unix_local(record->time / G_USEC_PER_SEC);
+    gchar *stamp = g_date_time_format(time, "%Y-%m-%d %H:%M:%S");
+
+    g_print("%s.%03u %s %s", stamp, (guint) (record->time % G_USEC_PER_SEC / 1000), _method_name(record->method), record->address[0] ? record->address : "-");
+    if (record->alias[0])
+        g_print(" (%s)", record->alias);
+    g_print(" %s %s", audit_decision_to_string(record->decision), audit_reason_to_string(record->reason));
+    if (record->method == AGENT_METHOD_REQUEST_CONFIRMATION || record->method == AGENT_METHOD_DISPLAY_PASSKEY)
+        g_print(" passkey %06u", record->passkey);
+    if (record->detail[0])
+        g_print(" %s", record->detail);
+    g_print("\n");
+
+    g_free(stamp);
+    g_date_time_unref(time);
+}
+
+/* Prints [seq, next) and returns the next sequence to read */
+static guint64 _print_from(AuditLog *log, guint64 seq)
+{
+    guint64 first = audit_log_first_seq(log);
+    guint64 next = audit_log_next_seq(log);
+    AuditRecord record;
+
+    if (seq < first)
+    {
+        /* Only when following a log that wraps faster than we read */
+        if (seq > 0)
+            g_printerr("%" G_GUINT64_FORMAT " record(s) overwritten before they were read\n", first - seq);
+        seq = first;
+    }
+
+    for (; seq < next; seq++)
+    {
+        if (!audit_log_read(log, seq, &record))
+            continue;
+        if (_record_matches(&record))
+            _record_print(&record);
+    }
+
+    return seq;
+}
+
+int main(int argc, char *argv[])
+{
+    GError *error = NULL;
+    GOptionContext *context;
+
+    /* Query current locale */
+    setlocale(LC_CTYPE, "");
+
+    context = g_option_context_new("<file> - read bt-agent's audit log");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_set_summary(context, "Version "PACKAGE_VERSION);
+    g_option_context_set_description(context,
+            "`file` is the log given to `bt-agent --audit-log`\n\n"
+            "`method` is an org.bluez.Agent1 method, e.g. RequestPinCode\n\n"
+            "Report bugs to <"PACKAGE_BUGREPORT">."
+            "Project home page <"PACKAGE_URL">."
+            );
+
+    if (!g_option_context_parse(context, &argc, &argv, &error))
+    {
+        g_print("%s: %s\n", g_get_prgname(), error->message);
+        g_print("Try `%s --help` for more information.\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+    else if (argc != 2 || strlen(argv[1]) == 0)
+    {
+        g_print("%s", g_option_context_get_help(context, FALSE, NULL));
+        exit(EXIT_FAILURE);
+    }
+    else if (accepted_arg && rejected_arg)
+    {
+        g_print("%s: --accepted and --rejected are mutually exclusive\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+    else if (last_arg < 0)
+    {
+        g_print("%s: Invalid value for --last\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+
+    if (method_arg)
+    {
+        for (guint i = 0; i < AGENT_N_METHODS; i++)
+            if (g_ascii_strcasecmp(method_arg, _method_name(i)) == 0)
+                method_filter = i;
+        if (method_filter < 0)
+        {
+            g_print("%s: Invalid method: %s\n", g_get_prgname(), method_arg);
+            g_print("Try `%s --help` for more information.\n", g_get_prgname());
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    g_option_context_free(context);
+
+    AuditLog *log = audit_log_open_readonly(argv[1], &error);
+    exit_if_error(error);
+
+    guint64 seq = audit_log_first_seq(log);
+    if (last_arg > 0)
+    {
+        guint64 next = audit_log_next_seq(log);
+        seq = MAX(seq, next > (guint64) last_arg ? next - last_arg : 1);
+    }
+
+    seq = _print_from(log, seq);
+
+    /* The agent writes through the same shared mapping, so polling the header is enough */
+    while (follow_arg)
+    {
+        g_usleep(AUDIT_FOLLOW_INTERVAL * 1000);
+        seq = _print_from(log, seq);
+    }
+
+    audit_log_close(log);
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,517 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <glib-unix.h>
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+
+#include "lib/dbus-common.h"
+#include "lib/helpers.h"
+#include "lib/commands.h"
+#include "lib/command-socket.h"
+#include "lib/bluez-api.h"
+
+/* Seconds a client may take to send its request or read the reply */
+#define CLIENT_TIMEOUT 5
+
+static GMainLoop *mainloop = NULL;
+
+static GString *captured_stdout = NULL;
+static GString *captured_stderr = NULL;
+
+static void _capture_stdout(const gchar *string)
+{
+    g_string_append(captured_stdout, string);
+}
+
+static void _capture_stderr(const gchar *string)
+{
+    g_string_append(captured_stderr, string);
+}
+
+/* Parse a forwarded argv with the tool's own option syntax; FALSE means "let the client do it" */
+static gboolean _parse_args(GOptionEntry *entries, gchar **argv, int *argc, gchar ***args)
+{
+    GOptionContext *context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_set_help_enabled(context, FALSE);
+
+    /* The option parser reorders the vector, keep the strings owned by argv */
+    *argc = g_strv_length(argv);
+    *args = g_new0(gchar *, *argc + 1);
+    memcpy(*args, argv, *argc * sizeof(gchar *));
+
+    gboolean ret = g_option_context_parse(context, argc, args, NULL);
+    g_option_context_free(context);
+
+    return ret;
+}
+
+/* A forwarded --timeout bounds the whole request, not each call it makes */
+static gboolean _set_request_deadline(const gchar *value)
+{
+    gint timeout_msec = 0;
+    if (!dbus_call_timeout_parse(value, &timeout_msec, NULL))
+        return FALSE;
+
+    dbus_set_call_deadline(g_get_monotonic_time() + (gint64) timeout_msec * 1000);
+    return TRUE;
+}
+
+static int _run_bt_adapter(gchar **argv)
+{
+    gboolean list_arg = FALSE;
+    gchar *adapter_arg = NULL;
+    gboolean info_arg = FALSE;
+    gboolean discover_arg = FALSE;
+    gboolean set_arg = FALSE;
+    gchar *timeout_arg = NULL;
+    int status = COMMAND_SOCKET_FALLBACK;
+    gchar **args = NULL;
+    int argc = 0;
+
+    GOptionEntry entries[] = {
+        {"list", 'l', 0, G_OPTION_ARG_NONE, &list_arg, NULL, NULL},
+        {"adapter", 'a', 0, G_OPTION_ARG_STRING, &adapter_arg, NULL, NULL},
+        {"info", 'i', 0, G_OPTION_ARG_NONE, &info_arg, NULL, NULL},
+        {"discover", 'd', 0, G_OPTION_ARG_NONE, &discover_arg, NULL, NULL},
+        {"set", 's', 0, G_OPTION_ARG_NONE, &set_arg, NULL, NULL},
+        {"timeout", 0, 0, G_OPTION_ARG_STRING, &timeout_arg, NULL, NULL},
+        {NULL}
+    };
+
+    if (!_parse_args(entries, argv, &argc, &args))
+        goto out;
+
+    /* Discovery waits on the radio for its whole duration: not worth tying up the daemon */
+    if (discover_arg)
+        goto out;
+    if (timeout_arg && !_set_request_deadline(timeout_arg))
+        goto out;
+
+    if (list_arg)
+    {
+        status = adapter_command_list() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (info_arg)
+    {
+        status = adapter_command_info(adapter_arg) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (set_arg && argc == 3 && strlen(args[1]) > 0 && strlen(args[2]) > 0)
+    {
+        GVariant *v = adapter_property_value_parse(args[1], args[2], NULL);
+        if (v == NULL)
+            goto out;
+
+        g_variant_ref_sink(v);
+        status = adapter_command_set(adapter_arg, args[1], v) ? EXIT_SUCCESS : EXIT_FAILURE;
+        g_variant_unref(v);
+    }
+
+out:
+    g_free(adapter_arg);
+    g_free(timeout_arg);
+    g_free(args);
+    return status;
+}
+
+static int _run_bt_device(gchar **argv)
+{
+    gchar *adapter_arg = NULL;
+    gboolean list_arg = FALSE;
+    gchar *connect_arg = NULL;
+    gchar *disconnect_arg = NULL;
+    gchar *remove_arg = NULL;
+    gchar *info_arg = NULL;
+    gboolean services_arg = FALSE;
+    gboolean set_arg = FALSE;
+    gboolean verbose_arg = FALSE;
+    gchar *timeout_arg = NULL;
+    gint retries_arg = 0;
+    int status = COMMAND_SOCKET_FALLBACK;
+    gchar **args = NULL;
+    int argc = 0;
+
+    GOptionEntry entries[] = {
+        {"adapter", 'a', 0, G_OPTION_ARG_STRING, &adapter_arg, NULL, NULL},
+        {"list", 'l', 0, G_OPTION_ARG_NONE, &list_arg, NULL, NULL},
+        {"connect", 'c', 0, G_OPTION_ARG_STRING, &connect_arg, NULL, NULL},
+        {"disconnect", 'd', 0, G_OPTION_ARG_STRING, &disconnect_arg, NULL, NULL},
+        {"remove", 'r', 0, G_OPTION_ARG_STRING, &remove_arg, NULL, NULL},
+        {"info", 'i', 0, G_OPTION_ARG_STRING, &info_arg, NULL, NULL},
+        {"services", 's', 0, G_OPTION_ARG_NONE, &services_arg, NULL, NULL},
+        {"set", 0, 0, G_OPTION_ARG_NONE, &set_arg, NULL, NULL},
+        {"verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose_arg, NULL, NULL},
+        {"timeout", 0, 0, G_OPTION_ARG_STRING, &timeout_arg, NULL, NULL},
+        /* Only pairing retries, and pairing always runs in the client */
+        {"retries", 0, 0, G_OPTION_ARG_INT, &retries_arg, NULL, NULL},
+        {NULL}
+    };
+
+    if (!_parse_args(entries, argv, &argc, &args))
+        goto out;
+
+    /* Pairing needs an agent and SDP browsing runs sdptool: both stay with the client */
+    if (connect_arg || services_arg)
+        goto out;
+    if (timeout_arg && !_set_request_deadline(timeout_arg))
+        goto out;
+
+    if (list_arg)
+    {
+        status = device_command_list(adapter_arg) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (disconnect_arg && strlen(disconnect_arg) > 0)
+    {
+        status = device_command_disconnect(adapter_arg, disconnect_arg) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (remove_arg && strlen(remove_arg) > 0)
+    {
+        status = device_command_remove(adapter_arg, remove_arg) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (info_arg && strlen(info_arg) > 0)
+    {
+        status = device_command_info(adapter_arg, info_arg) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if (set_arg && argc == 4 && strlen(args[1]) > 0 && strlen(args[2]) > 0 && strlen(args[3]) > 0)
+    {
+        GVariant *v = device_property_value_parse(args[2], args[3], NULL);
+        if (v == NULL)
+            goto out;
+
+        g_variant_ref_sink(v);
+        status = device_command_set(adapter_arg, args[1], args[2], v) ? EXIT_SUCCESS : EXIT_FAILURE;
+        g_variant_unref(v);
+    }
+
+out:
+    g_free(adapter_arg);
+    g_free(connect_arg);
+    g_free(disconnect_arg);
+    g_free(remove_arg);
+    g_free(info_arg);
+    g_free(timeout_arg);
+    g_free(args);
+    return status;
+}
+
+static GVariant *_handle_request(GVariant *request)
+{
+    const gchar *tool = NULL;
+    gchar **argv = NULL;
+    int status = COMMAND_SOCKET_FALLBACK;
+
+    g_variant_get(request, "(&s^as)", &tool, &argv);
+
+    captured_stdout = g_string_new(NULL);
+    captured_stderr = g_string_new(NULL);
+    GPrintFunc old_print = g_set_print_handler(_capture_stdout);
+    GPrintFunc old_printerr = g_set_printerr_handler(_capture_stderr);
+
+    /* bt-network keeps its connection (or server) open for its lifetime, it always runs in the client */
+    if (g_strv_length(argv) > 0)
+    {
+        if (g_strcmp0(tool, "bt-adapter") == 0)
+            status = _run_bt_adapter(argv);
+        else if (g_strcmp0(tool, "bt-device") == 0)
+            status = _run_bt_device(argv);
+    }
+
+    dbus_set_call_deadline(0);
+    g_set_print_handler(old_print);
+    g_set_printerr_handler(old_printerr);
+
+    GVariant *reply;
+    if (status == COMMAND_SOCKET_FALLBACK)
+        reply = g_variant_new("(iss)", status, "", "");
+    else
+        reply = g_variant_new("(iss)", status, captured_stdout->str, captured_stderr->str);
+
+    g_string_free(captured_stdout, TRUE);
+    g_string_free(captured_stderr, TRUE);
+    captured_stdout = NULL;
+    captured_stderr = NULL;
+    g_strfreev(argv);
+
+    return reply;
+}
+
+/*
+ * One client, from its request to our reply. Both transfers are asynchronous
+ * so a client that stalls only holds up its own connection; requests
+ * themselves still run one at a time, they share the print capture above.
+ */
+typedef struct {
+    GSocketConnection *connection;
+    GCancellable *cancellable;  /* cancelled when the client runs out of CLIENT_TIMEOUT */
+    guint timeout_id;
+} DaemonClient;
+
+static void _client_free(DaemonClient *client)
+{
+    if (client->timeout_id)
+        g_source_remove(client->timeout_id);
+    g_object_unref(client->cancellable);
+    g_object_unref(client->connection);
+    g_free(client);
+}
+
+static gboolean _client_timeout(gpointer user_data)
+{
+    DaemonClient *client = user_data;
+    client->timeout_id = 0;
+    g_cancellable_cancel(client->cancellable);
+    return G_SOURCE_REMOVE;
+}
+
+/* (Re)start the clock on the client's side of the exchange */
+static void _client_wait(DaemonClient *client)
+{
+    if (client->timeout_id)
+        g_source_remove(client->timeout_id);
+    client->timeout_id = g_timeout_add_seconds(CLIENT_TIMEOUT, _client_timeout, client);
+}
+
+static void _reply_written(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    DaemonClient *client = user_data;
+    GError *error = NULL;
+
+    if (!command_socket_write_message_finish(G_OUTPUT_STREAM(source_object), res, &error))
+    {
+        g_printerr("Couldn't send reply: %s\n", error->message);
+        g_error_free(error);
+    }
+
+    _client_free(client);
+}
+
+static void _request_read(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    DaemonClient *client = user_data;
+    GError *error = NULL;
+
+    GVariant *request = command_socket_read_message_finish(G_INPUT_STREAM(source_object), res, &error);
+    if (request == NULL)
+    {
+        g_printerr("Bad request: %s\n", error->message);
+        g_error_free(error);
+        _client_free(client);
+        return;
+    }
+
+    /* Our own time, not the client's */
+    if (client->timeout_id)
+        g_source_remove(client->timeout_id);
+    client->timeout_id = 0;
+
+    /* A client that gives up (or a SIGTERM) cancels the calls of its request */
+    GCancellable *request_cancellable = g_cancellable_new();
+    dbus_set_call_cancellable(request_cancellable);
+    GSource *hangup = dbus_cancel_calls_on_hangup(g_socket_connection_get_socket(client->connection));
+
+    GVariant *reply = _handle_request(request);
+    g_variant_unref(request);
+
+    g_source_destroy(hangup);
+    g_source_unref(hangup);
+    dbus_set_call_cancellable(NULL);
+    g_object_unref(request_cancellable);
+
+    _client_wait(client);
+    command_socket_write_message_async(g_io_stream_get_output_stream(G_IO_STREAM(client->connection)), reply, client->cancellable, _reply_written, client);
+}
+
+static gboolean _incoming_connection(GSocketService *service, GSocketConnection *connection, GObject *source_object, gpointer user_data)
+{
+    DaemonClient *client = g_new0(DaemonClient, 1);
+    client->connection = g_object_ref(connection);
+    client->cancellable = g_cancellable_new();
+
+    _client_wait(client);
+    command_socket_read_message_async(g_io_stream_get_input_stream(G_IO_STREAM(connection)), COMMAND_SOCKET_REQUEST_TYPE, client->cancellable, _request_read, client);
+
+    return TRUE;
+}
+
+static gboolean term_signal_handler(gpointer data)
+{
+    if (g_main_loop_is_running(mainloop))
+        g_main_loop_quit(mainloop);
+
+    return G_SOURCE_REMOVE;
+}
+
+static gchar *socket_arg = NULL;
+static gboolean daemon_arg = FALSE;
+static gchar *timeout_arg = NULL;
+
+static GOptionEntry entries[] = {
+    {"socket", 'S', 0, G_OPTION_ARG_FILENAME, &socket_arg, "Path to the command socket", "<path>"},
+    {"daemon", 'd', 0, G_OPTION_ARG_NONE, &daemon_arg, "Run in background (as daemon)", NULL},
+    {"timeout", 0, 0, G_OPTION_ARG_STRING, &timeout_arg, "Give up on a bluetooth call after this many seconds", "<sec>"},
+    {NULL}
+};
+
+int main(int argc, char *argv[])
+{
+    GError *error = NULL;
+    GOptionContext *context;
+
+    /* Query current locale */
+    setlocale(LC_CTYPE, "");
+
+    dbus_init();
+
+    context = g_option_context_new("- a bluez-tools command server");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_set_summary(context, "Version "PACKAGE_VERSION);
+    g_option_context_set_description(context,
+                                     "Keeps the bus connection and the BlueZ object tree warm, and runs\n"
+                                     "bt-adapter and bt-device commands forwarded over a UNIX socket.\n"
+                                     "Tools forward their commands when "COMMAND_SOCKET_ENV" is set\n"
+                                     "(to the socket path, or empty for the default one).\n\n"
+                                     "Report bugs to <"PACKAGE_BUGREPORT">."
+                                     "Project home page <"PACKAGE_URL">."
+                                     );
+
+    if (!g_option_context_parse(context, &argc, &argv, &error))
+    {
+        g_print("%s: %s\n", g_get_prgname(), error->message);
+        g_print("Try `%s --help` for more information.\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+
+    g_option_context_free(context);
+
+    gint timeout_msec = -1;
+    if (timeout_arg && !dbus_call_timeout_parse(timeout_arg, &timeout_msec, &error))
+        exit_if_error(error);
+    dbus_set_call_timeout(timeout_msec);
+
+    if (!socket_arg)
+    {
+        const gchar *socket_env = g_getenv(COMMAND_SOCKET_ENV);
+        socket_arg = socket_env && strlen(socket_env) > 0 ? g_strdup(socket_env) : command_socket_default_path();
+    }
+
+    if (daemon_arg)
+    {
+        pid_t pid, sid;
+
+        /* Fork before any bus connection exists, GDBus worker threads don't survive fork() */
+        pid = fork();
+        if (pid < 0)
+            exit(EXIT_FAILURE);
+        /* Ok, terminate parent proccess */
+        if (pid > 0)
+            exit(EXIT_SUCCESS);
+
+        /* Create a new SID for the child process */
+        sid = setsid();
+        if (sid < 0)
+            exit(EXIT_FAILURE);
+
+        /* Close out the standard file descriptors */
+        close(STDIN_FILENO);
+        close(STDOUT_FILENO);
+        close(STDERR_FILENO);
+    }
+
+    if (!dbus_system_connect(&error))
+    {
+        g_printerr("Couldn't connect to DBus system bus: %s\n", error->message);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Check, that bluetooth daemon is running */
+    if (!intf_supported(BLUEZ_DBUS_SERVICE_NAME, MANAGER_DBUS_PATH, MANAGER_DBUS_INTERFACE))
+    {
+        g_printerr("%s: bluez service is not found\n", g_get_prgname());
+        g_printerr("Did you forget to run bluetoothd?\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ObjectModel *model = object_model_new(&error);
+    exit_if_error(error);
+    object_model_set_default(model);
+
+    /* A socket left over by a previous instance would make bind() fail */
+    g_unlink(socket_arg);
+
+    GSocketService *service = g_socket_service_new();
+    GSocketAddress *address = g_unix_socket_address_new(socket_arg);
+    g_socket_listener_add_address(G_SOCKET_LISTENER(service), address, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, NULL, NULL, &error);
+    g_object_unref(address);
+    exit_if_error(error);
+
+    /* Commands run with our bus credentials: only the owner may connect */
+    if (g_chmod(socket_arg, S_IRUSR | S_IWUSR) != 0)
+    {
+        g_printerr("%s: Couldn't set permissions on %s\n", g_get_prgname(), socket_arg);
+        g_unlink(socket_arg);
+        exit(EXIT_FAILURE);
+    }
+
+    g_signal_connect(service, "incoming", G_CALLBACK(_incoming_connection), NULL);
+    g_socket_service_start(service);
+
+    mainloop = g_main_loop_new(NULL, FALSE);
+
+    /* Add SIGTERM/SIGINT handlers, the request in flight is cancelled first */
+    g_unix_signal_add(SIGTERM, term_signal_handler, NULL);
+    g_unix_signal_add(SIGINT, term_signal_handler, NULL);
+    dbus_cancel_calls_on_signal(SIGTERM);
+    dbus_cancel_calls_on_signal(SIGINT);
+    /* Each request brings its own cancellable, there is nothing to cancel in between */
+    dbus_set_call_cancellable(NULL);
+
+    g_print("Listening on %s\n", socket_arg);
+    g_main_loop_run(mainloop);
+
+    g_socket_service_stop(service);
+    g_socket_listener_close(G_SOCKET_LISTENER(service));
+    g_object_unref(service);
+    g_unlink(socket_arg);
+    g_free(socket_arg);
+
+    g_main_loop_unref(mainloop);
+    object_model_set_default(NULL);
+    g_object_unref(model);
+    dbus_disconnect();
+
+    exit(EXIT_SUCCESS);
+}
@@ -36,6 +36,10 @@
 
 #include "lib/dbus-common.h"
 #include "lib/helpers.h"
+#include "lib/commands.h"
+#include "lib/command-socket.h"
+#include "lib/batch.h"
+#include "lib/retry.h"
 #include "lib/agent-helper.h"
 #include "lib/sdp.h"
 #include "lib/bluez-api.h"
@@ -69,7 +73,9 @@ static gboolean set_arg = FALSE;
 static gchar *set_device_arg = NULL;
 static gchar *set_property_arg = NULL;
 static gchar *set_value_arg = NULL;
+static gchar *batch_arg = NULL;
 static gboolean verbose_arg = FALSE;
+static gint retries_arg = 0;
 
 static gboolean is_verbose_attr(int attr_id)
 {
@@ -288,13 +294,32 @@ static void create_paired_device_done(gpointer data)
     g_main_loop_quit(mainloop);
 }
 
+static void _bt_device_pair_callback(GObject *source_object, GAsyncResult *res, gpointer user_data);
+
+static gboolean _bt_device_pair_retry(gpointer user_data)
+{
+    GHashTable *dict = (GHashTable *) user_data;
+    Device *device = (Device *) g_hash_table_lookup(dict, "device");
+    device_pair_async(device, (GAsyncReadyCallback) _bt_device_pair_callback, user_data);
+    return FALSE;
+}
+
 static void _bt_device_pair_callback(GObject *source_object, GAsyncResult *res, gpointer user_data)
 {
     g_assert(user_data != NULL);
     GHashTable *dict = (GHashTable *) user_data;
     Device *device = (Device *) g_hash_table_lookup(dict, "device");
+    RetryState *retry = (RetryState *) g_hash_table_lookup(dict, "retry");
     GError *error = NULL;
+    guint delay = 0;
     device_pair_finish(device, res, &error);
+    if (error && retry_state_next(retry, error, &delay))
+    {
+        g_printerr("%s, retrying in %u ms\n", error->message, delay);
+        g_error_free(error);
+        g_timeout_add(delay, _bt_device_pair_retry, user_data);
+        return;
+    }
     exit_if_error(error);
     GMainLoop *mainloop = (GMainLoop *) g_hash_table_lookup(dict, "mainloop");
     g_main_loop_quit(mainloop);
@@ -421,6 +446,7 @@ static GHashTable *_bt_device_sdp_browse(const gchar *device_path, const gchar *
     
     return sdp_hash_table;
 }
+static gchar *timeout_arg = NULL;
 
 static GOptionEntry entries[] = {
     {"adapter", 'a', 0, G_OPTION_ARG_STRING, &adapter_arg, "Adapter Name or MAC", "<name|mac>"},
@@ -431,7 +457,10 @@ static GOptionEntry entries[] = {
     {"info", 'i', 0, G_OPTION_ARG_STRING, &info_arg, "Get info about device", "<name|mac>"},
     {"services", 's', 0, G_OPTION_ARG_NONE, &services_arg, "Discover device services", NULL},
     {"set", 0, 0, G_OPTION_ARG_NONE, &set_arg, "Set device property", NULL},
+    {"batch", 0, 0, G_OPTION_ARG_FILENAME, &batch_arg, "Read commands from a file (- for stdin)", "<file|->"},
     {"verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose_arg, "Verbosely display remote service records", NULL},
+    {"retries", 0, 0, G_OPTION_ARG_INT, &retries_arg, "Retry transient errors up to n times (default 0)", "<n>"},
+    {"timeout", 0, 0, G_OPTION_ARG_STRING, &timeout_arg, "Give up on a bluetooth call after this many seconds", "<sec>"},
     {NULL}
 };
 
@@ -443,6 +472,11 @@ int main(int argc, char *argv[])
     /* Query current locale */
     setlocale(LC_CTYPE, "");
 
+    /* Let a running bt-daemon execute the command if we are asked to */
+    int forwarded_status = EXIT_SUCCESS;
+    if (command_socket_forward("bt-device", argc, argv, &forwarded_status))
+        exit(forwarded_status);
+
     /* Deprecated */
     // g_type_init();
     dbus_init();
@@ -462,6 +496,14 @@ int main(int argc, char *argv[])
                                      "       Alias\n"
                                      "       Trusted\n"
                                      "       Blocked\n\n"
+                                     "Batch Options:\n"
+                                     "  --batch <file|->\n"
+                                     "  Runs one command per line, each one of:\n"
+                                     "     list\n"
+                                     "     info <name|mac>\n"
+                                     "     set <name|mac> <property> <value>\n"
+                                     "     remove <name|mac>\n"
+                                     "     disconnect <name|mac>\n\n"
                                      "Report bugs to <"PACKAGE_BUGREPORT">."
                                      "Project home page <"PACKAGE_URL">."
                                      );
@@ -472,7 +514,7 @@ int main(int argc, char *argv[])
         g_print("Try `%s --help` for more information.\n", g_get_prgname());
         exit(EXIT_FAILURE);
     }
-    else if (!list_arg && (!connect_arg || strlen(connect_arg) == 0) && (!disconnect_arg || strlen(disconnect_arg) == 0) && (!remove_arg || strlen(remove_arg) == 0) && (!info_arg || strlen(info_arg) == 0) && !services_arg && !set_arg)
+    else if (!list_arg && (!connect_arg || strlen(connect_arg) == 0) && (!disconnect_arg || strlen(disconnect_arg) == 0) && (!remove_arg || strlen(remove_arg) == 0) && (!info_arg || strlen(info_arg) == 0) && !services_arg && !set_arg && !batch_arg)
     {
         g_print("%s", g_option_context_get_help(context, FALSE, NULL));
         exit(EXIT_FAILURE);
@@ -489,9 +531,20 @@ int main(int argc, char *argv[])
         g_print("Try `%s --help` for more information.\n", g_get_prgname());
         exit(EXIT_FAILURE);
     }
+    else if (retries_arg < 0)
+    {
+        g_print("%s: Invalid value for --retries\n", g_get_prgname());
+        g_print("Try `%s --help` for more information.\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
 
     g_option_context_free(context);
 
+    gint timeout_msec = -1;
+    if (timeout_arg && !dbus_call_timeout_parse(timeout_arg, &timeout_msec, &error))
+        exit_if_error(error);
+    dbus_set_call_timeout(timeout_msec);
+
     if (!dbus_system_connect(&error))
     {
         g_printerr("Couldn't connect to DBus system bus: %s\n", error->message);
@@ -510,26 +563,15 @@ int main(int argc, char *argv[])
     Adapter *adapter = find_adapter(adapter_arg, &error);
     exit_if_error(error);
 
-    if (list_arg)
+    if (batch_arg)
     {
-        const gchar **devices_list = manager_get_devices(manager, adapter_get_dbus_object_path(adapter));
-
-        if (devices_list == NULL)
-        {
-            g_print("No devices found\n");
+        if (!batch_run(BATCH_DEVICE, adapter_arg, batch_arg))
+            exit(EXIT_FAILURE);
+    }
+    else if (list_arg)
+    {
+        if (!device_command_list(adapter_arg))
             exit(EXIT_FAILURE);
-        }
-
-        g_print("Added devices:\n");
-        const gchar **devices = NULL;
-        for (devices = devices_list; *devices != NULL; devices++)
-        {
-            const gchar *device_path = *devices;
-            Device *device = device_new(device_path);
-            g_print("%s (%s)\n", device_get_alias(device, &error), device_get_address(device, &error));
-            exit_if_error(error);
-            g_object_unref(device);
-        }
     }
     else if (connect_arg)
     {
@@ -554,82 +596,41 @@ int main(int argc, char *argv[])
             exit(EXIT_FAILURE);
         }
         
+        RetryPolicy retry_policy = RETRY_POLICY_DEFAULT;
+        retry_policy.max_attempts = retries_arg + 1;
+        /* --timeout bounds the pairing, retries included */
+        retry_policy.budget = timeout_msec > 0 ? timeout_msec : 0;
+        RetryState *retry = retry_state_new(&retry_policy);
+
         GHashTable *user_data_hash = g_hash_table_new(g_str_hash, g_str_equal);
         g_hash_table_insert(user_data_hash, "device", device);
         g_hash_table_insert(user_data_hash, "mainloop", mainloop);
+        g_hash_table_insert(user_data_hash, "retry", retry);
         
         device_pair_async(device, (GAsyncReadyCallback) _bt_device_pair_callback, (gpointer) user_data_hash);
         g_main_loop_run(mainloop);
         
         g_print("Done\n");
         g_hash_table_unref(user_data_hash);
+        retry_state_free(retry);
         g_main_loop_unref(mainloop);
         g_object_unref(device);
         unregister_agent_callbacks(&error);
     }
     else if (disconnect_arg)
     {
-        Device *device = find_device(adapter, disconnect_arg, &error);
-        exit_if_error(error);
-        if(!device)
-        {
-            g_printerr("Error: Device not found.\n");
+        if (!device_command_disconnect(adapter_arg, disconnect_arg))
             exit(EXIT_FAILURE);
-        }
-
-        g_print("Disconnecting: %s\n", disconnect_arg);
-        device_disconnect(device, &error);
-        exit_if_error(error);
-
-        g_print("Done\n");
-        g_object_unref(device);
     }
     else if (remove_arg)
     {
-        Device *device = find_device(adapter, remove_arg, &error);
-        exit_if_error(error);
-        if(!device)
-        {
-            g_printerr("Error: Device not found.\n");
+        if (!device_command_remove(adapter_arg, remove_arg))
             exit(EXIT_FAILURE);
-        }
-        
-        adapter_remove_device(adapter, device_get_dbus_object_path(device), &error);
-        exit_if_error(error);
-
-        g_print("Done\n");
-        g_object_unref(device);
     }
     else if (info_arg)
     {
-        Device *device = find_device(adapter, info_arg, &error);
-        exit_if_error(error);
-        if(!device)
-        {
-            g_printerr("Error: Device not found.\n");
+        if (!device_command_info(adapter_arg, info_arg))
             exit(EXIT_FAILURE);
-        }
-
-        g_print("[%s]\n", device_get_address(device, NULL));
-        g_print("  Name: %s\n", device_get_name(device, NULL));
-        g_print("  Alias: %s [rw]\n", device_get_alias(device, NULL));
-        g_print("  Address: %s\n", device_get_address(device, NULL));
-        g_print("  Icon: %s\n", device_get_icon(device, NULL));
-        g_print("  Class: 0x%x\n", device_get_class(device, NULL));
-        g_print("  Paired: %d\n", device_get_paired(device, NULL));
-        g_print("  Trusted: %d [rw]\n", device_get_trusted(device, NULL));
-        g_print("  Blocked: %d [rw]\n", device_get_blocked(device, NULL));
-        g_print("  Connected: %d\n", device_get_connected(device, NULL));
-        g_print("  UUIDs: [");
-        const gchar **uuids = device_get_uuids(device, NULL);
-        for (int j = 0; uuids[j] != NULL; j++)
-        {
-            if (j > 0) g_print(", ");
-            g_print("%s", uuid2name(uuids[j]));
-        }
-        g_print("]\n");
-
-        g_object_unref(device);
     }
     else if (services_arg)
     {
@@ -686,73 +687,18 @@ int main(int argc, char *argv[])
         set_property_arg = argv[2];
         set_value_arg = argv[3];
 
-        Device *device = find_device(adapter, set_device_arg, &error);
-        exit_if_error(error);
-        if(!device)
-        {
-            g_printerr("Error: Device not found.\n");
-            exit(EXIT_FAILURE);
-        }
-
-        GVariant *v = NULL;
-
-        if (g_strcmp0(set_property_arg, "Alias") == 0)
-        {
-            v = g_variant_new_string(set_value_arg);
-        }
-        else if (
-                g_strcmp0(set_property_arg, "Trusted") == 0 ||
-                g_strcmp0(set_property_arg, "Blocked") == 0
-                )
+        GVariant *v = device_property_value_parse(set_property_arg, set_value_arg, &error);
+        if (v == NULL)
         {
-            if (g_strcmp0(set_value_arg, "0") == 0 || g_ascii_strcasecmp(set_value_arg, "FALSE") == 0 || g_ascii_strcasecmp(set_value_arg, "OFF") == 0)
-            {
-                v = g_variant_new_boolean(FALSE);
-            }
-            else if (g_strcmp0(set_value_arg, "1") == 0 || g_ascii_strcasecmp(set_value_arg, "TRUE") == 0 || g_ascii_strcasecmp(set_value_arg, "ON") == 0)
-            {
-                v = g_variant_new_boolean(TRUE);
-            }
-            else
-            {
-                g_print("%s: Invalid boolean value: %s\n", g_get_prgname(), set_value_arg);
-                g_print("Try `%s --help` for more information.\n", g_get_prgname());
-                exit(EXIT_FAILURE);
-            }
-        }
-        else
-        {
-            g_print("%s: Invalid property: %s\n", g_get_prgname(), set_property_arg);
+            g_print("%s: %s\n", g_get_prgname(), error->message);
             g_print("Try `%s --help` for more information.\n", g_get_prgname());
             exit(EXIT_FAILURE);
         }
 
-        GVariant *props = device_get_properties(device, &error);
-        exit_if_error(error);
-        
-        if(g_ascii_strcasecmp(set_property_arg, "Alias") == 0)
-            device_set_alias(device, g_variant_get_string(v, NULL), &error);
-        else if(g_ascii_strcasecmp(set_property_arg, "Blocked") == 0)
-            device_set_blocked(device, g_variant_get_boolean(v), &error);
-        else if(g_ascii_strcasecmp(set_property_arg, "Trusted") == 0)
-            device_set_trusted(device, g_variant_get_boolean(v), &error);
-        
-        exit_if_error(error);
-        
-        GVariant *old_value = g_variant_lookup_value(props, set_property_arg, NULL);
-        g_assert(old_value != NULL);
-        if (g_variant_type_equal(G_VARIANT_TYPE_STRING, g_variant_get_type(old_value)))
-        {
-            g_print("%s: %s -> %s\n", set_property_arg, g_variant_get_string(old_value, NULL), g_variant_get_string(v, NULL));
-        }
-        else if (g_variant_type_equal(G_VARIANT_TYPE_BOOLEAN, g_variant_get_type(old_value)))
-        {
-            g_print("%s: %u -> %u\n", set_property_arg, g_variant_get_boolean(old_value), g_variant_get_boolean(v));
-        }
-        g_variant_unref(props);
-
-        // g_variant_unref(v); /* Floating references do not need to be unref */
-        g_object_unref(device);
+        g_variant_ref_sink(v);
+        if (!device_command_set(adapter_arg, set_device_arg, set_property_arg, v))
+            exit(EXIT_FAILURE);
+        g_variant_unref(v);
     }
 
     g_object_unref(adapter);
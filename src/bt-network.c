@@ -35,6 +35,7 @@
 
 #include "lib/dbus-common.h"
 #include "lib/helpers.h"
+#include "lib/retry.h"
 #include "lib/bluez-api.h"
 
 static GMainLoop *mainloop = NULL;
@@ -84,6 +85,41 @@ static void _bt_network_property_changed(GDBusConnection *connection, const gcha
 	}
 }
 
+/* Server mode: report clients of our adapter as they come and go, resolved from the object model */
+static void _bt_network_server_device_changed(ObjectModel *model, const gchar *object_path, const gchar *interface_name, GVariant *changed_properties, gpointer user_data)
+{
+	const gchar *adapter_path = user_data;
+	gboolean connected = FALSE;
+
+	if (g_strcmp0(interface_name, DEVICE_DBUS_INTERFACE) != 0 || !g_variant_lookup(changed_properties, "Connected", "b", &connected))
+		return;
+	if (g_strcmp0(object_model_get_string(model, object_path, DEVICE_DBUS_INTERFACE, "Adapter"), adapter_path) != 0)
+		return;
+
+	g_print("%s (%s) %s\n",
+		object_model_get_string(model, object_path, DEVICE_DBUS_INTERFACE, "Alias"),
+		object_model_get_string(model, object_path, DEVICE_DBUS_INTERFACE, "Address"),
+		connected ? "connected" : "disconnected");
+}
+
+typedef struct {
+	Network *network;
+	const gchar *uuid;
+} NetworkConnectData;
+
+static gboolean _bt_network_connect(gpointer user_data, GError **error)
+{
+	NetworkConnectData *data = user_data;
+	GError *connect_error = NULL;
+
+	network_connect(data->network, data->uuid, &connect_error);
+	if (connect_error) {
+		g_propagate_error(error, connect_error);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static gchar *adapter_arg = NULL;
 static gboolean connect_arg = FALSE;
 static gchar *connect_device_arg = NULL;
@@ -92,12 +128,16 @@ static gboolean server_arg = FALSE;
 static gchar *server_uuid_arg = NULL;
 static gchar *server_brige_arg = NULL;
 static gboolean daemon_arg = FALSE;
+static gchar *timeout_arg = NULL;
+static gint retries_arg = 0;
 
 static GOptionEntry entries[] = {
 	{"adapter", 'a', 0, G_OPTION_ARG_STRING, &adapter_arg, "Adapter Name or MAC", "<name|mac>"},
 	{"connect", 'c', 0, G_OPTION_ARG_NONE, &connect_arg, "Connect to the network device", NULL},
 	{"server", 's', 0, G_OPTION_ARG_NONE, &server_arg, "Start GN/PANU/NAP server", NULL},
 	{"daemon", 'd', 0, G_OPTION_ARG_NONE, &daemon_arg, "Run in background (as daemon)"},
+	{"retries", 0, 0, G_OPTION_ARG_INT, &retries_arg, "Retry transient errors up to n times (default 0)", "<n>"},
+	{"timeout", 0, 0, G_OPTION_ARG_STRING, &timeout_arg, "Give up on a bluetooth call after this many seconds", "<sec>"},
 	{NULL}
 };
 
@@ -139,6 +179,10 @@ int main(int argc, char *argv[])
 		g_print("%s: Invalid arguments for --connect\n", g_get_prgname());
 		g_print("Try `%s --help` for more information.\n", g_get_prgname());
 		exit(EXIT_FAILURE);
+	} else if (retries_arg < 0) {
+		g_print("%s: Invalid value for --retries\n", g_get_prgname());
+		g_print("Try `%s --help` for more information.\n", g_get_prgname());
+		exit(EXIT_FAILURE);
 	} else if (server_arg && (argc != 3 || strlen(argv[1]) == 0 || strlen(argv[2]) == 0)) {
 		g_print("%s: Invalid arguments for --server\n", g_get_prgname());
 		g_print("Try `%s --help` for more information.\n", g_get_prgname());
@@ -147,6 +191,11 @@ int main(int argc, char *argv[])
 
 	g_option_context_free(context);
 
+	gint timeout_msec = -1;
+	if (timeout_arg && !dbus_call_timeout_parse(timeout_arg, &timeout_msec, &error))
+		exit_if_error(error);
+	dbus_set_call_timeout(timeout_msec);
+
 	if (!dbus_system_connect(&error)) {
 		g_printerr("Couldn't connect to DBus system bus: %s\n", error->message);
 		exit(EXIT_FAILURE);
@@ -182,7 +231,12 @@ int main(int argc, char *argv[])
 		if (network_get_connected(network, NULL) == TRUE) {
 			g_print("Network service is already connected\n");
 		} else {
-			gchar *intf = (gchar *) network_connect(network, connect_uuid_arg, &error);
+			RetryPolicy retry_policy = RETRY_POLICY_DEFAULT;
+			retry_policy.max_attempts = retries_arg + 1;
+			/* --timeout bounds the connect, retries included */
+			retry_policy.budget = timeout_msec > 0 ? timeout_msec : 0;
+			NetworkConnectData connect_data = {network, connect_uuid_arg};
+			retry_run(&retry_policy, _bt_network_connect, &connect_data, &error);
 			exit_if_error(error);
 			trap_signals();
 			g_main_loop_run(mainloop);
@@ -191,7 +245,6 @@ int main(int argc, char *argv[])
 			if (network_get_connected(network, NULL) == TRUE) {
 				network_disconnect(network, NULL);
 			}
-			g_free(intf);
 		}
 
                 g_dbus_connection_signal_unsubscribe(system_conn, prop_sig_sub_id);
@@ -220,6 +273,11 @@ int main(int argc, char *argv[])
 		exit_if_error(error);
 		g_print("%s server registered\n", server_uuid_upper);
 
+		ObjectModel *model = object_model_new(&error);
+		exit_if_error(error);
+		object_model_set_default(model);
+		g_signal_connect(model, "properties-changed", G_CALLBACK(_bt_network_server_device_changed), (gpointer) adapter_get_dbus_object_path(adapter));
+
 		mainloop = g_main_loop_new(NULL, FALSE);
 
 		if (daemon_arg) {
@@ -255,6 +313,8 @@ int main(int argc, char *argv[])
 		g_main_loop_unref(mainloop);
 		g_free(server_uuid_upper);
 		g_object_unref(network_server);
+		object_model_set_default(NULL);
+		g_object_unref(model);
 	}
 
 	g_object_unref(adapter);
@@ -25,42 +25,275 @@
 #include <config.h>
 #endif
 
+#include <errno.h>
+#include <fcntl.h>
 #include <locale.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include <readline/readline.h>
 #include <readline/history.h>
 
 #include <gio/gio.h>
 #include <glib/gstdio.h>
+#include <glib-unix.h>
 
 #include "lib/dbus-common.h"
 #include "lib/helpers.h"
 #include "lib/bluez-api.h"
-
-static GHashTable *_transfers = NULL;
+#include "lib/file-move.h"
+#include "lib/ftp-cache.h"
+#include "lib/ftp-sync.h"
+#include "lib/progress.h"
+#include "lib/retry.h"
+#include "lib/transfer-manager.h"
+
+/* Transfer path -> ObexTransferInfo, all that progress handling needs without asking obexd */
 static GHashTable *_transfer_infos = NULL;
 static GMainLoop *mainloop = NULL;
 static gchar *_root_path = NULL;
-static gboolean _update_progress = FALSE;
+/* Progress lines of active transfers, redrawn a few times a second */
+static Progress *_progress = NULL;
+/* Suspends our client transfers on SIGUSR1 or a weak link, resumes them on SIGUSR2 */
+static TransferManager *_transfer_manager = NULL;
+static FileMoveSync _move_sync = FILE_MOVE_SYNC_NONE;
+/* Digest of received files, written to a manifest next to them; -1 for none */
+static gint _checksum_type = -1;
+static const gchar *_checksum_name = NULL;
+/* obexd objects, kept up to date in server mode */
+static ObjectModel *_obex_model = NULL;
+
+/* OPP client: every target gets the same files, one at a time over a session of its own */
+typedef enum {
+    OPP_TARGET_WAITING,     /* for a free session slot on its adapter */
+    OPP_TARGET_BACKOFF,     /* for its next attempt */
+    OPP_TARGET_CONNECTING,
+    OPP_TARGET_SENDING,
+    OPP_TARGET_DONE,        /* every file was sent or given up on */
+    OPP_TARGET_FAILED       /* never reached */
+} ObexOppTargetState;
+
+typedef struct {
+    gchar *name;            /* as given */
+    gchar *source;          /* adapter address */
+    gchar *address;
+    ObexOppTargetState state;
+    RetryState *retry;
+    gchar *session;
+    gchar *transfer;        /* being sent */
+    guint next;             /* index in _opp_files of the file being or to be sent */
+    guint sent;
+    guint failed;
+    guint64 bytes;
+    gint64 started;
+    gint64 finished;
+    gchar *error;           /* last one */
+} ObexOppTarget;
+
+static GPtrArray *_opp_files = NULL;    /* absolute paths */
+static GPtrArray *_opp_targets = NULL;
+/* Sending to several devices: results are reported per device */
+static gboolean _opp_broadcast = FALSE;
+static guint _opp_parallel = 1;         /* sessions at once per adapter */
+static RetryPolicy _opp_retry = RETRY_POLICY_DEFAULT;
+static gint64 _opp_started = 0;
 
 typedef struct _ObexTransferInfo ObexTransferInfo;
 
 struct _ObexTransferInfo {
     gchar *filename;
     guint64 filesize;
+    guint64 transferred;
+    gchar *session;
     gchar *obex_root;
     gchar *status;
+    /* Running digest of the cache file, `hashed` bytes in */
+    GChecksum *checksum;
+    gint fd;
+    guint64 hashed;
 };
 
-static void sigterm_handler(int sig)
+typedef struct {
+    gchar *filename;
+    gchar *digest;
+} ObexServerMove;
+
+static ObexTransferInfo *_transfer_info_new()
+{
+    ObexTransferInfo *info = g_new0(ObexTransferInfo, 1);
+    info->fd = -1;
+    return info;
+}
+
+static void _transfer_info_free(ObexTransferInfo *info)
+{
+    if (!info)
+        return;
+    if (info->fd >= 0)
+        close(info->fd);
+    if (info->checksum)
+        g_checksum_free(info->checksum);
+    g_free(info->filename);
+    g_free(info->session);
+    g_free(info->obex_root);
+    g_free(info->status);
+    g_free(info);
+}
+
+/* Takes whichever of Name/Size/Transferred/Status/Session are in the a{sv} `props` */
+static void _transfer_info_update(ObexTransferInfo *info, GVariant *props)
+{
+    gchar *value = NULL;
+
+    if (g_variant_lookup(props, "Name", "s", &value))
+    {
+        g_free(info->filename);
+        info->filename = value;
+    }
+    if (g_variant_lookup(props, "Status", "s", &value))
+    {
+        g_free(info->status);
+        info->status = value;
+    }
+    if (g_variant_lookup(props, "Session", "o", &value))
+    {
+        g_free(info->session);
+        info->session = value;
+    }
+    g_variant_lookup(props, "Size", "t", &info->filesize);
+    g_variant_lookup(props, "Transferred", "t", &info->transferred);
+}
+
+/* From the InterfacesAdded payload, which carries every property */
+static ObexTransferInfo *_transfer_info_add(const gchar *transfer_path, GVariant *props)
+{
+    ObexTransferInfo *info = _transfer_info_new();
+    _transfer_info_update(info, props);
+    g_hash_table_replace(_transfer_infos, g_strdup(transfer_path), info);
+    return info;
+}
+
+/* Cancels whatever is still running, on the way out */
+static void _transfer_infos_cancel_all()
+{
+    GHashTableIter iter;
+    gpointer key;
+
+    g_hash_table_iter_init(&iter, _transfer_infos);
+    while (g_hash_table_iter_next(&iter, &key, NULL))
+    {
+        ObexTransfer *t = obex_transfer_new(key);
+        obex_transfer_cancel(t, NULL); // skip errors
+        g_object_unref(t);
+    }
+    g_hash_table_remove_all(_transfer_infos);
+}
+
+/*
+ * Hash what obexd has written since the last call, up to `transferred`
+ * bytes, or to the end of the file when `transferred` is 0. The data was
+ * just written, so this reads from the page cache, and the digest is
+ * complete when the transfer is, without a second pass over the file.
+ */
+static void _transfer_checksum_update(ObexTransferInfo *info, guint64 transferred)
+{
+    if (_checksum_type < 0 || !info->filename || !info->obex_root)
+        return;
+
+    if (info->fd < 0)
+    {
+        gchar *path = g_build_filename(info->obex_root, info->filename, NULL);
+        info->fd = g_open(path, O_RDONLY | O_CLOEXEC, 0);
+        g_free(path);
+        if (info->fd < 0)
+            return;
+        info->checksum = g_checksum_new(_checksum_type);
+        info->hashed = 0;
+    }
+
+    guchar buffer[64 * 1024];
+    while (transferred == 0 || info->hashed < transferred)
+    {
+        gsize want = transferred ? MIN(sizeof(buffer), transferred - info->hashed) : sizeof(buffer);
+        ssize_t n = pread(info->fd, buffer, want, info->hashed);
+        if (n < 0 && errno == EINTR)
+            continue;
+        /* Not written yet, the next signal carries on from here */
+        if (n <= 0)
+            break;
+        g_checksum_update(info->checksum, buffer, n);
+        info->hashed += n;
+    }
+}
+
+/* Manifest in the format of sha256sum and friends, so `sha256sum -c` checks it */
+static void _write_manifest(const gchar *filename, const gchar *digest)
+{
+    GError *error = NULL;
+    gchar *basename = g_path_get_basename(filename);
+    gchar *manifest = g_strdup_printf("%s.%s", filename, _checksum_name);
+    gchar *contents = g_strdup_printf("%s  %s\n", digest, basename);
+
+    if (!g_file_set_contents(manifest, contents, -1, &error))
+    {
+        g_print("[OBEX Server] Can't write %s: %s\n", manifest, error->message);
+        g_error_free(error);
+    }
+
+    g_free(contents);
+    g_free(manifest);
+    g_free(basename);
+}
+
+static gchar *_obex_session_root(const gchar *session_path)
+{
+    if (_obex_model)
+    {
+        const gchar *root = object_model_get_string(_obex_model, session_path, OBEX_SESSION_DBUS_INTERFACE, "Root");
+        if (root)
+            return g_strdup(root);
+    }
+
+    ObexSession *session = obex_session_new(session_path);
+    gchar *root = g_strdup(obex_session_get_root(session, NULL));
+    g_object_unref(session);
+    return root;
+}
+
+static gboolean term_signal_handler(gpointer data)
 {
-    g_message("%s received", sig == SIGTERM ? "SIGTERM" : "SIGINT");
+    g_message("%s received", GPOINTER_TO_INT(data) == SIGTERM ? "SIGTERM" : "SIGINT");
 
     if (g_main_loop_is_running(mainloop))
         g_main_loop_quit(mainloop);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* A stuck call would hold up the handler: cancel it from aside, and not the cleanup that follows */
+static void _trap_signals()
+{
+    g_unix_signal_add(SIGTERM, term_signal_handler, GINT_TO_POINTER(SIGTERM));
+    g_unix_signal_add(SIGINT, term_signal_handler, GINT_TO_POINTER(SIGINT));
+    dbus_cancel_calls_on_signal(SIGTERM);
+    dbus_cancel_calls_on_signal(SIGINT);
+}
+
+static gboolean _suspend_signal_handler(gpointer user_data)
+{
+    g_print("Suspending transfers\n");
+    transfer_manager_suspend(_transfer_manager);
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean _resume_signal_handler(gpointer user_data)
+{
+    g_print("Resuming transfers\n");
+    transfer_manager_resume(_transfer_manager);
+    return G_SOURCE_CONTINUE;
 }
 
 static void _obex_server_object_manager_handler(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
@@ -74,19 +307,9 @@ static void _obex_server_object_manager_handler(GDBusConnection *connection, con
         if(g_variant_lookup(interfaces_and_properties, OBEX_TRANSFER_DBUS_INTERFACE, "@a{sv}", &properties))
         {
             g_print("[OBEX Server] Transfer started\n");
-            ObexTransfer *t = obex_transfer_new(interface_object_path);
-            g_hash_table_insert(_transfers, g_strdup(interface_object_path), t);
-            
-            ObexTransferInfo *info = g_malloc0(sizeof(ObexTransferInfo));
-            info->filesize = g_variant_get_uint64(g_variant_lookup_value(properties, "Size", NULL));
-            info->status = g_strdup(g_variant_get_string(g_variant_lookup_value(properties, "Status", NULL), NULL));
-            ObexSession *session = obex_session_new(g_variant_get_string(g_variant_lookup_value(properties, "Session", NULL), NULL));
-            
-            info->obex_root = g_strdup(obex_session_get_root(session, NULL));
-            
-            g_object_unref(session);
-            
-            g_hash_table_insert(_transfer_infos, g_strdup(interface_object_path), info);
+            ObexTransferInfo *info = _transfer_info_add(interface_object_path, properties);
+            if (info->session)
+                info->obex_root = _obex_session_root(info->session);
         }
         
         if(g_variant_lookup(interfaces_and_properties, OBEX_SESSION_DBUS_INTERFACE, "@a{sv}", &properties))
@@ -109,11 +332,8 @@ static void _obex_server_object_manager_handler(GDBusConnection *connection, con
         {
             if(g_strcmp0(*inf, OBEX_TRANSFER_DBUS_INTERFACE) == 0)
             {
+                progress_stop(_progress, interface_object_path, NULL);
                 g_print("[OBEX Server] OBEX transfer closed\n");
-                ObexTransfer *transfer = g_hash_table_lookup(_transfers, interface_object_path);
-                g_hash_table_remove(_transfers, interface_object_path);
-                g_object_unref(transfer);
-                g_free(g_hash_table_lookup(_transfer_infos, interface_object_path));
                 g_hash_table_remove(_transfer_infos, interface_object_path);
             }
             
@@ -126,46 +346,58 @@ static void _obex_server_object_manager_handler(GDBusConnection *connection, con
     }
 }
 
+static void _obex_server_move_done(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    ObexServerMove *move = user_data;
+    GError *error = NULL;
+
+    if (file_move_finish(res, &error))
+    {
+        g_print("[OBEX Server] Saved %s\n", move->filename);
+        if (move->digest)
+        {
+            gchar *dst = g_build_filename(_root_path, move->filename, NULL);
+            g_print("[OBEX Server] %s: %s\n", _checksum_name, move->digest);
+            _write_manifest(dst, move->digest);
+            g_free(dst);
+        }
+    }
+    else
+    {
+        g_print("[OBEX Server] Can't save %s: %s\n", move->filename, error->message);
+        g_error_free(error);
+    }
+    g_free(move->filename);
+    g_free(move->digest);
+    g_free(move);
+}
+
 static void _obex_server_properties_handler(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
 {
     const gchar *arg0 = g_variant_get_string(g_variant_get_child_value(parameters, 0), NULL);
     GVariant *changed_properties = g_variant_get_child_value(parameters, 1);
     
-    if(g_strcmp0(arg0, OBEX_TRANSFER_DBUS_INTERFACE) == 0)
+    ObexTransferInfo *info = g_hash_table_lookup(_transfer_infos, object_path);
+
+    if(g_strcmp0(arg0, OBEX_TRANSFER_DBUS_INTERFACE) == 0 && info)
     {
-        ObexTransfer *transfer = g_hash_table_lookup(_transfers, object_path);
-        
-        guint64 size = 0x0;
-        guint64 transferred = 0x0;
-        obex_transfer_get_size(transfer, NULL);
-        g_variant_lookup(changed_properties, "Size", "t", &size);
-        if(!size)
-            size = obex_transfer_get_size(transfer, NULL);
-        g_variant_lookup(changed_properties, "Transferred", "t", &transferred);
+        /* Every value comes from the signal or from what earlier ones left */
+        gboolean progressed = g_variant_lookup(changed_properties, "Transferred", "t", NULL);
+        _transfer_info_update(info, changed_properties);
+        guint64 size = info->filesize;
+        guint64 transferred = info->transferred;
+
+        if (progressed && transferred)
+            _transfer_checksum_update(info, transferred);
         
-        if(size && transferred)
+        if(transferred && progressed)
         {
-            guint pp = (transferred / (gfloat) size)*100;
-
-            if (!_update_progress)
-            {
-                g_print("[OBEXTransfer] Progress: %3u%%", pp);
-                _update_progress = TRUE;
-            }
-            else
-            {
-                g_print("\b\b\b\b%3u%%", pp);
-            }
-
-            if (pp == 100)
-            {
-                g_print("\n");
-                _update_progress = FALSE;
-            }
+            progress_start(_progress, object_path, info->filename, size);
+            progress_update(_progress, object_path, transferred, size);
         }
         
-        gchar *status = NULL;
-        g_variant_lookup(changed_properties, "Status", "s", &status);
+        const gchar *status = NULL;
+        g_variant_lookup(changed_properties, "Status", "&s", &status);
         
         if(status)
         {
@@ -175,13 +407,25 @@ static void _obex_server_properties_handler(GDBusConnection *connection, const g
             }
             else if(g_strcmp0(status, "complete") == 0)
             {
-                g_print("[OBEX Server] Transfer succeeded\n");
-                ObexTransferInfo *info = g_hash_table_lookup(_transfer_infos, object_path);
-                g_rename(g_build_filename(info->obex_root, info->filename, NULL), g_build_filename(_root_path, info->filename, NULL));
+                progress_stop(_progress, object_path, "[OBEX Server] Transfer succeeded");
+                gchar *src = g_build_filename(info->obex_root, info->filename, NULL);
+                gchar *dst = g_build_filename(_root_path, info->filename, NULL);
+                ObexServerMove *move = g_new0(ObexServerMove, 1);
+                move->filename = g_strdup(info->filename);
+
+                /* Whatever the last progress signal did not cover */
+                _transfer_checksum_update(info, 0);
+                if (info->checksum)
+                    move->digest = g_strdup(g_checksum_get_string(info->checksum));
+
+                /* Off the main loop: a copy between filesystems can take a while */
+                file_move_async(src, dst, _move_sync, NULL, _obex_server_move_done, move);
+                g_free(src);
+                g_free(dst);
             }
             else if(g_strcmp0(status, "error") == 0)
             {
-                g_print("[OBEX Server] Transfer failed\n");
+                progress_stop(_progress, object_path, "[OBEX Server] Transfer failed");
             }
             else if(g_strcmp0(status, "queued") == 0)
             {
@@ -189,15 +433,434 @@ static void _obex_server_properties_handler(GDBusConnection *connection, const g
             }
             else if(g_strcmp0(status, "suspended") == 0)
             {
-                g_print("[OBEX Server] Transfer halted\n");
+                progress_stop(_progress, object_path, "[OBEX Server] Transfer halted");
             }
-            g_free(status);
         }
     }
     
     g_variant_unref(changed_properties);
 }
 
+static gint _compare_names(gconstpointer a, gconstpointer b)
+{
+    return g_strcmp0(*(const gchar **) a, *(const gchar **) b);
+}
+
+/* Regular files under `path`, in name order; OPP has no folders, so the tree is flattened */
+static gboolean _opp_files_add(const gchar *path, GError **error)
+{
+    if (!g_file_test(path, G_FILE_TEST_IS_DIR))
+    {
+        if (!is_file(path, error))
+            return FALSE;
+        g_ptr_array_add(_opp_files, g_path_is_absolute(path) ? g_strdup(path) : get_absolute_path(path));
+        return TRUE;
+    }
+
+    GDir *dir = g_dir_open(path, 0, error);
+    if (!dir)
+        return FALSE;
+
+    GPtrArray *names = g_ptr_array_new_with_free_func(g_free);
+    const gchar *name;
+    while ((name = g_dir_read_name(dir)) != NULL)
+        g_ptr_array_add(names, g_strdup(name));
+    g_dir_close(dir);
+    g_ptr_array_sort(names, _compare_names);
+
+    gboolean ok = TRUE;
+    for (guint i = 0; ok && i < names->len; i++)
+    {
+        gchar *child = g_build_filename(path, g_ptr_array_index(names, i), NULL);
+        /* Sockets, fifos and the like can't be sent, skip them quietly */
+        if (g_file_test(child, G_FILE_TEST_IS_DIR | G_FILE_TEST_IS_REGULAR))
+            ok = _opp_files_add(child, error);
+        g_free(child);
+    }
+    g_ptr_array_unref(names);
+    return ok;
+}
+
+static void _opp_target_free(ObexOppTarget *target)
+{
+    g_free(target->name);
+    g_free(target->source);
+    g_free(target->address);
+    retry_state_free(target->retry);
+    g_free(target->session);
+    g_free(target->transfer);
+    g_free(target->error);
+    g_free(target);
+}
+
+/*
+ * Adds `name` (a device name or MAC) reached through `adapter_name`. A
+ * target that can't be resolved is still added, as failed, so that it
+ * shows up in the report.
+ */
+static gboolean _opp_target_add(const gchar *name, const gchar *adapter_name, GError **error)
+{
+    ObexOppTarget *target = g_new0(ObexOppTarget, 1);
+    target->name = g_strdup(name);
+    target->retry = retry_state_new(&_opp_retry);
+    target->state = OPP_TARGET_FAILED;
+    g_ptr_array_add(_opp_targets, target);
+
+    Adapter *adapter = find_adapter(adapter_name, error);
+    if (!adapter)
+    {
+        if (error && !*error)
+            *error = g_error_new(g_quark_from_string("bluez-tools"), 2, "%s: Adapter not found", adapter_name ? adapter_name : "default");
+        goto failed;
+    }
+    target->source = g_strdup(adapter_get_address(adapter, error));
+    if (!target->source)
+        goto failed;
+
+    if (g_regex_match_simple("^\\x{2}:\\x{2}:\\x{2}:\\x{2}:\\x{2}:\\x{2}$", name, 0, 0))
+    {
+        target->address = g_strdup(name);
+    }
+    else
+    {
+        Device *device = find_device(adapter, name, error);
+        if (!device)
+        {
+            if (error && !*error)
+                *error = g_error_new(g_quark_from_string("bluez-tools"), 2, "%s: Device not found", name);
+            goto failed;
+        }
+        target->address = g_strdup(device_get_address(device, error));
+        g_object_unref(device);
+        if (!target->address)
+            goto failed;
+    }
+
+    g_object_unref(adapter);
+    target->state = OPP_TARGET_WAITING;
+    return TRUE;
+
+failed:
+    if (adapter)
+        g_object_unref(adapter);
+    if (error && *error)
+        target->error = g_strdup((*error)->message);
+    return FALSE;
+}
+
+static ObexOppTarget *_opp_target_by_session(const gchar *session_path)
+{
+    for (guint i = 0; session_path && i < _opp_targets->len; i++)
+    {
+        ObexOppTarget *target = g_ptr_array_index(_opp_targets, i);
+        if (g_strcmp0(target->session, session_path) == 0)
+            return target;
+    }
+    return NULL;
+}
+
+/* What a transfer is called in messages: the file, and the device too when there are several */
+static gchar *_opp_transfer_label(ObexOppTarget *target, const gchar *filename)
+{
+    if (_opp_broadcast && target)
+        return g_strdup_printf("%s@%s", filename, target->name);
+    return g_strdup(filename);
+}
+
+/* Targets still being worked on */
+static gboolean _opp_pending()
+{
+    for (guint i = 0; i < _opp_targets->len; i++)
+    {
+        ObexOppTarget *target = g_ptr_array_index(_opp_targets, i);
+        if (target->state < OPP_TARGET_DONE)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static guint _opp_active(const gchar *source)
+{
+    guint active = 0;
+    for (guint i = 0; i < _opp_targets->len; i++)
+    {
+        ObexOppTarget *target = g_ptr_array_index(_opp_targets, i);
+        if ((target->state == OPP_TARGET_CONNECTING || target->state == OPP_TARGET_SENDING) && g_strcmp0(target->source, source) == 0)
+            active++;
+    }
+    return active;
+}
+
+static void _opp_session_close(ObexOppTarget *target)
+{
+    if (!target->session)
+        return;
+
+    transfer_manager_remove_session(_transfer_manager, target->session);
+    /* Nobody waits for the reply; the link is released as soon as obexd gets to it */
+    g_dbus_connection_call(session_conn, BLUEZ_OBEX_DBUS_SERVICE_NAME, OBEX_CLIENT_DBUS_PATH, OBEX_CLIENT_DBUS_INTERFACE, "RemoveSession", g_variant_new("(o)", target->session), NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), NULL, NULL, NULL);
+    g_free(target->session);
+    target->session = NULL;
+}
+
+static void _opp_target_print(ObexOppTarget *target)
+{
+    gdouble seconds = ((target->finished ? target->finished : g_get_monotonic_time()) - target->started) / (gdouble) G_USEC_PER_SEC;
+    gchar *bytes = g_format_size(target->bytes);
+    gchar *speed = g_format_size(seconds > 0 ? target->bytes / seconds : 0);
+    const gchar *result = target->sent == _opp_files->len ? "ok" : target->state == OPP_TARGET_FAILED ? "failed" : "incomplete";
+
+    g_print("[%s] %s: %s, %u of %u files", target->name, target->address ? target->address : "-", result, target->sent, _opp_files->len);
+    if (target->started)
+        g_print(", %s in %.1f sec (%s/s)", bytes, seconds, speed);
+    if (target->sent != _opp_files->len && target->error)
+        g_print(" (%s)", target->error);
+    g_print("\n");
+
+    g_free(bytes);
+    g_free(speed);
+}
+
+static void _opp_schedule();
+
+static void _opp_target_end(ObexOppTarget *target, ObexOppTargetState state)
+{
+    _opp_session_close(target);
+    target->state = state;
+    target->finished = g_get_monotonic_time();
+    if (_opp_broadcast)
+        _opp_target_print(target);
+}
+
+static gboolean _opp_target_wake(gpointer user_data)
+{
+    ObexOppTarget *target = user_data;
+    target->state = OPP_TARGET_WAITING;
+    _opp_schedule();
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * The target failed: try it again later from the file it was at, or give
+ * up on it. Only connection trouble (out of range, busy) is worth another
+ * attempt; a transfer the device refused or the user declined is not.
+ */
+static gboolean _opp_target_retry(ObexOppTarget *target, const GError *error)
+{
+    guint delay = 0;
+
+    g_free(target->error);
+    target->error = g_strdup(error->message);
+
+    if (!retry_state_next(target->retry, error, &delay))
+        return FALSE;
+
+    _opp_session_close(target);
+    target->state = OPP_TARGET_BACKOFF;
+    g_printerr("[%s] %s, retrying in %u ms\n", target->name, error->message, delay);
+    g_timeout_add(delay, _opp_target_wake, target);
+    return TRUE;
+}
+
+static void _opp_send_next(ObexOppTarget *target);
+
+/* The transfer of the target's current file is over; `error` is NULL if it went through */
+static void _opp_file_done(ObexOppTarget *target, guint64 size, const GError *error)
+{
+    g_free(target->transfer);
+    target->transfer = NULL;
+
+    if (!error)
+    {
+        target->sent++;
+        target->bytes += size;
+    }
+    else if (_opp_target_retry(target, error))
+    {
+        _opp_schedule();
+        return;
+    }
+    else
+        target->failed++;
+
+    target->next++;
+    _opp_send_next(target);
+}
+
+static void _opp_file_queued(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    ObexOppTarget *target = user_data;
+    GError *error = NULL;
+
+    /* The transfer itself is followed through its signals, which carry the session */
+    GVariant *ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source_object), res, &error);
+    if (ret)
+    {
+        g_variant_unref(ret);
+        return;
+    }
+
+    gchar *basename = g_path_get_basename(g_ptr_array_index(_opp_files, target->next));
+    gchar *label = _opp_transfer_label(target, basename);
+    g_print("[Transfer#%s] Failed: %s\n", label, error->message);
+    _opp_file_done(target, 0, error);
+    g_free(label);
+    g_free(basename);
+    g_error_free(error);
+}
+
+/* Hands the target's next file to obexd as soon as the last one is done, or ends the target */
+static void _opp_send_next(ObexOppTarget *target)
+{
+    if (target->next >= _opp_files->len)
+    {
+        _opp_target_end(target, OPP_TARGET_DONE);
+        _opp_schedule();
+        return;
+    }
+
+    g_dbus_connection_call(session_conn, BLUEZ_OBEX_DBUS_SERVICE_NAME, target->session, OBEX_OBJECT_PUSH_DBUS_INTERFACE, "SendFile", g_variant_new("(s)", g_ptr_array_index(_opp_files, target->next)), G_VARIANT_TYPE("(oa{sv})"), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), _opp_file_queued, target);
+}
+
+static void _opp_session_created(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    ObexOppTarget *target = user_data;
+    GError *error = NULL;
+
+    GVariant *ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source_object), res, &error);
+    if (!ret)
+    {
+        if (!_opp_target_retry(target, error))
+            _opp_target_end(target, OPP_TARGET_FAILED);
+        g_error_free(error);
+        _opp_schedule();
+        return;
+    }
+
+    g_variant_get(ret, "(o)", &target->session);
+    g_variant_unref(ret);
+    transfer_manager_add_session(_transfer_manager, target->session, target->address);
+    target->state = OPP_TARGET_SENDING;
+    _opp_send_next(target);
+}
+
+static void _opp_target_connect(ObexOppTarget *target)
+{
+    target->state = OPP_TARGET_CONNECTING;
+    if (!target->started)
+        target->started = g_get_monotonic_time();
+
+    GVariantBuilder *b = g_variant_builder_new(G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(b, "{sv}", "Target", g_variant_new_string("opp"));
+    g_variant_builder_add(b, "{sv}", "Source", g_variant_new_string(target->source));
+    GVariant *device_dict = g_variant_builder_end(b);
+    g_variant_builder_unref(b);
+
+    /* Connecting takes seconds, so sessions to different devices are set up side by side */
+    g_dbus_connection_call(session_conn, BLUEZ_OBEX_DBUS_SERVICE_NAME, OBEX_CLIENT_DBUS_PATH, OBEX_CLIENT_DBUS_INTERFACE, "CreateSession", g_variant_new("(s@a{sv})", target->address, device_dict), G_VARIANT_TYPE("(o)"), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), _opp_session_created, target);
+}
+
+/* Starts waiting targets while their adapters have free slots; ends the run when all are through */
+static void _opp_schedule()
+{
+    for (guint i = 0; i < _opp_targets->len; i++)
+    {
+        ObexOppTarget *target = g_ptr_array_index(_opp_targets, i);
+        if (target->state == OPP_TARGET_WAITING && _opp_active(target->source) < _opp_parallel)
+            _opp_target_connect(target);
+    }
+
+    if (!_opp_pending() && g_main_loop_is_running(mainloop))
+        g_main_loop_quit(mainloop);
+}
+
+/* TRUE if every target got every file */
+static gboolean _opp_report()
+{
+    gdouble seconds = (g_get_monotonic_time() - _opp_started) / (gdouble) G_USEC_PER_SEC;
+    guint64 total_bytes = 0;
+    guint sent = 0, failed = 0, complete = 0;
+
+    for (guint i = 0; i < _opp_targets->len; i++)
+    {
+        ObexOppTarget *target = g_ptr_array_index(_opp_targets, i);
+        /* Interrupted ones have not been reported yet */
+        if (_opp_broadcast && target->state < OPP_TARGET_DONE)
+            _opp_target_print(target);
+        total_bytes += target->bytes;
+        sent += target->sent;
+        failed += target->failed;
+        if (target->sent == _opp_files->len)
+            complete++;
+    }
+
+    gchar *bytes = g_format_size(total_bytes);
+    gchar *speed = g_format_size(seconds > 0 ? total_bytes / seconds : 0);
+
+    g_print("Sent %u of %u files, %s in %.1f sec (%s/s)", sent, _opp_files->len * _opp_targets->len, bytes, seconds, speed);
+    if (failed)
+        g_print(", %u failed", failed);
+    if (_opp_broadcast)
+        g_print(", %u of %u devices complete", complete, _opp_targets->len);
+    g_print("\n");
+
+    g_free(bytes);
+    g_free(speed);
+    return complete == _opp_targets->len;
+}
+
+/* "<name|mac> [<adapter>]" per line, '#' starts a comment */
+static gboolean _opp_targets_load(const gchar *filename, const gchar *adapter_name, GError **error)
+{
+    gchar *contents = NULL;
+    gchar **lines = NULL;
+
+    if (g_strcmp0(filename, "-") == 0)
+    {
+        GString *in = g_string_new(NULL);
+        gchar buf[4096];
+        size_t len;
+        while ((len = fread(buf, 1, sizeof(buf), stdin)) > 0)
+            g_string_append_len(in, buf, len);
+        contents = g_string_free(in, FALSE);
+    }
+    else if (!g_file_get_contents(filename, &contents, NULL, error))
+        return FALSE;
+
+    lines = g_strsplit(contents, "\n", -1);
+    for (guint i = 0; lines[i] != NULL; i++)
+    {
+        gchar *line = g_strstrip(lines[i]);
+        if (line[0] == '\0' || line[0] == '#')
+            continue;
+
+        gchar **fields = g_strsplit_set(line, " \t", -1);
+        const gchar *name = NULL, *adapter = adapter_name;
+        for (guint j = 0; fields[j] != NULL; j++)
+        {
+            if (fields[j][0] == '\0')
+                continue;
+            if (!name)
+                name = fields[j];
+            else
+                adapter = fields[j];
+        }
+
+        GError *target_error = NULL;
+        if (!_opp_target_add(name, adapter, &target_error))
+        {
+            /* Reported with the results; the other devices still get the files */
+            g_printerr("[%s] %s\n", name, target_error ? target_error->message : "Can't resolve");
+            g_clear_error(&target_error);
+        }
+        g_strfreev(fields);
+    }
+
+    g_strfreev(lines);
+    g_free(contents);
+    return TRUE;
+}
+
 static void _obex_opp_client_object_manager_handler(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
 {
     if(g_strcmp0(signal_name, "InterfacesAdded") == 0)
@@ -209,22 +872,23 @@ static void _obex_opp_client_object_manager_handler(GDBusConnection *connection,
         if(g_variant_lookup(interfaces_and_properties, OBEX_TRANSFER_DBUS_INTERFACE, "@a{sv}", &properties))
         {
             // g_print("[OBEX Client] Transfer started\n");
-            ObexTransfer *t = obex_transfer_new(interface_object_path);
-            g_hash_table_insert(_transfers, g_strdup(interface_object_path), t);
-
-            ObexTransferInfo *info = g_malloc0(sizeof(ObexTransferInfo));
-            info->filesize = g_variant_get_uint64(g_variant_lookup_value(properties, "Size", NULL));
-            info->filename = g_strdup(g_variant_get_string(g_variant_lookup_value(properties, "Name", NULL), NULL));
-            info->status = g_strdup(g_variant_get_string(g_variant_lookup_value(properties, "Status", NULL), NULL));
-            ObexSession *session = obex_session_new(g_variant_get_string(g_variant_lookup_value(properties, "Session", NULL), NULL));
-            
-            info->obex_root = g_strdup(obex_session_get_root(session, NULL));
-            
-            g_object_unref(session);
-            
-            g_hash_table_insert(_transfer_infos, g_strdup(interface_object_path), info);
-            if(g_strcmp0(info->status, "queued") == 0)
-                g_print("[Transfer#%s] Waiting...\n", info->filename);
+            /* Only transfers of our own sessions */
+            const gchar *session_path = NULL;
+            g_variant_lookup(properties, "Session", "&o", &session_path);
+            ObexOppTarget *target = _opp_target_by_session(session_path);
+            if (target)
+            {
+                /* The client only sends, the session's Root is not needed */
+                ObexTransferInfo *info = _transfer_info_add(interface_object_path, properties);
+                g_free(target->transfer);
+                target->transfer = g_strdup(interface_object_path);
+                if(g_strcmp0(info->status, "queued") == 0)
+                {
+                    gchar *label = _opp_transfer_label(target, info->filename);
+                    g_print("[Transfer#%s] Waiting...\n", label);
+                    g_free(label);
+                }
+            }
         }
         
         if(g_variant_lookup(interfaces_and_properties, OBEX_SESSION_DBUS_INTERFACE, "@a{sv}", &properties))
@@ -245,133 +909,837 @@ static void _obex_opp_client_object_manager_handler(GDBusConnection *connection,
         const gchar **inf = NULL;
         for(inf = inf_array; *inf != NULL; inf++)
         {
-            if(g_strcmp0(*inf, OBEX_TRANSFER_DBUS_INTERFACE) == 0)
-            {
-                // g_print("[OBEX Client] OBEX transfer closed\n");
-                ObexTransfer *transfer = g_hash_table_lookup(_transfers, interface_object_path);
-                g_hash_table_remove(_transfers, interface_object_path);
-                g_object_unref(transfer);
-                g_free(g_hash_table_lookup(_transfer_infos, interface_object_path));
-                g_hash_table_remove(_transfer_infos, interface_object_path);
-                if (g_main_loop_is_running(mainloop))
-                    g_main_loop_quit(mainloop);
-            }
-            
-            if(g_strcmp0(*inf, OBEX_SESSION_DBUS_INTERFACE) == 0)
-            {
-                // g_print("[OBEX Client] OBEX session closed\n");
-            }
+            if(g_strcmp0(*inf, OBEX_TRANSFER_DBUS_INTERFACE) == 0)
+            {
+                // g_print("[OBEX Client] OBEX transfer closed\n");
+                ObexTransferInfo *info = g_hash_table_lookup(_transfer_infos, interface_object_path);
+                ObexOppTarget *target = info ? _opp_target_by_session(info->session) : NULL;
+                progress_stop(_progress, interface_object_path, NULL);
+                /* Gone without a final status, eg. cancelled by someone else */
+                if (target && g_strcmp0(target->transfer, interface_object_path) == 0)
+                {
+                    GError *error = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_CANCELLED, "Transfer cancelled");
+                    _opp_file_done(target, 0, error);
+                    g_error_free(error);
+                }
+                g_hash_table_remove(_transfer_infos, interface_object_path);
+            }
+            
+            if(g_strcmp0(*inf, OBEX_SESSION_DBUS_INTERFACE) == 0)
+            {
+                // g_print("[OBEX Client] OBEX session closed\n");
+            }
+        }
+        g_free(inf_array);
+    }
+}
+
+static void _obex_opp_client_properties_handler(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    const gchar *arg0 = g_variant_get_string(g_variant_get_child_value(parameters, 0), NULL);
+    GVariant *changed_properties = g_variant_get_child_value(parameters, 1);
+    
+    ObexTransferInfo *info = g_hash_table_lookup(_transfer_infos, object_path);
+
+    if(g_strcmp0(arg0, OBEX_TRANSFER_DBUS_INTERFACE) == 0 && info)
+    {
+        gboolean progressed = g_variant_lookup(changed_properties, "Transferred", "t", NULL);
+        _transfer_info_update(info, changed_properties);
+        guint64 size = info->filesize;
+        guint64 transferred = info->transferred;
+        ObexOppTarget *target = _opp_target_by_session(info->session);
+        gchar *label = _opp_transfer_label(target, info->filename);
+        /* Only the transfer the target is waiting for moves it on */
+        gboolean current = target && g_strcmp0(target->transfer, object_path) == 0;
+        
+        if(transferred && progressed && g_strcmp0(info->status, "active") == 0)
+        {
+            progress_start(_progress, object_path, label, size);
+            progress_update(_progress, object_path, transferred, size);
+        }
+        
+        const gchar *status = NULL;
+        g_variant_lookup(changed_properties, "Status", "&s", &status);
+        
+        if(status)
+        {
+            if(g_strcmp0(status, "active") == 0)
+            {
+                // g_print("[Client Server] Transfer active\n");
+            }
+            else if(g_strcmp0(status, "complete") == 0)
+            {
+                gchar *message = g_strdup_printf("[Transfer#%s] Completed", label);
+                progress_stop(_progress, object_path, message);
+                g_free(message);
+                if (current)
+                    _opp_file_done(target, size, NULL);
+            }
+            else if(g_strcmp0(status, "error") == 0)
+            {
+                gchar *message = g_strdup_printf("[Transfer#%s] Failed", label);
+                progress_stop(_progress, object_path, message);
+                g_free(message);
+                /* obexd gives no reason: most likely refused or declined, not worth retrying */
+                if (current)
+                {
+                    GError *error = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_FAILED, "Transfer failed");
+                    _opp_file_done(target, 0, error);
+                    g_error_free(error);
+                }
+            }
+            else if(g_strcmp0(status, "queued") == 0)
+            {
+                // g_print("[OBEX Client] Transfer queued\n");
+            }
+            else if(g_strcmp0(status, "suspended") == 0)
+            {
+                gchar *message = g_strdup_printf("[Transfer#%s] Suspended", label);
+                progress_stop(_progress, object_path, message);
+                g_free(message);
+            }
+        }
+        g_free(label);
+    }
+    
+    g_variant_unref(changed_properties);
+}
+
+void _agent_approved_callback(ObexAgent *obex_agent, const gchar* obex_transfer_path, const gchar *name, const guint64 size, gpointer user_data)
+{
+    ObexTransferInfo *info = g_hash_table_lookup(_transfer_infos, obex_transfer_path);
+    if(!info)
+    {
+        /* Asked about before its InterfacesAdded got here */
+        info = _transfer_info_new();
+        g_hash_table_insert(_transfer_infos, g_strdup(obex_transfer_path), info);
+        const gchar *session_path = _obex_model ? object_model_get_string(_obex_model, obex_transfer_path, OBEX_TRANSFER_DBUS_INTERFACE, "Session") : NULL;
+        if (session_path)
+            info->session = g_strdup(session_path);
+        else
+        {
+            ObexTransfer *transfer = obex_transfer_new(obex_transfer_path);
+            info->session = g_strdup(obex_transfer_get_session(transfer, NULL));
+            g_object_unref(transfer);
+        }
+    }
+    if (!info->obex_root && info->session)
+        info->obex_root = _obex_session_root(info->session);
+    g_free(info->filename);
+    info->filename = g_strdup(name);
+    info->filesize = size;
+}
+
+/* FTP shell: the session's current folder, kept up to date by cd and mkdir, and its listings */
+static gchar *_ftp_cwd = NULL;
+static FtpCache *_ftp_cache = NULL;
+
+/* ftp_cache_list() from the current folder, following the session when it can't get back there */
+static GVariant *_ftp_list(const gchar *folder, GError **error)
+{
+    GError *list_error = NULL;
+    GVariant *listing = ftp_cache_list(_ftp_cache, _ftp_cwd, folder, &list_error);
+
+    if (g_error_matches(list_error, g_quark_from_string("bluez-tools"), FTP_CACHE_ERROR_CWD_LOST))
+    {
+        g_printerr("%s\n", list_error->message);
+        g_free(_ftp_cwd);
+        _ftp_cwd = g_strdup("/");
+    }
+    if (list_error)
+        g_propagate_error(error, list_error);
+
+    return listing;
+}
+
+static const struct {
+    const gchar *name;
+    guint remote;   /* bit n set: argument n is a remote path */
+    guint local;    /* bit n set: argument n is a local path */
+} _ftp_commands[] = {
+    {"help", 0, 0},
+    {"exit", 0, 0},
+    {"quit", 0, 0},
+    {"cd", 1 << 1, 0},
+    {"mkdir", 1 << 1, 0},
+    {"ls", 0, 0},
+    {"refresh", 0, 0},
+    {"get", 1 << 1, 1 << 2},
+    {"put", 1 << 2, 1 << 1},
+    {"cp", 1 << 1 | 1 << 2, 0},
+    {"mv", 1 << 1 | 1 << 2, 0},
+    {"rm", 1 << 1, 0},
+    {"mirror", 1 << 1, 1 << 2},
+    {"sync", 1 << 2, 1 << 1},
+};
+
+/* Readline frees what the generators return, so those are malloc()ed */
+static char *_ftp_command_generator(const char *text, int state)
+{
+    static guint index = 0;
+
+    if (state == 0)
+        index = 0;
+    while (index < G_N_ELEMENTS(_ftp_commands))
+    {
+        const gchar *name = _ftp_commands[index++].name;
+        if (g_str_has_prefix(name, text))
+            return strdup(name);
+    }
+    return NULL;
+}
+
+/* Entries of the remote folder `text` points into, from the listing cache; folders end with '/' */
+static gchar **_ftp_remote_matches(const gchar *text)
+{
+    const gchar *slash = strrchr(text, '/');
+    gchar *dir = slash ? g_strndup(text, slash - text + 1) : g_strdup("");
+    const gchar *prefix = slash ? slash + 1 : text;
+    gchar *folder = ftp_path_resolve(_ftp_cwd, dir[0] ? dir : ".");
+    GPtrArray *matches = g_ptr_array_new();
+
+    GVariant *listing = _ftp_list(folder, NULL);
+    if (listing)
+    {
+        GVariantIter iter;
+        GVariant *el;
+        g_variant_iter_init(&iter, listing);
+        while ((el = g_variant_iter_next_value(&iter)) != NULL)
+        {
+            const gchar *name = NULL, *type = NULL;
+            g_variant_lookup(el, "Name", "&s", &name);
+            g_variant_lookup(el, "Type", "&s", &type);
+            if (name && g_str_has_prefix(name, prefix))
+                g_ptr_array_add(matches, g_strconcat(dir, name, g_strcmp0(type, "folder") == 0 ? "/" : "", NULL));
+            g_variant_unref(el);
+        }
+        g_variant_unref(listing);
+    }
+    g_ptr_array_add(matches, NULL);
+
+    g_free(folder);
+    g_free(dir);
+    return (gchar **) g_ptr_array_free(matches, FALSE);
+}
+
+static char *_ftp_remote_generator(const char *text, int state)
+{
+    static gchar **matches = NULL;
+    static guint index = 0;
+
+    if (state == 0)
+    {
+        g_strfreev(matches);
+        matches = _ftp_remote_matches(text);
+        index = 0;
+    }
+    if (matches && matches[index])
+        return strdup(matches[index++]);
+    return NULL;
+}
+
+static char **_ftp_completion(const char *text, int start, int end)
+{
+    /* Which argument of which command is being completed */
+    gchar *before = g_strndup(rl_line_buffer, start);
+    gchar **words = g_strsplit_set(before, " \t", -1);
+    const gchar *command = NULL;
+    guint arg = 0;
+    for (guint i = 0; words[i] != NULL; i++)
+    {
+        if (words[i][0] == '\0')
+            continue;
+        if (!command)
+            command = words[i];
+        arg++;
+    }
+
+    char **matches = NULL;
+    rl_attempted_completion_over = 1;
+
+    if (arg == 0)
+    {
+        matches = rl_completion_matches(text, _ftp_command_generator);
+    }
+    else
+    {
+        for (guint i = 0; i < G_N_ELEMENTS(_ftp_commands); i++)
+        {
+            if (g_strcmp0(command, _ftp_commands[i].name) != 0 || arg >= 32)
+                continue;
+            if (_ftp_commands[i].remote & (1u << arg))
+            {
+                matches = rl_completion_matches(text, _ftp_remote_generator);
+                /* Carry on into a folder rather than end the word there */
+                if (matches && matches[0] && !matches[1] && g_str_has_suffix(matches[0], "/"))
+                    rl_completion_suppress_append = 1;
+            }
+            else if (_ftp_commands[i].local & (1u << arg))
+            {
+                /* Readline's own file name completion */
+                rl_attempted_completion_over = 0;
+            }
+        }
+    }
+
+    g_strfreev(words);
+    g_free(before);
+    return matches;
+}
+
+/* After we change `path` (relative to the current folder), whether or not that worked */
+static void _ftp_cache_forget(const gchar *path)
+{
+    gchar *abs_path = ftp_path_resolve(_ftp_cwd, path);
+    ftp_cache_invalidate_entry(_ftp_cache, abs_path);
+    g_free(abs_path);
+}
+
+/* mirror/sync for the FTP shell and --mirror/--sync; `remote` is relative to `cwd` */
+static gboolean _ftp_sync(ObexFileTransfer *ftp, FtpSyncDirection direction, const gchar *cwd, const gchar *remote, const gchar *local)
+{
+    GError *error = NULL;
+    FtpSyncStats stats;
+    gchar *folder = ftp_path_resolve(cwd, remote);
+    gchar *local_dir = get_absolute_path(local);
+    gint64 started = g_get_monotonic_time();
+
+    gboolean ok = ftp_sync_run(ftp, direction, folder, local_dir, &stats, &error);
+
+    /* Back where the shell was */
+    obex_file_transfer_change_folder(ftp, cwd, NULL);
+
+    if (!ok)
+    {
+        g_print("%s\n", error->message);
+        g_error_free(error);
+    }
+    else
+    {
+        gdouble seconds = (g_get_monotonic_time() - started) / (gdouble) G_USEC_PER_SEC;
+        gchar *bytes = g_format_size(stats.bytes);
+        gchar *speed = g_format_size(seconds > 0 ? stats.bytes / seconds : 0);
+        g_print("%u of %u files changed, %u transferred, %s in %.1f sec (%s/s)", stats.changed, stats.files, stats.transferred, bytes, seconds, speed);
+        if (stats.failed)
+            g_print(", %u failed", stats.failed);
+        g_print("\n");
+        g_free(bytes);
+        g_free(speed);
+    }
+
+    g_free(folder);
+    g_free(local_dir);
+    return ok && stats.failed == 0;
+}
+
+typedef struct {
+    gchar *name;    /* as given, for messages */
+    gchar *part;    /* get: written to until complete, then renamed to `local` */
+    gchar *local;
+    guint line_no;  /* of the --ftp-script command that started it, 0 in the shell */
+} FtpTransfer;
+
+/* get/put transfers still running: path -> FtpTransfer */
+static GHashTable *_ftp_transfers = NULL;
+/* Transfers that failed since the last _ftp_wait() */
+static guint _ftp_failed = 0;
+/* Script transfers whose failure was reported with their line, ever */
+static guint _ftp_failed_lines = 0;
+
+static void _ftp_transfer_free(FtpTransfer *transfer)
+{
+    g_free(transfer->name);
+    g_free(transfer->part);
+    g_free(transfer->local);
+    g_free(transfer);
+}
+
+static void _ftp_transfer_done(const gchar *transfer_path, gboolean ok)
+{
+    FtpTransfer *transfer = g_hash_table_lookup(_ftp_transfers, transfer_path);
+    if (!transfer)
+        return;
+
+    if (ok && transfer->part && g_rename(transfer->part, transfer->local) != 0)
+    {
+        g_print("%s: %s\n", transfer->local, g_strerror(errno));
+        ok = FALSE;
+    }
+    if (!ok)
+    {
+        g_print("Failed: %s\n", transfer->name);
+        /* Pipelined gets end while later lines run: name the line that started this one */
+        if (transfer->line_no)
+        {
+            g_printerr("line %u: %s failed\n", transfer->line_no, transfer->part ? "get" : "put");
+            _ftp_failed_lines++;
+        }
+        _ftp_failed++;
+        /* OBEX has no way to continue a GET, the next try starts over */
+        if (transfer->part)
+            g_unlink(transfer->part);
+    }
+    g_hash_table_remove(_ftp_transfers, transfer_path);
+}
+
+static void _ftp_transfer_properties_handler(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    GVariant *changed = g_variant_get_child_value(parameters, 1);
+    const gchar *status = NULL;
+
+    if (g_variant_lookup(changed, "Status", "&s", &status))
+    {
+        if (g_strcmp0(status, "complete") == 0)
+            _ftp_transfer_done(object_path, TRUE);
+        else if (g_strcmp0(status, "error") == 0)
+            _ftp_transfer_done(object_path, FALSE);
+    }
+    g_variant_unref(changed);
+}
+
+/* A transfer that goes away without a final status failed */
+static void _ftp_transfer_removed_handler(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    const gchar *transfer_path = NULL;
+    g_variant_get(parameters, "(&o@as)", &transfer_path, NULL);
+    _ftp_transfer_done(transfer_path, FALSE);
+}
+
+/* `ret` is the reply of GetFile or PutFile; `part` and `local` only for GetFile */
+static void _ftp_transfer_add(GVariant *ret, const gchar *name, const gchar *part, const gchar *local, guint line_no)
+{
+    const gchar *transfer_path = NULL;
+    g_variant_get(ret, "(&o@a{sv})", &transfer_path, NULL);
+
+    FtpTransfer *transfer = g_new0(FtpTransfer, 1);
+    transfer->name = g_strdup(name);
+    transfer->part = g_strdup(part);
+    transfer->local = g_strdup(local);
+    transfer->line_no = line_no;
+    g_hash_table_insert(_ftp_transfers, g_strdup(transfer_path), transfer);
+    g_variant_unref(ret);
+}
+
+/* Until at most `limit` transfers are running; FALSE if any that ended meanwhile failed */
+static gboolean _ftp_wait(guint limit)
+{
+    while (g_hash_table_size(_ftp_transfers) > limit)
+        g_main_context_iteration(NULL, TRUE);
+
+    gboolean ok = _ftp_failed == 0;
+    _ftp_failed = 0;
+    return ok;
+}
+
+/* In a --ftp-script, whether an earlier run already got all of `remote` into `local` */
+static gboolean _ftp_get_complete(const gchar *remote, const gchar *local)
+{
+    GStatBuf buf;
+    if (g_stat(local, &buf) != 0 || !S_ISREG(buf.st_mode))
+        return FALSE;
+
+    gchar *path = ftp_path_resolve(_ftp_cwd, remote);
+    gchar *folder = g_path_get_dirname(path);
+    gchar *name = g_path_get_basename(path);
+    gboolean complete = FALSE;
+
+    /* Listing another folder moves the session, which must not happen under a running get */
+    if (g_strcmp0(folder, _ftp_cwd) != 0)
+    {
+        while (g_hash_table_size(_ftp_transfers) > 0)
+            g_main_context_iteration(NULL, TRUE);
+    }
+
+    GVariant *listing = _ftp_list(folder, NULL);
+    if (listing)
+    {
+        GVariantIter iter;
+        GVariant *el;
+        g_variant_iter_init(&iter, listing);
+        while ((el = g_variant_iter_next_value(&iter)) != NULL)
+        {
+            const gchar *entry_name = NULL, *type = NULL;
+            guint64 size = 0;
+            /* Gets are renamed into place once complete, so the right size means it is all there */
+            if (g_variant_lookup(el, "Name", "&s", &entry_name) && g_strcmp0(entry_name, name) == 0 &&
+                g_variant_lookup(el, "Type", "&s", &type) && g_strcmp0(type, "file") == 0 &&
+                g_variant_lookup(el, "Size", "t", &size))
+                complete = size == (guint64) buf.st_size;
+            g_variant_unref(el);
+        }
+        g_variant_unref(listing);
+    }
+
+    g_free(name);
+    g_free(folder);
+    g_free(path);
+    return complete;
+}
+
+/* One command of the FTP shell or of a --ftp-script (`batch`, from line `line_no`), but exit; FALSE if it failed */
+static gboolean _ftp_command(ObexFileTransfer *ftp_session, gint f_argc, gchar **f_argv, gboolean batch, gboolean pipeline, guint line_no)
+{
+    GError *error = NULL;
+    gboolean ok = TRUE;
+
+    if (g_strcmp0(f_argv[0], "cd") == 0)
+    {
+        if (f_argc != 2 || strlen(f_argv[1]) == 0)
+        {
+            g_print("invalid arguments\n");
+            ok = FALSE;
+        }
+        else
+        {
+            obex_file_transfer_change_folder(ftp_session, f_argv[1], &error);
+            if (error)
+            {
+                g_print("%s\n", error->message);
+                g_error_free(error);
+                error = NULL;
+                ok = FALSE;
+            }
+            else
+            {
+                gchar *cwd = ftp_path_resolve(_ftp_cwd, f_argv[1]);
+                g_free(_ftp_cwd);
+                _ftp_cwd = cwd;
+            }
+        }
+    }
+    else if (g_strcmp0(f_argv[0], "mkdir") == 0)
+    {
+        if (f_argc != 2 || strlen(f_argv[1]) == 0)
+        {
+            g_print("invalid arguments\n");
+            ok = FALSE;
+        }
+        else
+        {
+            obex_file_transfer_create_folder(ftp_session, f_argv[1], &error);
+            _ftp_cache_forget(f_argv[1]);
+            if (error)
+            {
+                g_print("%s\n", error->message);
+                g_error_free(error);
+                error = NULL;
+                ok = FALSE;
+            }
+            else
+            {
+                /* obexd moves into the folder it creates */
+                gchar *cwd = ftp_path_resolve(_ftp_cwd, f_argv[1]);
+                g_free(_ftp_cwd);
+                _ftp_cwd = cwd;
+            }
+        }
+    }
+    else if (g_strcmp0(f_argv[0], "ls") == 0)
+    {
+        if (f_argc != 1)
+        {
+            g_print("invalid arguments\n");
+            ok = FALSE;
+        }
+        else
+        {
+            GVariant *folder_list = _ftp_list(_ftp_cwd, &error);
+            if (error)
+            {
+                g_print("%s\n", error->message);
+                g_error_free(error);
+                error = NULL;
+                ok = FALSE;
+            }
+            else
+            {
+                /* aa{sv}, one dictionary per entry */
+                GVariantIter iter;
+                GVariant *el;
+                g_variant_iter_init(&iter, folder_list);
+                while ((el = g_variant_iter_next_value(&iter)) != NULL)
+                {
+                    const gchar *type = "", *name = "";
+                    guint64 size = 0;
+                    g_variant_lookup(el, "Type", "&s", &type);
+                    g_variant_lookup(el, "Size", "t", &size);
+                    g_variant_lookup(el, "Name", "&s", &name);
+                    g_print("%s\t%" G_GUINT64_FORMAT "\t%s\n", type, size, name);
+                    g_variant_unref(el);
+                }
+                g_variant_unref(folder_list);
+            }
+        }
+    }
+    else if (g_strcmp0(f_argv[0], "get") == 0)
+    {
+        if (f_argc != 3 || strlen(f_argv[1]) == 0 || strlen(f_argv[2]) == 0)
+        {
+            g_print("invalid arguments\n");
+            ok = FALSE;
+        }
+        else
+        {
+            gchar *abs_dst_path = get_absolute_path(f_argv[2]);
+            gchar *dir = g_path_get_dirname(abs_dst_path);
+            if (!is_dir(dir, &error))
+            {
+                g_print("%s\n", error->message);
+                g_error_free(error);
+                error = NULL;
+                ok = FALSE;
+            }
+            else if (batch && _ftp_get_complete(f_argv[1], abs_dst_path))
+            {
+                g_print("Skipped: %s (complete)\n", f_argv[1]);
+            }
+            else
+            {
+                gchar *part = ftp_part_path(abs_dst_path);
+                if (g_file_test(part, G_FILE_TEST_EXISTS))
+                    g_print("Restarting: %s (partially received)\n", f_argv[1]);
+
+                GVariant *transfer = obex_file_transfer_get_file(ftp_session, part, f_argv[1], &error);
+                if (error)
+                {
+                    g_print("%s\n", error->message);
+                    g_error_free(error);
+                    error = NULL;
+                    ok = FALSE;
+                }
+                else
+                {
+                    _ftp_transfer_add(transfer, f_argv[1], part, abs_dst_path, line_no);
+                    /* obexd runs them in order; the next get goes out while this one is running */
+                    ok = _ftp_wait(pipeline ? FTP_SYNC_PIPELINE - 1 : 0);
+                }
+                g_free(part);
+            }
+            g_free(dir);
+            g_free(abs_dst_path);
+        }
+    }
+    else if (g_strcmp0(f_argv[0], "put") == 0)
+    {
+        if (f_argc != 3 || strlen(f_argv[1]) == 0 || strlen(f_argv[2]) == 0)
+        {
+            g_print("invalid arguments\n");
+            ok = FALSE;
+        }
+        else
+        {
+            gchar *abs_src_path = get_absolute_path(f_argv[1]);
+            if (!is_file(abs_src_path, &error))
+            {
+                g_print("%s\n", error->message);
+                g_error_free(error);
+                error = NULL;
+                ok = FALSE;
+            }
+            else
+            {
+                GVariant *transfer = obex_file_transfer_put_file(ftp_session, abs_src_path, f_argv[2], &error);
+                _ftp_cache_forget(f_argv[2]);
+                if (error)
+                {
+                    g_print("%s\n", error->message);
+                    g_error_free(error);
+                    error = NULL;
+                    ok = FALSE;
+                }
+                else
+                {
+                    _ftp_transfer_add(transfer, f_argv[1], NULL, NULL, line_no);
+                    ok = _ftp_wait(0);
+                }
+            }
+            g_free(abs_src_path);
+        }
+    }
+    else if (g_strcmp0(f_argv[0], "cp") == 0)
+    {
+        if (f_argc != 3 || strlen(f_argv[1]) == 0 || strlen(f_argv[2]) == 0)
+        {
+            g_print("invalid arguments\n");
+            ok = FALSE;
+        }
+        else
+        {
+            obex_file_transfer_copy_file(ftp_session, f_argv[1], f_argv[2], &error);
+            _ftp_cache_forget(f_argv[2]);
+            if (error)
+            {
+                g_print("%s\n", error->message);
+                g_error_free(error);
+                error = NULL;
+                ok = FALSE;
+            }
+        }
+    }
+    else if (g_strcmp0(f_argv[0], "mv") == 0)
+    {
+        if (f_argc != 3 || strlen(f_argv[1]) == 0 || strlen(f_argv[2]) == 0)
+        {
+            g_print("invalid arguments\n");
+            ok = FALSE;
+        }
+        else
+        {
+            obex_file_transfer_move_file(ftp_session, f_argv[1], f_argv[2], &error);
+            _ftp_cache_forget(f_argv[1]);
+            _ftp_cache_forget(f_argv[2]);
+            if (error)
+            {
+                g_print("%s\n", error->message);
+                g_error_free(error);
+                error = NULL;
+                ok = FALSE;
+            }
+        }
+    }
+    else if (g_strcmp0(f_argv[0], "rm") == 0)
+    {
+        if (f_argc != 2 || strlen(f_argv[1]) == 0)
+        {
+            g_print("invalid arguments\n");
+            ok = FALSE;
+        }
+        else
+        {
+            obex_file_transfer_delete(ftp_session, f_argv[1], &error);
+            _ftp_cache_forget(f_argv[1]);
+            if (error)
+            {
+                g_print("%s\n", error->message);
+                g_error_free(error);
+                error = NULL;
+                ok = FALSE;
+            }
+        }
+    }
+    else if (g_strcmp0(f_argv[0], "mirror") == 0 || g_strcmp0(f_argv[0], "sync") == 0)
+    {
+        if (f_argc != 3 || strlen(f_argv[1]) == 0 || strlen(f_argv[2]) == 0)
+        {
+            g_print("invalid arguments\n");
+            ok = FALSE;
+        }
+        else if (g_strcmp0(f_argv[0], "mirror") == 0)
+        {
+            ok = _ftp_sync(ftp_session, FTP_SYNC_MIRROR, _ftp_cwd, f_argv[1], f_argv[2]);
+        }
+        else
+        {
+            ok = _ftp_sync(ftp_session, FTP_SYNC_PUSH, _ftp_cwd, f_argv[2], f_argv[1]);
+            ftp_cache_clear(_ftp_cache);
+        }
+    }
+    else if (g_strcmp0(f_argv[0], "refresh") == 0)
+    {
+        if (f_argc != 1)
+        {
+            g_print("invalid arguments\n");
+            ok = FALSE;
+        }
+        else
+        {
+            /* For changes made on the device itself */
+            ftp_cache_clear(_ftp_cache);
         }
-        g_free(inf_array);
     }
+    else if (g_strcmp0(f_argv[0], "help") == 0)
+    {
+        g_print(
+                "help\t\t\tShow this message\n"
+                "exit\t\t\tClose FTP session\n"
+                "cd <folder>\t\tChange the current folder of the remote device\n"
+                "mkdir <folder>\t\tCreate a new folder in the remote device\n"
+                "ls\t\t\tList folder contents\n"
+                "refresh\t\t\tForget cached folder listings\n"
+                "get <src> <dst>\t\tCopy the src file (from remote device) to the dst file (on local filesystem)\n"
+                "put <src> <dst>\t\tCopy the src file (from local filesystem) to the dst file (on remote device)\n"
+                "cp <src> <dst>\t\tCopy a file within the remote device from src file to dst file\n"
+                "mv <src> <dst>\t\tMove a file within the remote device from src file to dst file\n"
+                "rm <target>\t\tDeletes the specified file/folder\n"
+                "mirror <src> <dst>\tCopy the src folder (from remote device) to the dst folder (on local filesystem), changed files only\n"
+                "sync <src> <dst>\tCopy the src folder (from local filesystem) to the dst folder (on remote device), changed files only\n"
+                );
+    }
+    else
+    {
+        g_print("invalid command\n");
+        ok = FALSE;
+    }
+
+    return ok;
 }
 
-static void _obex_opp_client_properties_handler(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+/* --ftp-script: shell commands one per line from `filename` (`-` for stdin), up to the first that fails */
+static gboolean _ftp_script(ObexFileTransfer *ftp_session, const gchar *filename, gboolean pipeline)
 {
-    const gchar *arg0 = g_variant_get_string(g_variant_get_child_value(parameters, 0), NULL);
-    GVariant *changed_properties = g_variant_get_child_value(parameters, 1);
-    
-    if(g_strcmp0(arg0, OBEX_TRANSFER_DBUS_INTERFACE) == 0)
+    g_assert(filename != NULL);
+    GError *error = NULL;
+
+    FILE *input = g_strcmp0(filename, "-") == 0 ? stdin : fopen(filename, "r");
+    if (input == NULL)
     {
-        ObexTransfer *transfer = g_hash_table_lookup(_transfers, object_path);
-        ObexTransferInfo *info = g_hash_table_lookup(_transfer_infos, object_path);
-        
-        guint64 size = 0x0;
-        guint64 transferred = 0x0;
-        obex_transfer_get_size(transfer, NULL);
-        g_variant_lookup(changed_properties, "Size", "t", &size);
-        if(!size)
-            size = obex_transfer_get_size(transfer, NULL);
-        g_variant_lookup(changed_properties, "Transferred", "t", &transferred);
-        
-        if(size && transferred && g_strcmp0(info->status, "active") == 0)
-        {
-            guint pp = (transferred / (gfloat) size)*100;
+        g_printerr("%s: %s\n", filename, g_strerror(errno));
+        return FALSE;
+    }
 
-            if (!_update_progress)
-            {
-                g_print("[Transfer#%s] Progress: %3u%%", obex_transfer_get_name(transfer, NULL), pp);
-                _update_progress = TRUE;
-            }
-            else
-            {
-                g_print("\b\b\b\b%3u%%", pp);
-            }
+    gchar *line = NULL;
+    size_t len = 0;
+    guint line_no = 0;
+    gboolean ok = TRUE;
 
-            if (pp == 100)
-            {
-                g_print("\n");
-                _update_progress = FALSE;
-            }
+    while (ok && getline(&line, &len, input) != -1)
+    {
+        line_no++;
+        g_strstrip(line);
+        if (line[0] == '\0' || line[0] == '#')
+            continue;
+
+        gint f_argc = 0;
+        gchar **f_argv = NULL;
+        if (!g_shell_parse_argv(line, &f_argc, &f_argv, &error))
+        {
+            g_printerr("line %u: %s\n", line_no, error->message);
+            g_clear_error(&error);
+            ok = FALSE;
+            break;
         }
-        
-        gchar *status = NULL;
-        g_variant_lookup(changed_properties, "Status", "s", &status);
-        
-        if(status)
+
+        if (g_strcmp0(f_argv[0], "exit") == 0 || g_strcmp0(f_argv[0], "quit") == 0)
         {
-            g_free(info->status);
-            info->status = g_strdup(status);
-            
-            if(g_strcmp0(status, "active") == 0)
-            {
-                // g_print("[Client Server] Transfer active\n");
-            }
-            else if(g_strcmp0(status, "complete") == 0)
-            {
-                if(_update_progress)
-                {
-                    _update_progress = FALSE;
-                    g_print("\b\b\b\b%3u%%", 100);
-                    g_print("\n");
-                }
-                    
-                g_print("[Transfer#%s] Completed\n", info->filename);
-            }
-            else if(g_strcmp0(status, "error") == 0)
-            {
-                if(_update_progress)
-                {
-                    _update_progress = FALSE;
-                    g_print("\n");
-                }
+            g_strfreev(f_argv);
+            break;
+        }
 
-                g_print("[Transfer#%s] Failed\n", info->filename);
-            }
-            else if(g_strcmp0(status, "queued") == 0)
-            {
-                // g_print("[OBEX Client] Transfer queued\n");
-            }
-            else if(g_strcmp0(status, "suspended") == 0)
-            {
-                if(_update_progress)
-                {
-                    _update_progress = FALSE;
-                    g_print("\n");
-                }
-                    
-                g_print("[Transfer#%s] Suspended\n", info->filename);
-            }
-            g_free(status);
+        /* Gets in a row may overlap, anything else sees them finished */
+        guint failed_lines = _ftp_failed_lines;
+        if (g_strcmp0(f_argv[0], "get") != 0 && !_ftp_wait(0))
+        {
+            /* The transfer reported its own line */
+            ok = FALSE;
+        }
+        else if (!_ftp_command(ftp_session, f_argc, f_argv, TRUE, pipeline, line_no))
+        {
+            /* Unless it was an earlier get that failed meanwhile */
+            if (_ftp_failed_lines == failed_lines)
+                g_printerr("line %u: %s failed\n", line_no, f_argv[0]);
+            ok = FALSE;
         }
+        g_strfreev(f_argv);
     }
-    
-    g_variant_unref(changed_properties);
-}
 
-void _agent_approved_callback(ObexAgent *obex_agent, const gchar* obex_transfer_path, const gchar *name, const guint64 size, gpointer user_data)
-{
-    ObexTransferInfo *info = g_hash_table_lookup(_transfer_infos, obex_transfer_path);
-    if(!info)
-    {
-        info = g_malloc0(sizeof(ObexTransferInfo));
-        g_hash_table_insert(_transfer_infos, g_strdup(obex_transfer_path), info);
-        ObexTransfer *transfer = g_hash_table_lookup(_transfers, obex_transfer_path);
-        ObexSession *session = obex_session_new(obex_transfer_get_session(transfer, NULL));
-        info->obex_root = g_strdup(obex_session_get_root(session, NULL));
-    }
-    info->filename = g_strdup(name);
-    info->filesize = size;
+    if (ok)
+        ok = _ftp_wait(0);
+
+    free(line);
+    if (input != stdin)
+        fclose(input);
+
+    return ok;
 }
 
 /* Main arguments */
@@ -381,15 +1749,39 @@ static gboolean auto_accept = FALSE;
 static gchar *server_path_arg = NULL;
 static gboolean opp_arg = FALSE;
 static gchar *opp_device_arg = NULL;
-static gchar *opp_file_arg = NULL;
 static gchar *ftp_arg = NULL;
+static gchar *timeout_arg = NULL;
+static gchar *fsync_arg = NULL;
+static gchar *checksum_arg = NULL;
+static gint progress_rate_arg = PROGRESS_DEFAULT_RATE;
+static gchar *broadcast_arg = NULL;
+static gboolean mirror_arg = FALSE;
+static gboolean sync_arg = FALSE;
+static gchar *ftp_script_arg = NULL;
+static gboolean pipeline_arg = FALSE;
+static gint parallel_arg = 4;
+/* Unless given, only --broadcast retries */
+static gint retries_arg = G_MININT;
+static gint suspend_below_arg = 0;
 
 static GOptionEntry entries[] = {
     {"adapter", 'a', 0, G_OPTION_ARG_STRING, &adapter_arg, "Adapter name or MAC", "<name|mac>"},
     {"server", 's', 0, G_OPTION_ARG_NONE, &server_arg, "Register self as OBEX server", NULL},
     {"auto-accept", 'y', 0, G_OPTION_ARG_NONE, &auto_accept, "Automatically accept incoming files", NULL},
-    {"opp", 'p', 0, G_OPTION_ARG_NONE, &opp_arg, "Send file to remote device", NULL},
+    {"opp", 'p', 0, G_OPTION_ARG_NONE, &opp_arg, "Send files to remote device", NULL},
+    {"broadcast", 'b', 0, G_OPTION_ARG_STRING, &broadcast_arg, "Send files to every device listed in <file>", "<file>"},
+    {"parallel", 0, 0, G_OPTION_ARG_INT, &parallel_arg, "Sessions at once per adapter with --broadcast (default 4)", "<n>"},
+    {"retries", 0, 0, G_OPTION_ARG_INT, &retries_arg, "Retry a device that failed to connect this many times (default 0, 2 with --broadcast)", "<n>"},
     {"ftp", 'f', 0, G_OPTION_ARG_STRING, &ftp_arg, "Start FTP session with remote device", "<name|mac>"},
+    {"mirror", 0, 0, G_OPTION_ARG_NONE, &mirror_arg, "With --ftp: copy changed files of a remote folder to a local one and exit", NULL},
+    {"sync", 0, 0, G_OPTION_ARG_NONE, &sync_arg, "With --ftp: copy changed files of a local folder to a remote one and exit", NULL},
+    {"ftp-script", 0, 0, G_OPTION_ARG_STRING, &ftp_script_arg, "With --ftp: run the shell commands in <file> (`-` for stdin) and exit", "<file>"},
+    {"pipeline", 0, 0, G_OPTION_ARG_NONE, &pipeline_arg, "With --ftp-script: start each get of a row before the previous one is done", NULL},
+    {"checksum", 0, 0, G_OPTION_ARG_STRING, &checksum_arg, "Digest received files into <file>.<type>: md5, sha1, sha256 or sha512", "<type>"},
+    {"fsync", 0, 0, G_OPTION_ARG_STRING, &fsync_arg, "Flush received files to disk: none (default), data or full", "<policy>"},
+    {"suspend-below", 0, 0, G_OPTION_ARG_INT, &suspend_below_arg, "Suspend transfers while the device's RSSI is below <dBm>", "<dBm>"},
+    {"progress-rate", 0, 0, G_OPTION_ARG_INT, &progress_rate_arg, "Redraw transfer progress at most <n> times a second (default 4)", "<n>"},
+    {"timeout", 0, 0, G_OPTION_ARG_STRING, &timeout_arg, "Give up on a bluetooth call after this many seconds", "<sec>"},
     {NULL}
 };
 
@@ -410,10 +1802,30 @@ int main(int argc, char *argv[])
                                      "Server Options:\n"
                                      "  -s, --server [<path>]\n"
                                      "  Register self at OBEX server and use given `path` as OPP save directory\n"
-                                     "  If `path` does not specified - use current directory\n\n"
+                                     "  If `path` does not specified - use current directory\n"
+                                     "  Received files are moved there from obexd's cache, copied\n"
+                                     "  when they are on different filesystems\n\n"
                                      "OPP Options:\n"
-                                     "  -p, --opp <name|mac> <file>\n"
-                                     "  Send `file` to remote device using Object Push Profile\n\n"
+                                     "  -p, --opp <name|mac> <file|dir>...\n"
+                                     "  Send files to remote device using Object Push Profile,\n"
+                                     "  one after another over a single session; directories are\n"
+                                     "  sent with everything below them\n\n"
+                                     "FTP Options:\n"
+                                     "  -f, --ftp <name|mac> --mirror <remote folder> <local dir>\n"
+                                     "  -f, --ftp <name|mac> --sync <local dir> <remote folder>\n"
+                                     "  Transfer the files that differ in size or time instead of\n"
+                                     "  opening the FTP shell\n"
+                                     "  -f, --ftp <name|mac> --ftp-script <file> [--pipeline]\n"
+                                     "  Run shell commands from `file` (`-` for stdin), one per line,\n"
+                                     "  stopping at the first that fails\n\n"
+                                     "Broadcast Options:\n"
+                                     "  -b, --broadcast <file> <file|dir>...\n"
+                                     "  Send files to every device listed in `file` (`-` for stdin),\n"
+                                     "  one `<name|mac> [<adapter>]` per line, up to --parallel\n"
+                                     "  devices at a time per adapter\n\n"
+                                     "Transfer Control:\n"
+                                     "  SIGUSR1 suspends the transfers of --opp, --broadcast and --ftp,\n"
+                                     "  SIGUSR2 resumes them; --suspend-below does the same on RSSI\n\n"
                                      "Report bugs to <"PACKAGE_BUGREPORT">."
                                      "Project home page <"PACKAGE_URL">."
                                      );
@@ -424,7 +1836,7 @@ int main(int argc, char *argv[])
         g_print("Try `%s --help` for more information.\n", g_get_prgname());
         exit(EXIT_FAILURE);
     }
-    else if (!server_arg && !opp_arg && (!ftp_arg || strlen(ftp_arg) == 0))
+    else if (!server_arg && !opp_arg && !broadcast_arg && (!ftp_arg || strlen(ftp_arg) == 0))
     {
         g_print("%s", g_option_context_get_help(context, FALSE, NULL));
         exit(EXIT_FAILURE);
@@ -435,15 +1847,85 @@ int main(int argc, char *argv[])
         g_print("Try `%s --help` for more information.\n", g_get_prgname());
         exit(EXIT_FAILURE);
     }
-    else if (opp_arg && (argc != 3 || strlen(argv[1]) == 0 || strlen(argv[2]) == 0))
+    else if (opp_arg && (argc < 3 || strlen(argv[1]) == 0 || strlen(argv[2]) == 0))
     {
         g_print("%s: Invalid arguments for --opp\n", g_get_prgname());
         g_print("Try `%s --help` for more information.\n", g_get_prgname());
         exit(EXIT_FAILURE);
     }
+    else if (broadcast_arg && (argc < 2 || strlen(broadcast_arg) == 0 || strlen(argv[1]) == 0))
+    {
+        g_print("%s: Invalid arguments for --broadcast\n", g_get_prgname());
+        g_print("Try `%s --help` for more information.\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+    else if ((mirror_arg || sync_arg) && (!ftp_arg || (mirror_arg && sync_arg) || argc != 3 || strlen(argv[1]) == 0 || strlen(argv[2]) == 0))
+    {
+        g_print("%s: Invalid arguments for --%s\n", g_get_prgname(), mirror_arg ? "mirror" : "sync");
+        g_print("Try `%s --help` for more information.\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+    else if ((ftp_script_arg && (!ftp_arg || mirror_arg || sync_arg || argc != 1 || strlen(ftp_script_arg) == 0)) || (pipeline_arg && !ftp_script_arg))
+    {
+        g_print("%s: Invalid arguments for --%s\n", g_get_prgname(), ftp_script_arg ? "ftp-script" : "pipeline");
+        g_print("Try `%s --help` for more information.\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+    else if (parallel_arg <= 0 || (retries_arg < 0 && retries_arg != G_MININT) || suspend_below_arg > 0)
+    {
+        g_print("%s: Invalid value for --%s\n", g_get_prgname(), parallel_arg <= 0 ? "parallel" : suspend_below_arg > 0 ? "suspend-below" : "retries");
+        g_print("Try `%s --help` for more information.\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+    else if (fsync_arg && !file_move_sync_from_string(fsync_arg, &_move_sync))
+    {
+        g_print("%s: Invalid value for --fsync: %s\n", g_get_prgname(), fsync_arg);
+        g_print("Try `%s --help` for more information.\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+
+    if (checksum_arg)
+    {
+        static const struct { const gchar *name; GChecksumType type; } checksums[] = {
+            {"md5", G_CHECKSUM_MD5},
+            {"sha1", G_CHECKSUM_SHA1},
+            {"sha256", G_CHECKSUM_SHA256},
+            {"sha512", G_CHECKSUM_SHA512},
+        };
+        for (guint i = 0; i < G_N_ELEMENTS(checksums); i++)
+        {
+            if (g_strcmp0(checksum_arg, checksums[i].name) == 0)
+            {
+                _checksum_type = checksums[i].type;
+                _checksum_name = checksums[i].name;
+            }
+        }
+        if (_checksum_type < 0)
+        {
+            g_print("%s: Invalid value for --checksum: %s\n", g_get_prgname(), checksum_arg);
+            g_print("Try `%s --help` for more information.\n", g_get_prgname());
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (progress_rate_arg <= 0)
+    {
+        g_print("%s: Invalid value for --progress-rate: %d\n", g_get_prgname(), progress_rate_arg);
+        g_print("Try `%s --help` for more information.\n", g_get_prgname());
+        exit(EXIT_FAILURE);
+    }
+
+    if (retries_arg == G_MININT)
+        retries_arg = broadcast_arg ? RETRY_DEFAULT_ATTEMPTS - 1 : 0;
+    _opp_retry.max_attempts = retries_arg + 1;
 
     g_option_context_free(context);
 
+    gint timeout_msec = -1;
+    if (timeout_arg && !dbus_call_timeout_parse(timeout_arg, &timeout_msec, &error))
+        exit_if_error(error);
+    dbus_set_call_timeout(timeout_msec);
+
     if (!dbus_system_connect(&error))
     {
         g_printerr("Couldn't connect to DBus system bus: %s\n", error->message);
@@ -490,15 +1972,19 @@ int main(int argc, char *argv[])
             exit_if_error(error);
         }
 
-        _transfers = g_hash_table_new(g_str_hash, g_str_equal);
-        _transfer_infos = g_hash_table_new(g_str_hash, g_str_equal);
+        _transfer_infos = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) _transfer_info_free);
+        _progress = progress_new(progress_rate_arg);
 
         ObexAgentManager *manager = obex_agent_manager_new();
         
         guint obex_server_object_id = g_dbus_connection_signal_subscribe(session_conn, "org.bluez.obex", "org.freedesktop.DBus.ObjectManager", NULL, NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, _obex_server_object_manager_handler, NULL, NULL);
         guint obex_server_properties_id = g_dbus_connection_signal_subscribe(session_conn, "org.bluez.obex", "org.freedesktop.DBus.Properties", "PropertiesChanged", NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, _obex_server_properties_handler, NULL, NULL);
         
+        _obex_model = object_model_new_for_connection(session_conn, BLUEZ_OBEX_DBUS_SERVICE_NAME, &error);
+        exit_if_error(error);
+
         ObexAgent *agent = obex_agent_new(root_folder, auto_accept);
+        obex_agent_set_object_model(agent, _obex_model);
         _root_path = g_strdup(root_folder);
         g_free(root_folder);
         obex_agent_set_approved_callback(agent, _agent_approved_callback, NULL);
@@ -509,40 +1995,20 @@ int main(int argc, char *argv[])
         mainloop = g_main_loop_new(NULL, FALSE);
 
         /* Add SIGTERM && SIGINT handlers */
-        struct sigaction sa;
-        memset(&sa, 0, sizeof (sa));
-        sa.sa_handler = sigterm_handler;
-        sigaction(SIGTERM, &sa, NULL);
-        sigaction(SIGINT, &sa, NULL);
+        _trap_signals();
 
         g_main_loop_run(mainloop);
 
         /* Waiting for connections... */
 
         g_main_loop_unref(mainloop);
+        dbus_set_call_cancellable(NULL);
 
         /* Stop active transfers */
-        GHashTableIter iter;
-        gpointer key, value;
-        
-        g_hash_table_iter_init(&iter, _transfers);
-        while (g_hash_table_iter_next(&iter, &key, &value))
-        {
-            ObexTransfer *t = OBEX_TRANSFER(value);
-            obex_transfer_cancel(t, NULL); // skip errors
-            g_object_unref(t);
-            g_hash_table_iter_remove(&iter);
-        }
-        g_hash_table_unref(_transfers);
-        
-        // Remove transfer information
-        g_hash_table_iter_init(&iter, _transfer_infos);
-        while (g_hash_table_iter_next(&iter, &key, &value))
-        {
-            g_free(value);
-            g_hash_table_iter_remove(&iter);
-        }
-        g_hash_table_unref(_transfers);
+        _transfer_infos_cancel_all();
+        g_hash_table_unref(_transfer_infos);
+        progress_free(_progress);
+        _progress = NULL;
 
         g_dbus_connection_signal_unsubscribe(session_conn, obex_server_object_id);
         g_dbus_connection_signal_unsubscribe(session_conn, obex_server_properties_id);
@@ -552,117 +2018,87 @@ int main(int argc, char *argv[])
         obex_agent_manager_unregister_agent(manager, OBEX_AGENT_DBUS_PATH, &error);
         g_object_unref(agent);
         g_object_unref(manager);
+        g_object_unref(_obex_model);
+        _obex_model = NULL;
     }
-    else if (opp_arg)
+    else if (opp_arg || broadcast_arg)
     {
-        opp_device_arg = argv[1];
-        opp_file_arg = argv[2];
-
-        /* Check that `file` is valid */
-        if (!is_file(opp_file_arg, &error))
+        /* Check that every `file` is valid before connecting */
+        _opp_files = g_ptr_array_new_with_free_func(g_free);
+        for (gint i = opp_arg ? 2 : 1; i < argc; i++)
         {
+            _opp_files_add(argv[i], &error);
             exit_if_error(error);
         }
-        
-        _transfers = g_hash_table_new(g_str_hash, g_str_equal);
-        _transfer_infos = g_hash_table_new(g_str_hash, g_str_equal);
-
-        gchar * files_to_send[] = {NULL, NULL};
-        files_to_send[0] = g_path_is_absolute(opp_file_arg) ? g_strdup(opp_file_arg) : get_absolute_path(opp_file_arg);
+        if (_opp_files->len == 0)
+        {
+            g_printerr("%s: Nothing to send\n", g_get_prgname());
+            exit(EXIT_FAILURE);
+        }
 
-        /* Get source address (address of adapter) */
-        Adapter *adapter = find_adapter(adapter_arg, &error);
-        exit_if_error(error);
-        gchar *src_address = g_strdup(adapter_get_address(adapter, &error));
-        exit_if_error(error);
-        
-        /* Get destination address (address of remote device) */
-        gchar *dst_address = NULL;
-        if (g_regex_match_simple("^\\x{2}:\\x{2}:\\x{2}:\\x{2}:\\x{2}:\\x{2}$", opp_device_arg, 0, 0))
+        _opp_targets = g_ptr_array_new_with_free_func((GDestroyNotify) _opp_target_free);
+        if (opp_arg)
         {
-            dst_address = g_strdup(opp_device_arg);
+            opp_device_arg = argv[1];
+            _opp_target_add(opp_device_arg, adapter_arg, &error);
+            exit_if_error(error);
         }
         else
         {
-            Device *device = find_device(adapter, opp_device_arg, &error);
-            exit_if_error(error);
-            dst_address = g_strdup(device_get_address(device, &error));
+            _opp_broadcast = TRUE;
+            _opp_parallel = parallel_arg;
+            _opp_targets_load(broadcast_arg, adapter_arg, &error);
             exit_if_error(error);
-            g_object_unref(device);
         }
+        
+        _transfer_infos = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) _transfer_info_free);
+        _progress = progress_new(progress_rate_arg);
 
-        g_object_unref(adapter);
-
-        /* Build arguments */
-        GVariantBuilder *b = g_variant_builder_new(G_VARIANT_TYPE_VARDICT);
-        g_variant_builder_add(b, "{sv}", "Target", g_variant_new_string("opp"));
-        g_variant_builder_add(b, "{sv}", "Source", g_variant_new_string(src_address));
-        GVariant *device_dict = g_variant_builder_end(b);
-        g_variant_builder_unref(b);
+        _transfer_manager = transfer_manager_new();
+        transfer_manager_set_rssi_threshold(_transfer_manager, suspend_below_arg);
+        g_unix_signal_add(SIGUSR1, _suspend_signal_handler, NULL);
+        g_unix_signal_add(SIGUSR2, _resume_signal_handler, NULL);
 
         mainloop = g_main_loop_new(NULL, FALSE);
 
-        ObexClient *client = obex_client_new();
-        const gchar *session_path = obex_client_create_session(client, dst_address, device_dict, &error);
-        exit_if_error(error);
-        ObexSession *session = obex_session_new(session_path);
-        ObexObjectPush *oop = obex_object_push_new(obex_session_get_dbus_object_path(session));
-        
         // initialize GDBus OBEX OPP client callbacks
         guint obex_opp_object_man_id = g_dbus_connection_signal_subscribe(session_conn, "org.bluez.obex", "org.freedesktop.DBus.ObjectManager", NULL, NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, _obex_opp_client_object_manager_handler, NULL, NULL);
         guint obex_opp_properties_id = g_dbus_connection_signal_subscribe(session_conn, "org.bluez.obex", "org.freedesktop.DBus.Properties", "PropertiesChanged", NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, _obex_opp_client_properties_handler, NULL, NULL);
-        
-        /* Sending file(s) */
-        obex_object_push_send_file(oop, files_to_send[0], &error);
-        exit_if_error(error);
 
-        /* Add SIGTERM && SIGINT handlers */
-        struct sigaction sa;
-        memset(&sa, 0, sizeof (sa));
-        sa.sa_handler = sigterm_handler;
-        sigaction(SIGTERM, &sa, NULL);
-        sigaction(SIGINT, &sa, NULL);
+        /* Sending file(s): sessions open up to --parallel per adapter, each sends its files in turn */
+        _opp_started = g_get_monotonic_time();
+        _opp_schedule();
 
-        g_main_loop_run(mainloop);
+        /* Add SIGTERM && SIGINT handlers */
+        _trap_signals();
 
-        /* Sending files process here ?? */
+        /* Nothing to wait for if no target could be resolved */
+        if (_opp_pending())
+            g_main_loop_run(mainloop);
 
         g_main_loop_unref(mainloop);
+        dbus_set_call_cancellable(NULL);
 
         g_dbus_connection_signal_unsubscribe(session_conn, obex_opp_object_man_id);
         g_dbus_connection_signal_unsubscribe(session_conn, obex_opp_properties_id);
         
         /* Stop active transfers */
-        GHashTableIter iter;
-        gpointer key, value;
-        
-        g_hash_table_iter_init(&iter, _transfers);
-        while (g_hash_table_iter_next(&iter, &key, &value))
-        {
-            ObexTransfer *t = OBEX_TRANSFER(value);
-            obex_transfer_cancel(t, NULL); // skip errors
-            g_object_unref(t);
-            g_hash_table_iter_remove(&iter);
-        }
-        g_hash_table_unref(_transfers);
-        
-        // Remove transfer information objects
-        g_hash_table_iter_init(&iter, _transfer_infos);
-        while (g_hash_table_iter_next(&iter, &key, &value))
-        {
-            g_free(value);
-            g_hash_table_iter_remove(&iter);
-        }
-        g_hash_table_unref(_transfers);
-        
-        g_object_unref(client);
-
-        g_variant_unref(device_dict);
-
-        g_free(src_address);
-        g_free(dst_address);
-        g_free(files_to_send[0]);
-        files_to_send[0] = NULL;
+        _transfer_infos_cancel_all();
+        g_hash_table_unref(_transfer_infos);
+        progress_free(_progress);
+        _progress = NULL;
+
+        gboolean all_sent = _opp_report();
+        for (guint i = 0; i < _opp_targets->len; i++)
+            _opp_session_close(g_ptr_array_index(_opp_targets, i));
+        g_dbus_connection_flush_sync(session_conn, NULL, NULL);
+        transfer_manager_free(_transfer_manager);
+        _transfer_manager = NULL;
+        g_ptr_array_unref(_opp_targets);
+        g_ptr_array_unref(_opp_files);
+
+        if (!all_sent)
+            exit(EXIT_FAILURE);
     }
     else if (ftp_arg)
     {
@@ -702,17 +2138,55 @@ int main(int argc, char *argv[])
 
         g_print("FTP session opened\n");
 
+        /* Sessions start at the root; kept up to date by cd and mkdir */
+        _ftp_cwd = g_strdup("/");
+        _ftp_cache = ftp_cache_new(ftp_session);
+        rl_attempted_completion_function = _ftp_completion;
+
+        _transfer_manager = transfer_manager_new();
+        transfer_manager_add_session(_transfer_manager, obex_file_transfer_get_dbus_object_path(ftp_session), dst_address);
+        transfer_manager_set_rssi_threshold(_transfer_manager, suspend_below_arg);
+        g_unix_signal_add(SIGUSR1, _suspend_signal_handler, NULL);
+        g_unix_signal_add(SIGUSR2, _resume_signal_handler, NULL);
+
+        _ftp_transfers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) _ftp_transfer_free);
+        guint ftp_properties_id = g_dbus_connection_signal_subscribe(session_conn, BLUEZ_OBEX_DBUS_SERVICE_NAME, "org.freedesktop.DBus.Properties", "PropertiesChanged", NULL, OBEX_TRANSFER_DBUS_INTERFACE, G_DBUS_SIGNAL_FLAGS_NONE, _ftp_transfer_properties_handler, NULL, NULL);
+        guint ftp_removed_id = g_dbus_connection_signal_subscribe(session_conn, BLUEZ_OBEX_DBUS_SERVICE_NAME, "org.freedesktop.DBus.ObjectManager", "InterfacesRemoved", NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, _ftp_transfer_removed_handler, NULL, NULL);
+
+        if (ftp_script_arg)
+        {
+            gboolean ok = _ftp_script(ftp_session, ftp_script_arg, pipeline_arg);
+            obex_client_remove_session(client, obex_file_transfer_get_dbus_object_path(ftp_session), NULL);
+            dbus_disconnect();
+            exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        if (mirror_arg || sync_arg)
+        {
+            gboolean ok = mirror_arg ?
+                    _ftp_sync(ftp_session, FTP_SYNC_MIRROR, _ftp_cwd, argv[1], argv[2]) :
+                    _ftp_sync(ftp_session, FTP_SYNC_PUSH, _ftp_cwd, argv[2], argv[1]);
+            obex_client_remove_session(client, obex_file_transfer_get_dbus_object_path(ftp_session), NULL);
+            dbus_disconnect();
+            exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
         while (TRUE)
         {
             gchar *cmd = readline("> ");
+            /* EOF (Ctrl-D, or stdin closed) ends the session like exit */
             if (cmd == NULL)
             {
-                continue;
+                g_print("\n");
+                break;
             }
-            else
+
+            if (strspn(cmd, " \t") == strlen(cmd))
             {
-                add_history(cmd);
+                g_free(cmd);
+                continue;
             }
+            add_history(cmd);
 
             gint f_argc;
             gchar **f_argv;
@@ -727,249 +2201,26 @@ int main(int argc, char *argv[])
                 continue;
             }
 
-            /* Execute commands */
-            if (g_strcmp0(f_argv[0], "cd") == 0)
-            {
-                if (f_argc != 2 || strlen(f_argv[1]) == 0)
-                {
-                    g_print("invalid arguments\n");
-                }
-                else
-                {
-                    obex_file_transfer_change_folder(ftp_session, f_argv[1], &error);
-                    if (error)
-                    {
-                        g_print("%s\n", error->message);
-                        g_error_free(error);
-                        error = NULL;
-                    }
-                }
-            }
-            else if (g_strcmp0(f_argv[0], "mkdir") == 0)
-            {
-                if (f_argc != 2 || strlen(f_argv[1]) == 0)
-                {
-                    g_print("invalid arguments\n");
-                }
-                else
-                {
-                    obex_file_transfer_create_folder(ftp_session, f_argv[1], &error);
-                    if (error)
-                    {
-                        g_print("%s\n", error->message);
-                        g_error_free(error);
-                        error = NULL;
-                    }
-                }
-            }
-            else if (g_strcmp0(f_argv[0], "ls") == 0)
-            {
-                if (f_argc != 1)
-                {
-                    g_print("invalid arguments\n");
-                }
-                else
-                {
-                    // GPtrArray *folders = obex_file_transfer_list_folder(ftp_session, &error);
-                    GVariant *folder_list = obex_file_transfer_list_folder(ftp_session, &error);
-                    GPtrArray *folders = g_ptr_array_new();
-                    gsize arr_size = 0;
-                    // Pass the pointer
-                    folders->pdata = (gpointer) g_variant_get_fixed_array(folder_list, &arr_size, sizeof(gpointer));
-                    folders->len = arr_size;
-                    
-                    if (error)
-                    {
-                        g_print("%s\n", error->message);
-                        g_error_free(error);
-                        error = NULL;
-                    }
-                    else
-                    {
-                        for (int i = 0; i < folders->len; i++)
-                        {
-                            /*
-                            GHashTable *el = g_ptr_array_index(folders, i);
-                            g_print(
-                                    "%s\t%llu\t%s\n",
-                                    g_value_get_string(g_hash_table_lookup(el, "Type")),
-                                    G_VALUE_HOLDS_UINT64(g_hash_table_lookup(el, "Size")) ?
-                                    g_value_get_uint64(g_hash_table_lookup(el, "Size")) :
-                                    0,
-                                    g_value_get_string(g_hash_table_lookup(el, "Name"))
-                                    );
-                            */
-                            
-                            // DO NOT FREE THIS
-                            GVariant *el = g_ptr_array_index(folders, i);
-                            g_print(
-                                    "%s\t%" G_GINT64_FORMAT"\t%s\n",
-                                    g_variant_get_string(g_variant_lookup_value(el, "Type", G_VARIANT_TYPE("s")), NULL),
-                                    g_variant_get_uint64(g_variant_lookup_value(el, "Size", G_VARIANT_TYPE("t"))),
-                                    g_variant_get_string(g_variant_lookup_value(el, "Name", G_VARIANT_TYPE("s")), NULL)
-                                    );
-                        }
-                    }
-                    
-                    // Do not free the contents of the array. g_variant_unref will free contents
-                    if (folders)
-                        g_ptr_array_free(folders, FALSE);
-                    
-                    if (folder_list)
-                        g_variant_unref(folder_list);
-
-                    /*obexclient_remove_session(client, obexclient_file_transfer_get_dbus_object_path(ftp_session), &error);
-                    exit_if_error(error);
-                    g_object_unref(ftp_session);
-                    session_path = obexclient_create_session(client, device_dict, &error);
-                    exit_if_error(error);
-                    ftp_session = g_object_new(OBEXCLIENT_FILE_TRANSFER_TYPE, "DBusObjectPath", session_path, NULL);
-                    g_free(session_path);*/
-
-                }
-            }
-            else if (g_strcmp0(f_argv[0], "get") == 0)
-            {
-                if (f_argc != 3 || strlen(f_argv[1]) == 0 || strlen(f_argv[2]) == 0)
-                {
-                    g_print("invalid arguments\n");
-                }
-                else
-                {
-                    gchar *abs_dst_path = get_absolute_path(f_argv[2]);
-                    gchar *dir = g_path_get_dirname(abs_dst_path);
-                    if (!is_dir(dir, &error))
-                    {
-                        g_print("%s\n", error->message);
-                        g_error_free(error);
-                        error = NULL;
-                    }
-                    else
-                    {
-                        obex_file_transfer_get_file(ftp_session, abs_dst_path, f_argv[1], &error);
-                        if (error)
-                        {
-                            g_print("%s\n", error->message);
-                            g_error_free(error);
-                            error = NULL;
-                        }
-                    }
-                    g_free(dir);
-                    g_free(abs_dst_path);
-                }
-            }
-            else if (g_strcmp0(f_argv[0], "put") == 0)
-            {
-                if (f_argc != 3 || strlen(f_argv[1]) == 0 || strlen(f_argv[2]) == 0)
-                {
-                    g_print("invalid arguments\n");
-                }
-                else
-                {
-                    gchar *abs_src_path = get_absolute_path(f_argv[1]);
-                    if (!is_file(abs_src_path, &error))
-                    {
-                        g_print("%s\n", error->message);
-                        g_error_free(error);
-                        error = NULL;
-                    }
-                    else
-                    {
-                        obex_file_transfer_put_file(ftp_session, abs_src_path, f_argv[2], &error);
-                        if (error)
-                        {
-                            g_print("%s\n", error->message);
-                            g_error_free(error);
-                            error = NULL;
-                        }
-                    }
-                    g_free(abs_src_path);
-                }
-            }
-            else if (g_strcmp0(f_argv[0], "cp") == 0)
-            {
-                if (f_argc != 3 || strlen(f_argv[1]) == 0 || strlen(f_argv[2]) == 0)
-                {
-                    g_print("invalid arguments\n");
-                }
-                else
-                {
-                    obex_file_transfer_copy_file(ftp_session, f_argv[1], f_argv[2], &error);
-                    if (error)
-                    {
-                        g_print("%s\n", error->message);
-                        g_error_free(error);
-                        error = NULL;
-                    }
-                }
-            }
-            else if (g_strcmp0(f_argv[0], "mv") == 0)
-            {
-                if (f_argc != 3 || strlen(f_argv[1]) == 0 || strlen(f_argv[2]) == 0)
-                {
-                    g_print("invalid arguments\n");
-                }
-                else
-                {
-                    obex_file_transfer_move_file(ftp_session, f_argv[1], f_argv[2], &error);
-                    if (error)
-                    {
-                        g_print("%s\n", error->message);
-                        g_error_free(error);
-                        error = NULL;
-                    }
-                }
-            }
-            else if (g_strcmp0(f_argv[0], "rm") == 0)
-            {
-                if (f_argc != 2 || strlen(f_argv[1]) == 0)
-                {
-                    g_print("invalid arguments\n");
-                }
-                else
-                {
-                    obex_file_transfer_delete(ftp_session, f_argv[1], &error);
-                    if (error)
-                    {
-                        g_print("%s\n", error->message);
-                        g_error_free(error);
-                        error = NULL;
-                    }
-                }
-            }
-            else if (g_strcmp0(f_argv[0], "help") == 0)
-            {
-                g_print(
-                        "help\t\t\tShow this message\n"
-                        "exit\t\t\tClose FTP session\n"
-                        "cd <folder>\t\tChange the current folder of the remote device\n"
-                        "mkdir <folder>\t\tCreate a new folder in the remote device\n"
-                        "ls\t\t\tList folder contents\n"
-                        "get <src> <dst>\t\tCopy the src file (from remote device) to the dst file (on local filesystem)\n"
-                        "put <src> <dst>\t\tCopy the src file (from local filesystem) to the dst file (on remote device)\n"
-                        "cp <src> <dst>\t\tCopy a file within the remote device from src file to dst file\n"
-                        "mv <src> <dst>\t\tMove a file within the remote device from src file to dst file\n"
-                        "rm <target>\t\tDeletes the specified file/folder\n"
-                        );
-            }
-            else if (g_strcmp0(f_argv[0], "exit") == 0 || g_strcmp0(f_argv[0], "quit") == 0)
-            {
-                obex_client_remove_session(client, obex_file_transfer_get_dbus_object_path(ftp_session), &error);
-                exit_if_error(error);
-
-                g_strfreev(f_argv);
-                g_free(cmd);
-                break;
-            }
-            else
-            {
-                g_print("invalid command\n");
-            }
+            gboolean quit = g_strcmp0(f_argv[0], "exit") == 0 || g_strcmp0(f_argv[0], "quit") == 0;
+            if (!quit)
+                _ftp_command(ftp_session, f_argc, f_argv, FALSE, FALSE, 0);
 
             g_strfreev(f_argv);
             g_free(cmd);
+            if (quit)
+                break;
         }
 
+        obex_client_remove_session(client, obex_file_transfer_get_dbus_object_path(ftp_session), &error);
+        exit_if_error(error);
+
+        g_dbus_connection_signal_unsubscribe(session_conn, ftp_properties_id);
+        g_dbus_connection_signal_unsubscribe(session_conn, ftp_removed_id);
+        g_hash_table_unref(_ftp_transfers);
+        transfer_manager_free(_transfer_manager);
+        _transfer_manager = NULL;
+        ftp_cache_free(_ftp_cache);
+        g_free(_ftp_cwd);
         g_object_unref(agent);
         g_object_unref(client);
         g_object_unref(ftp_session);
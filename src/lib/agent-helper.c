@@ -31,331 +31,707 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include "dbus-common.h"
 #include "agent-helper.h"
+#include "bluez/agent_interface.h"
 
 gboolean agent_need_unregister;
 
-static const gchar *_bt_agent_introspect_xml = "<node name=\"/org/blueztools\">\n\t<interface name=\"org.bluez.Agent1\">\n\t\t<method name=\"Release\">\n\t\t</method>\n\t\t<method name=\"RequestPinCode\">\n\t\t\t<arg name=\"device\" direction=\"in\" type=\"o\"/>\n\t\t\t<arg name=\"pincode\" direction=\"out\" type=\"s\"/>\n\t\t</method>\n\t\t<method name=\"DisplayPinCode\">\n\t\t\t<arg name=\"device\" direction=\"in\" type=\"o\"/>\n\t\t\t<arg name=\"pincode\" direction=\"in\" type=\"s\"/>\n\t\t</method>\n\t\t<method name=\"RequestPasskey\">\n\t\t\t<arg name=\"device\" direction=\"in\" type=\"o\"/>\n\t\t\t<arg name=\"passkey\" direction=\"out\" type=\"u\"/>\n\t\t</method>\n\t\t<method name=\"DisplayPasskey\">\n\t\t\t<arg name=\"device\" direction=\"in\" type=\"o\"/>\n\t\t\t<arg name=\"passkey\" direction=\"in\" type=\"u\"/>\n\t\t\t<arg name=\"entered\" direction=\"in\" type=\"q\"/>\n\t\t</method>\n\t\t<method name=\"RequestConfirmation\">\n\t\t\t<arg name=\"device\" direction=\"in\" type=\"o\"/>\n\t\t\t<arg name=\"passkey\" direction=\"in\" type=\"u\"/>\n\t\t</method>\n\t\t<method name=\"RequestAuthorization\">\n\t\t\t<arg name=\"device\" direction=\"in\" type=\"o\"/>\n\t\t</method>\n\t\t<method name=\"AuthorizeService\">\n\t\t\t<arg name=\"device\" direction=\"in\" type=\"o\"/>\n\t\t\t<arg name=\"uuid\" direction=\"in\" type=\"s\"/>\n\t\t</method>\n\t\t<method name=\"Cancel\">\n\t\t</method>\n\t</interface>\n</node>\n";
 static guint _bt_agent_registration_id = 0;
 static GHashTable *_pin_hash_table = NULL;
+static PinDb *_pin_db = NULL;
+static PinRules *_pin_rules = NULL;
+static AuditLog *_audit_log = NULL;
 static gboolean _interactive = TRUE;
 static GMainLoop *_mainloop = NULL;
 
 static void _bt_agent_g_destroy_notify(gpointer data);
 static void _bt_agent_method_call_func(GDBusConnection *connection, const gchar *sender, const gchar *object_path, const gchar *interface_name, const gchar *method_name, GVariant *parameters, GDBusMethodInvocation *invocation, gpointer user_data);
-static const gchar *_find_device_pin(const gchar *device_path);
 
-static void _bt_agent_method_call_func(GDBusConnection *connection, const gchar *sender, const gchar *object_path, const gchar *interface_name, const gchar *method_name, GVariant *parameters, GDBusMethodInvocation *invocation, gpointer user_data)
+typedef struct {
+    gchar *alias;
+    gchar *address;
+    gchar *adapter;
+    gboolean paired;
+} AgentDeviceInfo;
+
+/* What the agent may do for a device of an adapter with a given policy */
+typedef struct {
+    const gchar *name;
+    gboolean display;   /* show passkeys and PINs */
+    gboolean keyboard;  /* ask for a passkey or PIN */
+    gboolean yes_no;    /* ask for a confirmation */
+} AgentPolicyCaps;
+
+static const AgentPolicyCaps _policy_caps[] = {
+    [AGENT_POLICY_DEFAULT]            = {NULL, TRUE, TRUE, TRUE},
+    [AGENT_POLICY_DISPLAY_ONLY]       = {"DisplayOnly", TRUE, FALSE, FALSE},
+    [AGENT_POLICY_DISPLAY_YES_NO]     = {"DisplayYesNo", TRUE, FALSE, TRUE},
+    [AGENT_POLICY_KEYBOARD_ONLY]      = {"KeyboardOnly", FALSE, TRUE, FALSE},
+    [AGENT_POLICY_NO_INPUT_NO_OUTPUT] = {"NoInputNoOutput", FALSE, FALSE, FALSE},
+    [AGENT_POLICY_KEYBOARD_DISPLAY]   = {"KeyboardDisplay", TRUE, TRUE, TRUE},
+    [AGENT_POLICY_REJECT]             = {"Reject", FALSE, FALSE, FALSE},
+};
+
+/* Adapter object path -> AgentPolicy; adapters not in it get AGENT_POLICY_DEFAULT */
+static GHashTable *_adapter_policies = NULL;
+
+/* Continues a request once the device it is about is known; `error` is set if the lookup failed */
+typedef void (*AgentRequestFunc)(GDBusMethodInvocation *invocation, const AgentDeviceInfo *info, GError *error);
+
+typedef struct {
+    GDBusMethodInvocation *invocation;
+    AgentRequestFunc func;
+} AgentPendingRequest;
+
+/* Devices the object model had not seen yet, by object path, as GetAll returned them */
+static GHashTable *_device_infos = NULL;
+/* Object path -> GSList of AgentPendingRequest waiting on the one GetAll for that device */
+static GHashTable *_device_lookups = NULL;
+static ObjectModel *_device_model = NULL;
+static gulong _device_removed_handler_id = 0;
+static gulong _device_changed_handler_id = 0;
+
+/* Per-device token buckets, checked before anything touches the bus */
+typedef struct {
+    gdouble tokens;
+    gint64 updated;
+} AgentRateBucket;
+
+static GHashTable *_rate_buckets = NULL;
+static guint _rate_per_minute = AGENT_DEFAULT_RATE_LIMIT;
+static guint _max_pending = AGENT_DEFAULT_MAX_PENDING;
+static guint _pending_count = 0;
+
+static gboolean _agent_rate_bucket_is_full(gpointer key, gpointer value, gpointer user_data)
 {
-    // g_print("%s%s\n", method_name, g_variant_print(parameters, FALSE));
+    AgentRateBucket *bucket = value;
+    gint64 now = *(gint64 *) user_data;
+    return bucket->tokens + (now - bucket->updated) * _rate_per_minute / (60.0 * G_USEC_PER_SEC) >= _rate_per_minute;
+}
+
+/* A device may make up to the limit in a burst, then one request per 60/limit seconds */
+static gboolean _agent_rate_admit(const gchar *device_path)
+{
+    if (_rate_per_minute == 0)
+        return TRUE;
 
-    if (g_strcmp0(method_name, "AuthorizeService") == 0)
+    if (!_rate_buckets)
+        _rate_buckets = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    gint64 now = g_get_monotonic_time();
+    AgentRateBucket *bucket = g_hash_table_lookup(_rate_buckets, device_path);
+    if (!bucket)
     {
-        GError *error = NULL;
-        Device *device_obj = device_new(g_variant_get_string(g_variant_get_child_value(parameters, 0), NULL));
-        const char *uuid = g_variant_get_string(g_variant_get_child_value(parameters, 1), NULL);
+        /* Buckets that have refilled carry no state, drop them so the table stays small */
+        if (g_hash_table_size(_rate_buckets) >= 1024)
+            g_hash_table_foreach_remove(_rate_buckets, _agent_rate_bucket_is_full, &now);
+
+        bucket = g_new0(AgentRateBucket, 1);
+        bucket->tokens = _rate_per_minute;
+        bucket->updated = now;
+        g_hash_table_insert(_rate_buckets, g_strdup(device_path), bucket);
+    }
 
-        if (_interactive)
-          g_print("Device: %s (%s) for UUID %s\n", device_get_alias(device_obj, &error), device_get_address(device_obj, &error), uuid);
+    bucket->tokens = MIN(_rate_per_minute, bucket->tokens + (now - bucket->updated) * _rate_per_minute / (60.0 * G_USEC_PER_SEC));
+    bucket->updated = now;
+    if (bucket->tokens < 1.0)
+        return FALSE;
 
-        if (error)
-        {
-            g_critical("Failed to get remote device's MAC address: %s", error->message);
-            g_error_free(error);
-            g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "Internal error occurred");
-            return;
-        }
+    bucket->tokens -= 1.0;
+    return TRUE;
+}
 
-        if (device_get_paired (device_obj, &error))
-        {
-            g_dbus_method_invocation_return_value(invocation, NULL);
-        }
-        else if (error)
-        {
-            g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "Internal error occurred");
-            g_error_free (error);
-        }
+static void _agent_device_info_clear(AgentDeviceInfo *info)
+{
+    g_free(info->alias);
+    g_free(info->address);
+    g_free(info->adapter);
+    memset(info, 0, sizeof(AgentDeviceInfo));
+}
+
+static void _agent_device_info_free(gpointer data)
+{
+    _agent_device_info_clear(data);
+    g_free(data);
+}
+
+/* Takes whichever of Alias/Address/Adapter/Paired are in the a{sv} `props` */
+static void _agent_device_info_update(AgentDeviceInfo *info, GVariant *props)
+{
+    gchar *value = NULL;
+
+    if (g_variant_lookup(props, "Alias", "s", &value))
+    {
+        g_free(info->alias);
+        info->alias = value;
+    }
+    if (g_variant_lookup(props, "Address", "s", &value))
+    {
+        g_free(info->address);
+        info->address = value;
+    }
+    if (g_variant_lookup(props, "Adapter", "o", &value))
+    {
+        g_free(info->adapter);
+        info->adapter = value;
+    }
+    g_variant_lookup(props, "Paired", "b", &info->paired);
+}
+
+static AgentDeviceInfo *_agent_device_info_insert(const gchar *device_path, GVariant *props)
+{
+    AgentDeviceInfo *info = g_new0(AgentDeviceInfo, 1);
+    _agent_device_info_update(info, props);
+    g_hash_table_replace(_device_infos, g_strdup(device_path), info);
+    return info;
+}
+
+/* The model saw the device go or change, so our copy is stale; the next request asks again */
+static void _agent_device_removed(ObjectModel *model, const gchar *object_path, const gchar *interface_name, gpointer user_data)
+{
+    if (g_strcmp0(interface_name, DEVICE_DBUS_INTERFACE) == 0)
+        g_hash_table_remove(_device_infos, object_path);
+}
+
+static void _agent_device_changed(ObjectModel *model, const gchar *object_path, const gchar *interface_name, GVariant *changed_properties, gpointer user_data)
+{
+    if (g_strcmp0(interface_name, DEVICE_DBUS_INTERFACE) == 0)
+        g_hash_table_remove(_device_infos, object_path);
+}
+
+static void _agent_device_infos_init()
+{
+    if (!_device_infos)
+    {
+        _device_infos = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, _agent_device_info_free);
+        _device_lookups = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    }
+
+    ObjectModel *model = object_model_get_default();
+    if (!model || model == _device_model)
+        return;
+    _device_model = g_object_ref(model);
+    _device_removed_handler_id = g_signal_connect(model, "object-removed", G_CALLBACK(_agent_device_removed), NULL);
+    _device_changed_handler_id = g_signal_connect(model, "properties-changed", G_CALLBACK(_agent_device_changed), NULL);
+}
+
+static void _agent_device_infos_free()
+{
+    if (_device_model)
+    {
+        g_signal_handler_disconnect(_device_model, _device_removed_handler_id);
+        g_signal_handler_disconnect(_device_model, _device_changed_handler_id);
+        g_object_unref(_device_model);
+        _device_model = NULL;
+    }
+
+    /* Lookups still in flight finish against an empty table */
+    if (_device_infos)
+        g_hash_table_remove_all(_device_infos);
+}
+
+static void _agent_request_run(GDBusMethodInvocation *invocation, AgentRequestFunc func, const AgentDeviceInfo *info, GError *error);
+
+static void _agent_device_info_ready(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    gchar *device_path = user_data;
+    AgentDeviceInfo fetched_info;
+    AgentDeviceInfo *info = &fetched_info;
+    GError *error = NULL;
+    memset(&fetched_info, 0, sizeof(AgentDeviceInfo));
+
+    GVariant *ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source_object), res, &error);
+    if (ret)
+    {
+        GVariant *props = g_variant_get_child_value(ret, 0);
+        /* Without a model nothing would evict the entry, so only the waiting requests get it */
+        if (_device_model)
+            info = _agent_device_info_insert(device_path, props);
         else
-        {
-            g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "Service authorization rejected");
-        }
+            _agent_device_info_update(info, props);
+        g_variant_unref(props);
+        g_variant_unref(ret);
     }
-    else if (g_strcmp0(method_name, "Cancel") == 0)
+
+    GSList *waiting = NULL;
+    g_hash_table_lookup_extended(_device_lookups, device_path, NULL, (gpointer *) &waiting);
+    g_hash_table_remove(_device_lookups, device_path);
+    waiting = g_slist_reverse(waiting);
+
+    for (GSList *l = waiting; l; l = l->next)
     {
-        if (_interactive)
-            g_print("Request canceled\n");
-        // Return void
-        g_dbus_method_invocation_return_value(invocation, NULL);
+        AgentPendingRequest *pending = l->data;
+        _pending_count--;
+        _agent_request_run(pending->invocation, pending->func, info, error);
+        g_free(pending);
     }
-    else if (g_strcmp0(method_name, "DisplayPasskey") == 0)
+
+    g_slist_free(waiting);
+    _agent_device_info_clear(&fetched_info);
+    if (error)
+        g_error_free(error);
+    g_free(device_path);
+}
+
+/* Records the decision when an audit log is set; never blocks, see audit_log_append() */
+static void _agent_audit(GDBusMethodInvocation *invocation, const AgentDeviceInfo *info, AuditDecision decision, AuditReason reason)
+{
+    if (!_audit_log)
+        return;
+
+    GVariant *parameters = g_dbus_method_invocation_get_parameters(invocation);
+    AgentMethodId method = agent_method_id(invocation);
+    const gchar *device_path = NULL;
+    AuditRecord record;
+    memset(&record, 0, sizeof(AuditRecord));
+
+    record.method = method;
+    record.decision = decision;
+    record.reason = reason;
+    g_variant_get_child(parameters, 0, "&o", &device_path);
+
+    if (info && info->address)
+        g_strlcpy(record.address, info->address, sizeof(record.address));
+    else
+        audit_address_from_path(device_path, record.address);
+    if (info && info->alias)
+        g_strlcpy(record.alias, info->alias, sizeof(record.alias));
+
+    /* Passkeys shown on both sides are logged; PINs handed out are not */
+    if (method == AGENT_METHOD_REQUEST_CONFIRMATION || method == AGENT_METHOD_DISPLAY_PASSKEY)
+        g_variant_get_child(parameters, 1, "u", &record.passkey);
+    else if (method == AGENT_METHOD_AUTHORIZE_SERVICE)
     {
-        GError *error = NULL;
-        Device *device_obj = device_new(g_variant_get_string(g_variant_get_child_value(parameters, 0), NULL));
-        const gchar *pin = _find_device_pin(device_get_dbus_object_path(device_obj));
+        const gchar *uuid = NULL;
+        g_variant_get_child(parameters, 1, "&s", &uuid);
+        g_strlcpy(record.detail, uuid, sizeof(record.detail));
+    }
+
+    audit_log_append(_audit_log, &record);
+}
+
+static void _agent_accept(GDBusMethodInvocation *invocation, const AgentDeviceInfo *info, AuditReason reason, GVariant *ret)
+{
+    _agent_audit(invocation, info, AUDIT_DECISION_ACCEPTED, reason);
+    g_dbus_method_invocation_return_value(invocation, ret);
+}
+
+static void _agent_reject(GDBusMethodInvocation *invocation, const AgentDeviceInfo *info, AuditReason reason, const gchar *message)
+{
+    _agent_audit(invocation, info, AUDIT_DECISION_REJECTED, reason);
+    g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", message);
+}
 
+static AgentPolicy _agent_policy(GDBusMethodInvocation *invocation, const AgentDeviceInfo *info)
+{
+    if (!_adapter_policies)
+        return AGENT_POLICY_DEFAULT;
+    if (info->adapter)
+        return GPOINTER_TO_INT(g_hash_table_lookup(_adapter_policies, info->adapter));
+
+    /* Lookup failed: BlueZ keeps devices below their adapter, /org/bluez/hciX/dev_... */
+    const gchar *device_path = NULL;
+    g_variant_get_child(g_dbus_method_invocation_get_parameters(invocation), 0, "&o", &device_path);
+    gchar *adapter_path = g_path_get_dirname(device_path);
+    AgentPolicy policy = GPOINTER_TO_INT(g_hash_table_lookup(_adapter_policies, adapter_path));
+    g_free(adapter_path);
+    return policy;
+}
+
+/* Hands a request to `func`, unless the device's adapter takes no requests at all */
+static void _agent_request_run(GDBusMethodInvocation *invocation, AgentRequestFunc func, const AgentDeviceInfo *info, GError *error)
+{
+    if (_agent_policy(invocation, info) == AGENT_POLICY_REJECT)
+    {
         if (_interactive)
-            g_print("Device: %s (%s)\n", device_get_alias(device_obj, &error), device_get_address(device_obj, &error));
+            g_print("Device: %s (%s): rejected by policy\n", info->alias ? info->alias : "-", info->address ? info->address : "-");
+        _agent_reject(invocation, info, AUDIT_REASON_POLICY, "Pairing rejected");
+        return;
+    }
+    func(invocation, info, error);
+}
 
-        if (error)
-        {
-            g_critical("Failed to get remote device's MAC address: %s", error->message);
-            g_error_free(error);
-        }
+/*
+ * Resolve what the agent needs to know about a device, then call `func`.
+ * From the object model when it knows the device, or from an earlier
+ * GetAll for one it had not seen; otherwise with one asynchronous GetAll
+ * shared by every request for that device, so other requests are served
+ * in the meantime.
+ */
+static void _agent_with_device_info(GDBusMethodInvocation *invocation, AgentRequestFunc func)
+{
+    const gchar *device_path = NULL;
+    ObjectModel *model = object_model_get_default();
 
-        g_object_unref(device_obj);
+    g_variant_get_child(g_dbus_method_invocation_get_parameters(invocation), 0, "&o", &device_path);
 
+    if (!_agent_rate_admit(device_path))
+    {
         if (_interactive)
-        {
-            g_print("Passkey: %u, entered: %u\n", g_variant_get_uint32(g_variant_get_child_value(parameters, 1)), g_variant_get_uint16(g_variant_get_child_value(parameters, 2)));
-            g_dbus_method_invocation_return_value(invocation, NULL);
-            return;
-        }
-        else if (pin != NULL)
-        {
-            /* OK, device found */
-            g_dbus_method_invocation_return_value(invocation, NULL);
-            return;
-        }
+            g_print("Device %s: too many requests, rejected\n", device_path);
+        _agent_reject(invocation, NULL, AUDIT_REASON_RATE_LIMITED, "Too many requests");
+        return;
+    }
 
-        g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "Pairing rejected");
+    if (model && object_model_has_interface(model, device_path, DEVICE_DBUS_INTERFACE))
+    {
+        /* The strings belong to the model and stay valid while the request runs */
+        AgentDeviceInfo model_info;
+        model_info.alias = (gchar *) object_model_get_string(model, device_path, DEVICE_DBUS_INTERFACE, "Alias");
+        model_info.address = (gchar *) object_model_get_string(model, device_path, DEVICE_DBUS_INTERFACE, "Address");
+        model_info.adapter = (gchar *) object_model_get_string(model, device_path, DEVICE_DBUS_INTERFACE, "Adapter");
+        model_info.paired = object_model_get_boolean(model, device_path, DEVICE_DBUS_INTERFACE, "Paired");
+        _agent_request_run(invocation, func, &model_info, NULL);
+        return;
     }
-    else if (g_strcmp0(method_name, "DisplayPinCode") == 0)
+
+    AgentDeviceInfo *info = g_hash_table_lookup(_device_infos, device_path);
+    if (info)
     {
-        GError *error = NULL;
-        Device *device_obj = device_new(g_variant_get_string(g_variant_get_child_value(parameters, 0), NULL));
-        const gchar *pin = _find_device_pin(device_get_dbus_object_path(device_obj));
-        const gchar *pincode = g_variant_get_string(g_variant_get_child_value(parameters, 1), NULL);
+        _agent_request_run(invocation, func, info, NULL);
+        return;
+    }
 
-        if (_interactive)
-            g_print("Device: %s (%s)\n", device_get_alias(device_obj, &error), device_get_address(device_obj, &error));
+    /* Known devices are answered at once; only lookups on the bus can pile up */
+    if (_max_pending && _pending_count >= _max_pending)
+    {
+        _agent_reject(invocation, NULL, AUDIT_REASON_BUSY, "Agent busy");
+        return;
+    }
 
-        if (error)
-        {
-            g_critical("Failed to get remote device's MAC address: %s", error->message);
-            g_error_free(error);
-        }
+    AgentPendingRequest *pending = g_new0(AgentPendingRequest, 1);
+    pending->invocation = invocation;
+    pending->func = func;
+    _pending_count++;
 
-        g_object_unref(device_obj);
+    GSList *waiting = NULL;
+    gboolean in_flight = g_hash_table_lookup_extended(_device_lookups, device_path, NULL, (gpointer *) &waiting);
+    g_hash_table_insert(_device_lookups, g_strdup(device_path), g_slist_prepend(waiting, pending));
+    if (in_flight)
+        return;
 
-        /* Try to use found PIN */
-        if (pin != NULL)
-        {
-            if (g_strcmp0(pin, "*") == 0 || g_strcmp0(pin, pincode) == 0)
-            {
-                if (_interactive)
-                    g_print("Pin code confirmed\n");
-                g_dbus_method_invocation_return_value(invocation, NULL);
-            }
-            else
-                g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "Passkey does not match");
-
-            return;
-        }
-        else if (_interactive)
-        {
-            g_print("Confirm pin code: %s (yes/no)? ", pincode);
-
-            gchar yn[4] = {0,};
-            errno = 0;
-            if (scanf("%3s", yn) == EOF && errno)
-                g_warning("%s\n", strerror(errno));
-            if(g_ascii_strcasecmp(yn, "yes") == 0 || g_ascii_strcasecmp(yn, "y") == 0)
-                g_dbus_method_invocation_return_value(invocation, NULL);
-            else
-                g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "Passkey does not match");
-            return;
-        }
+    g_dbus_connection_call(g_dbus_method_invocation_get_connection(invocation), BLUEZ_DBUS_SERVICE_NAME, device_path, "org.freedesktop.DBus.Properties", "GetAll", g_variant_new("(s)", DEVICE_DBUS_INTERFACE), G_VARIANT_TYPE("(a{sv})"), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), _agent_device_info_ready, g_strdup(device_path));
+}
+
+static const gchar *_find_device_pin(const AgentDeviceInfo *info);
+
+static void _agent_device_info_report(const AgentDeviceInfo *info, GError *error)
+{
+    if (_interactive)
+        g_print("Device: %s (%s)\n", info->alias, info->address);
 
-        g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "Pairing rejected");
+    if (error)
+        g_critical("Failed to get remote device's MAC address: %s", error->message);
+}
+
+static void _bt_agent_authorize_service(GDBusMethodInvocation *invocation, const AgentDeviceInfo *info, GError *error)
+{
+    const gchar *uuid = NULL;
+    g_variant_get_child(g_dbus_method_invocation_get_parameters(invocation), 1, "&s", &uuid);
+
+    if (error)
+    {
+        g_critical("Failed to get remote device's MAC address: %s", error->message);
+        _agent_reject(invocation, info, AUDIT_REASON_LOOKUP_FAILED, "Internal error occurred");
+        return;
     }
-    else if (g_strcmp0(method_name, "Release") == 0)
+
+    if (_interactive)
+      g_print("Device: %s (%s) for UUID %s\n", info->alias, info->address, uuid);
+
+    if (info->paired)
     {
-        agent_need_unregister = FALSE;
+        _agent_accept(invocation, info, AUDIT_REASON_PAIRED, NULL);
+    }
+    else
+    {
+        _agent_reject(invocation, info, AUDIT_REASON_NOT_PAIRED, "Service authorization rejected");
+    }
+}
 
-        if(_mainloop)
-            if (g_main_loop_is_running(_mainloop))
-                g_main_loop_quit(_mainloop);
+static void _bt_agent_display_passkey(GDBusMethodInvocation *invocation, const AgentDeviceInfo *info, GError *error)
+{
+    GVariant *parameters = g_dbus_method_invocation_get_parameters(invocation);
+    const AgentPolicyCaps *caps = &_policy_caps[_agent_policy(invocation, info)];
+    const gchar *pin = _find_device_pin(info);
 
-        g_print("Agent released\n");
+    _agent_device_info_report(info, error);
 
-        // Return void
-        g_dbus_method_invocation_return_value(invocation, NULL);
+    if (_interactive && caps->display)
+    {
+        g_print("Passkey: %u, entered: %u\n", g_variant_get_uint32(g_variant_get_child_value(parameters, 1)), g_variant_get_uint16(g_variant_get_child_value(parameters, 2)));
+        _agent_accept(invocation, info, AUDIT_REASON_USER, NULL);
+        return;
+    }
+    else if (pin != NULL)
+    {
+        /* OK, device found */
+        _agent_accept(invocation, info, AUDIT_REASON_PIN_FILE, NULL);
+        return;
     }
-    else if (g_strcmp0(method_name, "RequestAuthorization") == 0)
+    else if (!caps->display)
     {
-        GError *error = NULL;
-        Device *device_obj = device_new(g_variant_get_string(g_variant_get_child_value(parameters, 0), NULL));
+        /* Nothing to show it on, the remote side enters it */
+        _agent_accept(invocation, info, AUDIT_REASON_POLICY, NULL);
+        return;
+    }
 
-        if (_interactive)
-            g_print("Device: %s (%s)\n", device_get_alias(device_obj, &error), device_get_address(device_obj, &error));
+    _agent_reject(invocation, info, AUDIT_REASON_NO_PIN, "Pairing rejected");
+}
 
-        if(error)
-        {
-            g_critical("Failed to get remote device's MAC address: %s", error->message);
-            g_error_free(error);
-        }
+static void _bt_agent_display_pin_code(GDBusMethodInvocation *invocation, const AgentDeviceInfo *info, GError *error)
+{
+    const AgentPolicyCaps *caps = &_policy_caps[_agent_policy(invocation, info)];
+    const gchar *pin = _find_device_pin(info);
+    const gchar *pincode = NULL;
+    g_variant_get_child(g_dbus_method_invocation_get_parameters(invocation), 1, "&s", &pincode);
 
-        g_object_unref(device_obj);
+    _agent_device_info_report(info, error);
 
-        if (_interactive)
+    /* Try to use found PIN */
+    if (pin != NULL)
+    {
+        if (g_strcmp0(pin, "*") == 0 || g_strcmp0(pin, pincode) == 0)
         {
-            g_print("Authorize this device pairing (yes/no)? ");
-            gchar yn[4] = {0,};
-            errno = 0;
-            if (scanf("%3s", yn) == EOF && errno)
-                g_warning("%s\n", strerror(errno));
-            if(g_ascii_strcasecmp(yn, "yes") == 0 || g_ascii_strcasecmp(yn, "y") == 0)
-                g_dbus_method_invocation_return_value(invocation, NULL);
-            else
-                g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "Pairing rejected");
-            return;
+            if (_interactive)
+                g_print("Pin code confirmed\n");
+            _agent_accept(invocation, info, AUDIT_REASON_PIN_FILE, NULL);
         }
+        else
+            _agent_reject(invocation, info, AUDIT_REASON_PIN_MISMATCH, "Passkey does not match");
 
-        g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "Pairing rejected");
+        return;
     }
-    else if (g_strcmp0(method_name, "RequestConfirmation") == 0)
+    else if (_interactive && caps->yes_no)
     {
-        GError *error = NULL;
-        Device *device_obj = device_new(g_variant_get_string(g_variant_get_child_value(parameters, 0), NULL));
-        guint32 passkey = g_variant_get_uint32(g_variant_get_child_value(parameters, 1));
-        const gchar *pin = _find_device_pin(device_get_dbus_object_path(device_obj));
-
-        if (_interactive)
-            g_print("Device: %s (%s)\n", device_get_alias(device_obj, &error), device_get_address(device_obj, &error));
+        g_print("Confirm pin code: %s (yes/no)? ", pincode);
+
+        gchar yn[4] = {0,};
+        errno = 0;
+        if (scanf("%3s", yn) == EOF && errno)
+            g_warning("%s\n", strerror(errno));
+        if(g_ascii_strcasecmp(yn, "yes") == 0 || g_ascii_strcasecmp(yn, "y") == 0)
+            _agent_accept(invocation, info, AUDIT_REASON_USER, NULL);
+        else
+            _agent_reject(invocation, info, AUDIT_REASON_USER, "Passkey does not match");
+        return;
+    }
 
-        if(error)
-        {
-            g_critical("Failed to get remote device's MAC address: %s", error->message);
-            g_error_free(error);
-        }
+    _agent_reject(invocation, info, AUDIT_REASON_NO_PIN, "Pairing rejected");
+}
 
-        g_object_unref(device_obj);
+static void _bt_agent_request_authorization(GDBusMethodInvocation *invocation, const AgentDeviceInfo *info, GError *error)
+{
+    const AgentPolicyCaps *caps = &_policy_caps[_agent_policy(invocation, info)];
 
-        /* Try to use found PIN */
-        if (pin != NULL)
-        {
-            guint32 passkey_t;
-            sscanf(pin, "%u", &passkey_t);
-
-            if (g_strcmp0(pin, "*") == 0 || passkey_t == passkey)
-            {
-                if (_interactive)
-                    g_print("Passkey confirmed\n");
-                g_dbus_method_invocation_return_value(invocation, NULL);
-            }
-            else
-                g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "Passkey does not match");
-
-            return;
-        }
-        else if (_interactive)
-        {
-            g_print("Confirm passkey: %u (yes/no)? ", passkey);
-            gchar yn[4] = {0,};
-            errno = 0;
-            if (scanf("%3s", yn) == EOF && errno)
-                g_warning("%s\n", strerror(errno));
-            if(g_ascii_strcasecmp(yn, "yes") == 0 || g_ascii_strcasecmp(yn, "y") == 0)
-                g_dbus_method_invocation_return_value(invocation, NULL);
-            else
-                g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "Passkey does not match");
-            return;
-        }
+    _agent_device_info_report(info, error);
 
-        g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "Passkey does not match");
+    if (_interactive && caps->yes_no)
+    {
+        g_print("Authorize this device pairing (yes/no)? ");
+        gchar yn[4] = {0,};
+        errno = 0;
+        if (scanf("%3s", yn) == EOF && errno)
+            g_warning("%s\n", strerror(errno));
+        if(g_ascii_strcasecmp(yn, "yes") == 0 || g_ascii_strcasecmp(yn, "y") == 0)
+            _agent_accept(invocation, info, AUDIT_REASON_USER, NULL);
+        else
+            _agent_reject(invocation, info, AUDIT_REASON_USER, "Pairing rejected");
+        return;
     }
-    else if (g_strcmp0(method_name, "RequestPasskey") == 0)
+    else if (!caps->yes_no && !caps->keyboard)
     {
-        GError *error = NULL;
-        Device *device_obj = device_new(g_variant_get_string(g_variant_get_child_value(parameters, 0), NULL));
-        const gchar *pin = _find_device_pin(device_get_dbus_object_path(device_obj));
-        guint32 ret = 0;
-        gboolean invoke = FALSE;
+        /* Just Works: an adapter that can neither confirm nor type accepts */
+        _agent_accept(invocation, info, AUDIT_REASON_POLICY, NULL);
+        return;
+    }
 
-        if (_interactive)
-            g_print("Device: %s (%s)\n", device_get_alias(device_obj, &error), device_get_address(device_obj, &error));
+    _agent_reject(invocation, info, AUDIT_REASON_NON_INTERACTIVE, "Pairing rejected");
+}
 
-        if(error)
-        {
-            g_critical("Failed to get remote device's MAC address: %s", error->message);
-            g_error_free(error);
-        }
+static void _bt_agent_request_confirmation(GDBusMethodInvocation *invocation, const AgentDeviceInfo *info, GError *error)
+{
+    guint32 passkey = 0;
+    const AgentPolicyCaps *caps = &_policy_caps[_agent_policy(invocation, info)];
+    const gchar *pin = _find_device_pin(info);
+    g_variant_get_child(g_dbus_method_invocation_get_parameters(invocation), 1, "u", &passkey);
+
+    _agent_device_info_report(info, error);
 
-        g_object_unref(device_obj);
+    /* Try to use found PIN */
+    if (pin != NULL)
+    {
+        guint32 passkey_t;
+        sscanf(pin, "%u", &passkey_t);
 
-        /* Try to use found PIN */
-        if (pin != NULL)
+        if (g_strcmp0(pin, "*") == 0 || passkey_t == passkey)
         {
             if (_interactive)
-                g_print("Passkey found\n");
-            sscanf(pin, "%u", &ret);
-            invoke = TRUE;
-        }
-        else if (_interactive)
-        {
-            g_print("Enter passkey: ");
-            errno = 0;
-            if (scanf("%u", &ret) == EOF && errno)
-                g_warning("%s\n", strerror(errno));
-            invoke = TRUE;
+                g_print("Passkey confirmed\n");
+            _agent_accept(invocation, info, AUDIT_REASON_PIN_FILE, NULL);
         }
+        else
+            _agent_reject(invocation, info, AUDIT_REASON_PIN_MISMATCH, "Passkey does not match");
 
-        if (invoke)
-        {
-            g_dbus_method_invocation_return_value(invocation, g_variant_new ("(u)", ret));
-        }
+        return;
+    }
+    else if (_interactive && caps->yes_no)
+    {
+        g_print("Confirm passkey: %u (yes/no)? ", passkey);
+        gchar yn[4] = {0,};
+        errno = 0;
+        if (scanf("%3s", yn) == EOF && errno)
+            g_warning("%s\n", strerror(errno));
+        if(g_ascii_strcasecmp(yn, "yes") == 0 || g_ascii_strcasecmp(yn, "y") == 0)
+            _agent_accept(invocation, info, AUDIT_REASON_USER, NULL);
         else
-        {
-            g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "No passkey inputted");
-        }
+            _agent_reject(invocation, info, AUDIT_REASON_USER, "Passkey does not match");
+        return;
     }
-    else if (g_strcmp0(method_name, "RequestPinCode") == 0)
+    else if (!caps->yes_no && !caps->keyboard)
     {
-        GError *error = NULL;
-        Device *device_obj = device_new(g_variant_get_string(g_variant_get_child_value(parameters, 0), NULL));
-        const gchar *pin = _find_device_pin(device_get_dbus_object_path(device_obj));
-        gchar *ret = NULL;
-        gboolean invoke = FALSE;
+        /* Just Works, as in RequestAuthorization */
+        _agent_accept(invocation, info, AUDIT_REASON_POLICY, NULL);
+        return;
+    }
+
+    _agent_reject(invocation, info, AUDIT_REASON_NO_PIN, "Passkey does not match");
+}
+
+static void _bt_agent_request_passkey(GDBusMethodInvocation *invocation, const AgentDeviceInfo *info, GError *error)
+{
+    const AgentPolicyCaps *caps = &_policy_caps[_agent_policy(invocation, info)];
+    const gchar *pin = _find_device_pin(info);
+    guint32 ret = 0;
+    gboolean invoke = FALSE;
 
+    _agent_device_info_report(info, error);
+
+    /* Try to use found PIN */
+    if (pin != NULL)
+    {
         if (_interactive)
-            g_print("Device: %s (%s)\n", device_get_alias(device_obj, &error), device_get_address(device_obj, &error));
+            g_print("Passkey found\n");
+        sscanf(pin, "%u", &ret);
+        invoke = TRUE;
+    }
+    else if (_interactive && caps->keyboard)
+    {
+        g_print("Enter passkey: ");
+        errno = 0;
+        if (scanf("%u", &ret) == EOF && errno)
+            g_warning("%s\n", strerror(errno));
+        invoke = TRUE;
+    }
 
-        if(error)
-        {
-            g_critical("Failed to get remote device's MAC address: %s", error->message);
-            g_error_free(error);
-        }
+    if (invoke)
+    {
+        _agent_accept(invocation, info, pin ? AUDIT_REASON_PIN_FILE : AUDIT_REASON_USER, g_variant_new ("(u)", ret));
+    }
+    else
+    {
+        _agent_reject(invocation, info, AUDIT_REASON_NO_PIN, "No passkey inputted");
+    }
+}
 
-        g_object_unref(device_obj);
+static void _bt_agent_request_pin_code(GDBusMethodInvocation *invocation, const AgentDeviceInfo *info, GError *error)
+{
+    const AgentPolicyCaps *caps = &_policy_caps[_agent_policy(invocation, info)];
+    const gchar *pin = _find_device_pin(info);
+    gchar *ret = NULL;
+    gboolean invoke = FALSE;
 
-        /* Try to use found PIN */
-        if (pin != NULL)
-        {
-            if (_interactive)
-                g_print("Passkey found\n");
-            sscanf(pin, "%ms", &ret);
-            invoke = TRUE;
-        }
-        else if (_interactive)
-        {
-            g_print("Enter passkey: ");
-            errno = 0;
-            if (scanf("%ms", &ret) == EOF && errno)
-                g_warning("%s\n", strerror(errno));
-            invoke = TRUE;
-        }
+    _agent_device_info_report(info, error);
 
-        if (invoke)
-        {
-            g_dbus_method_invocation_return_value(invocation, g_variant_new ("(s)", ret));
-        }
-        else
-        {
-            g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.Error.Rejected", "No passkey inputted");
-        }
+    /* Try to use found PIN */
+    if (pin != NULL)
+    {
+        if (_interactive)
+            g_print("Passkey found\n");
+        sscanf(pin, "%ms", &ret);
+        invoke = TRUE;
+    }
+    else if (_interactive && caps->keyboard)
+    {
+        g_print("Enter passkey: ");
+        errno = 0;
+        if (scanf("%ms", &ret) == EOF && errno)
+            g_warning("%s\n", strerror(errno));
+        invoke = TRUE;
+    }
 
-        if (ret)
-            free(ret);
+    if (invoke)
+    {
+        _agent_accept(invocation, info, pin ? AUDIT_REASON_PIN_FILE : AUDIT_REASON_USER, g_variant_new ("(s)", ret));
+    }
+    else
+    {
+        _agent_reject(invocation, info, AUDIT_REASON_NO_PIN, "No passkey inputted");
+    }
+
+    if (ret)
+        free(ret);
+}
+
+/* Requests about a device are answered asynchronously, each as soon as its own device is resolved */
+static void _bt_agent_method_call_func(GDBusConnection *connection, const gchar *sender, const gchar *object_path, const gchar *interface_name, const gchar *method_name, GVariant *parameters, GDBusMethodInvocation *invocation, gpointer user_data)
+{
+    // g_print("%s%s\n", method_name, g_variant_print(parameters, FALSE));
+
+    switch (agent_method_id(invocation))
+    {
+    case AGENT_METHOD_AUTHORIZE_SERVICE:
+        _agent_with_device_info(invocation, _bt_agent_authorize_service);
+        break;
+
+    case AGENT_METHOD_CANCEL:
+        if (_interactive)
+            g_print("Request canceled\n");
+        // Return void
+        g_dbus_method_invocation_return_value(invocation, NULL);
+        break;
+
+    case AGENT_METHOD_DISPLAY_PASSKEY:
+        _agent_with_device_info(invocation, _bt_agent_display_passkey);
+        break;
+
+    case AGENT_METHOD_DISPLAY_PIN_CODE:
+        _agent_with_device_info(invocation, _bt_agent_display_pin_code);
+        break;
+
+    case AGENT_METHOD_RELEASE:
+        agent_need_unregister = FALSE;
+
+        if(_mainloop)
+            if (g_main_loop_is_running(_mainloop))
+                g_main_loop_quit(_mainloop);
+
+        g_print("Agent released\n");
+
+        // Return void
+        g_dbus_method_invocation_return_value(invocation, NULL);
+        break;
+
+    case AGENT_METHOD_REQUEST_AUTHORIZATION:
+        _agent_with_device_info(invocation, _bt_agent_request_authorization);
+        break;
+
+    case AGENT_METHOD_REQUEST_CONFIRMATION:
+        _agent_with_device_info(invocation, _bt_agent_request_confirmation);
+        break;
+
+    case AGENT_METHOD_REQUEST_PASSKEY:
+        _agent_with_device_info(invocation, _bt_agent_request_passkey);
+        break;
+
+    case AGENT_METHOD_REQUEST_PIN_CODE:
+        _agent_with_device_info(invocation, _bt_agent_request_pin_code);
+        break;
+
+    default:
+        g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD, "Unknown method %s", method_name);
+        break;
     }
 }
 
@@ -364,29 +740,84 @@ static void _bt_agent_g_destroy_notify(gpointer data)
     g_free(data);
 }
 
-static const gchar *_find_device_pin(const gchar *device_path)
+static const gchar *_find_device_pin_exact(const gchar *key)
+{
+    if (key == NULL)
+        return NULL;
+    else if (_pin_db)
+        return pin_db_lookup(_pin_db, key);
+    else if (_pin_hash_table)
+        return g_hash_table_lookup(_pin_hash_table, key);
+    return NULL;
+}
+
+/* Exact MAC, MAC prefix, exact name, name pattern, then the `*` catch-all */
+static const gchar *_find_device_pin(const AgentDeviceInfo *info)
+{
+    const gchar *pin = _find_device_pin_exact(info->address);
+    if (!pin && _pin_rules)
+        pin = pin_rules_lookup_address(_pin_rules, info->address);
+    if (!pin)
+        pin = _find_device_pin_exact(info->alias);
+    if (!pin && _pin_rules)
+        pin = pin_rules_lookup_name(_pin_rules, info->alias);
+    if (!pin)
+        pin = _find_device_pin_exact("*");
+    return pin;
+}
+
+void set_agent_pin_table(GHashTable *pin_dictonary)
+{
+    _pin_hash_table = pin_dictonary;
+}
+
+void set_agent_pin_database(PinDb *pin_db)
+{
+    _pin_db = pin_db;
+}
+
+void set_agent_pin_rules(PinRules *pin_rules)
 {
-    if (_pin_hash_table)
+    _pin_rules = pin_rules;
+}
+
+void set_agent_audit_log(AuditLog *audit_log)
+{
+    _audit_log = audit_log;
+}
+
+void set_agent_rate_limit(guint per_minute, guint max_pending)
+{
+    _rate_per_minute = per_minute;
+    _max_pending = max_pending;
+    if (_rate_buckets)
+        g_hash_table_remove_all(_rate_buckets);
+}
+
+void set_agent_adapter_policy(const gchar *adapter_path, AgentPolicy policy)
+{
+    g_assert(adapter_path != NULL);
+
+    if (!_adapter_policies)
+        _adapter_policies = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    if (policy == AGENT_POLICY_DEFAULT)
+        g_hash_table_remove(_adapter_policies, adapter_path);
+    else
+        g_hash_table_replace(_adapter_policies, g_strdup(adapter_path), GINT_TO_POINTER(policy));
+}
+
+gboolean agent_policy_from_string(const gchar *name, AgentPolicy *policy)
+{
+    for (guint i = 0; i < G_N_ELEMENTS(_policy_caps); i++)
     {
-        GError *error = NULL;
-        Device *device = device_new(device_path);
-        const gchar *pin_by_addr = g_hash_table_lookup(_pin_hash_table, device_get_address(device, &error));
-        const gchar *pin_by_alias = g_hash_table_lookup(_pin_hash_table, device_get_alias(device, &error));
-        if(error)
+        /* The default has no name: it is what adapters without a policy get */
+        if (_policy_caps[i].name && g_strcmp0(name, _policy_caps[i].name) == 0)
         {
-            g_critical("Failed to get remote device's MAC address: %s", error->message);
-            g_error_free(error);
+            *policy = i;
+            return TRUE;
         }
-        g_object_unref(device);
-        const gchar *pin_all = g_hash_table_lookup(_pin_hash_table, "*");
-        if (pin_by_addr)
-            return pin_by_addr;
-        else if (pin_by_alias)
-            return pin_by_alias;
-        else if (pin_all)
-            return pin_all;
     }
-    return NULL;
+    return FALSE;
 }
 
 void register_agent_callbacks(gboolean interactive_console, GHashTable *pin_dictonary, gpointer main_loop_object, GError **error)
@@ -401,15 +832,22 @@ void register_agent_callbacks(gboolean interactive_console, GHashTable *pin_dict
 
     _interactive = interactive_console;
 
-    GDBusNodeInfo *bt_agent_node_info = g_dbus_node_info_new_for_xml(_bt_agent_introspect_xml, error);
-    GDBusInterfaceInfo *bt_agent_interface_info = g_dbus_node_info_lookup_interface(bt_agent_node_info, AGENT_DBUS_INTERFACE);
+    GDBusInterfaceInfo *bt_agent_interface_info = agent_interface_info();
+    g_dbus_interface_info_cache_build(bt_agent_interface_info);
     bt_agent_table.method_call = _bt_agent_method_call_func;
-    _bt_agent_registration_id = g_dbus_connection_register_object(g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, error), AGENT_PATH, bt_agent_interface_info, &bt_agent_table, NULL, _bt_agent_g_destroy_notify, error);
-    g_dbus_node_info_unref(bt_agent_node_info);
+    GDBusConnection *connection = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, error);
+    _bt_agent_registration_id = g_dbus_connection_register_object(connection, AGENT_PATH, bt_agent_interface_info, &bt_agent_table, NULL, _bt_agent_g_destroy_notify, error);
+    if (_bt_agent_registration_id)
+        _agent_device_infos_init();
 }
 
 void unregister_agent_callbacks(GError **error)
 {
     if (_bt_agent_registration_id)
+    {
         g_dbus_connection_unregister_object(g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, error), _bt_agent_registration_id);
+        g_dbus_interface_info_cache_release(agent_interface_info());
+        _bt_agent_registration_id = 0;
+    }
+    _agent_device_infos_free();
 }
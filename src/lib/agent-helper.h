@@ -31,14 +31,45 @@ extern "C" {
 #include <stdio.h>
 
 #include "bluez-api.h"
+#include "pin-db.h"
+#include "pin-rules.h"
+#include "audit-log.h"
 
 #define AGENT_DBUS_INTERFACE "org.bluez.Agent1"
 #define AGENT_PATH "/org/blueztools"
 
+/* Admission control defaults, see set_agent_rate_limit() */
+#define AGENT_DEFAULT_RATE_LIMIT 30   /* requests per device per minute */
+#define AGENT_DEFAULT_MAX_PENDING 64  /* device lookups in flight */
+
+/* How the agent answers for the devices of one adapter, named like the capabilities */
+typedef enum {
+    AGENT_POLICY_DEFAULT,           /* every kind of request, as without a policy */
+    AGENT_POLICY_DISPLAY_ONLY,
+    AGENT_POLICY_DISPLAY_YES_NO,
+    AGENT_POLICY_KEYBOARD_ONLY,
+    AGENT_POLICY_NO_INPUT_NO_OUTPUT,
+    AGENT_POLICY_KEYBOARD_DISPLAY,
+    AGENT_POLICY_REJECT             /* no pairing or authorization at all */
+} AgentPolicy;
+
 extern gboolean agent_need_unregister;
 
 void register_agent_callbacks(gboolean interactive_console, GHashTable *pin_dictonary, gpointer main_loop_object, GError **error);
 void unregister_agent_callbacks(GError **error);
+/* Replace the PIN dictionary given to register_agent_callbacks() */
+void set_agent_pin_table(GHashTable *pin_dictonary);
+/* Answer PIN requests from a compiled database (NULL to go back to the dictionary) */
+void set_agent_pin_database(PinDb *pin_db);
+/* Wildcard PIN rules, consulted when there is no exact match (NULL for none) */
+void set_agent_pin_rules(PinRules *pin_rules);
+/* Record every accept/reject decision (NULL to stop) */
+void set_agent_audit_log(AuditLog *audit_log);
+/* Reject a device's requests beyond `per_minute`, and any request needing a lookup while `max_pending` are in flight (0: no limit) */
+void set_agent_rate_limit(guint per_minute, guint max_pending);
+/* Answer requests for devices of `adapter_path` (the devices' Adapter property) by `policy` */
+void set_agent_adapter_policy(const gchar *adapter_path, AgentPolicy policy);
+gboolean agent_policy_from_string(const gchar *name, AgentPolicy *policy);
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,287 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "audit-log.h"
+
+#define AUDIT_LOG_HEADER_SIZE 64
+#define AUDIT_LOG_RECORD_SIZE 128
+
+typedef struct {
+    gchar magic[8];
+    guint32 version;
+    guint32 record_size;
+    guint32 capacity;
+    guint32 reserved;
+    guint64 next_seq;
+    guint8 padding[32];
+} AuditLogHeader;
+
+G_STATIC_ASSERT(sizeof(AuditLogHeader) == AUDIT_LOG_HEADER_SIZE);
+G_STATIC_ASSERT(sizeof(AuditRecord) == AUDIT_LOG_RECORD_SIZE);
+
+struct _AuditLog {
+    gchar *filename;
+    gpointer map;
+    gsize size;
+    AuditLogHeader *header;
+    AuditRecord *records;
+    guint32 capacity;
+    /* Writer's copy, the header is only ever stored to */
+    guint64 next_seq;
+};
+
+static const gchar *_reason_names[AUDIT_N_REASONS] = {
+    "none",
+    "pin-file",
+    "pin-mismatch",
+    "no-pin",
+    "user",
+    "paired",
+    "not-paired",
+    "non-interactive",
+    "rate-limited",
+    "busy",
+    "lookup-failed",
+    "policy"
+};
+
+static AuditLog *_audit_log_map(const gchar *filename, int fd, gboolean writable, GError **error)
+{
+    struct stat st;
+    AuditLogHeader header;
+
+    if (fstat(fd, &st) < 0)
+    {
+        g_set_error(error, g_quark_from_string("bluez-tools"), 1, "%s: %s", filename, g_strerror(errno));
+        return NULL;
+    }
+    if (st.st_size < AUDIT_LOG_HEADER_SIZE || pread(fd, &header, sizeof(header), 0) != sizeof(header))
+        goto invalid;
+
+    guint32 capacity = GUINT32_FROM_LE(header.capacity);
+    if (memcmp(header.magic, AUDIT_LOG_MAGIC, sizeof(header.magic)) != 0 ||
+        GUINT32_FROM_LE(header.version) != AUDIT_LOG_VERSION ||
+        GUINT32_FROM_LE(header.record_size) != AUDIT_LOG_RECORD_SIZE ||
+        capacity == 0 ||
+        (guint64) st.st_size < AUDIT_LOG_HEADER_SIZE + (guint64) capacity * AUDIT_LOG_RECORD_SIZE)
+        goto invalid;
+
+    gsize size = AUDIT_LOG_HEADER_SIZE + (gsize) capacity * AUDIT_LOG_RECORD_SIZE;
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    /* Fault every page in now rather than on the reply path */
+    if (writable)
+        flags |= MAP_POPULATE;
+#endif
+    gpointer map = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, flags, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        g_set_error(error, g_quark_from_string("bluez-tools"), 1, "%s: %s", filename, g_strerror(errno));
+        return NULL;
+    }
+
+    AuditLog *log = g_new0(AuditLog, 1);
+    log->filename = g_strdup(filename);
+    log->map = map;
+    log->size = size;
+    log->header = map;
+    log->records = (AuditRecord *) ((gchar *) map + AUDIT_LOG_HEADER_SIZE);
+    log->capacity = capacity;
+    log->next_seq = MAX(GUINT64_FROM_LE(log->header->next_seq), 1);
+    return log;
+
+invalid:
+    g_set_error(error, g_quark_from_string("bluez-tools"), 2, "%s: Invalid audit log", filename);
+    return NULL;
+}
+
+AuditLog *audit_log_open(const gchar *filename, guint capacity, GError **error)
+{
+    g_assert(filename != NULL && capacity > 0);
+
+    int fd = g_open(filename, O_RDWR | O_CREAT | O_CLOEXEC, 0640);
+    if (fd < 0)
+    {
+        g_set_error(error, g_quark_from_string("bluez-tools"), 1, "%s: %s", filename, g_strerror(errno));
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size == 0)
+    {
+        /* New log: reserve every block up front so appends never hit ENOSPC through SIGBUS */
+        AuditLogHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, AUDIT_LOG_MAGIC, sizeof(header.magic));
+        header.version = GUINT32_TO_LE(AUDIT_LOG_VERSION);
+        header.record_size = GUINT32_TO_LE(AUDIT_LOG_RECORD_SIZE);
+        header.capacity = GUINT32_TO_LE(capacity);
+        header.next_seq = GUINT64_TO_LE(1);
+
+        int err = posix_fallocate(fd, 0, AUDIT_LOG_HEADER_SIZE + (off_t) capacity * AUDIT_LOG_RECORD_SIZE);
+        if (err != 0 || pwrite(fd, &header, sizeof(header), 0) != sizeof(header))
+        {
+            g_set_error(error, g_quark_from_string("bluez-tools"), 1, "%s: %s", filename, g_strerror(err ? err : errno));
+            /* Leave it empty so the next start tries again */
+            if (ftruncate(fd, 0) < 0)
+                g_warning("%s: %s", filename, g_strerror(errno));
+            close(fd);
+            return NULL;
+        }
+    }
+
+    AuditLog *log = _audit_log_map(filename, fd, TRUE, error);
+    /* The mapping keeps the file referenced */
+    close(fd);
+    return log;
+}
+
+AuditLog *audit_log_open_readonly(const gchar *filename, GError **error)
+{
+    g_assert(filename != NULL);
+
+    int fd = g_open(filename, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        g_set_error(error, g_quark_from_string("bluez-tools"), 1, "%s: %s", filename, g_strerror(errno));
+        return NULL;
+    }
+
+    AuditLog *log = _audit_log_map(filename, fd, FALSE, error);
+    close(fd);
+    return log;
+}
+
+void audit_log_close(AuditLog *log)
+{
+    if (log == NULL)
+        return;
+
+    munmap(log->map, log->size);
+    g_free(log->filename);
+    g_free(log);
+}
+
+void audit_log_append(AuditLog *log, AuditRecord *record)
+{
+    g_assert(log != NULL && record != NULL);
+
+    guint64 seq = log->next_seq++;
+    AuditRecord *slot = &log->records[(seq - 1) % log->capacity];
+    volatile guint64 *slot_seq = &slot->seq;
+
+    record->time = GUINT64_TO_LE(g_get_real_time());
+    record->seq = 0;
+    record->passkey = GUINT32_TO_LE(record->passkey);
+
+    /* Readers see seq 0 while the body changes, then the new sequence */
+    *slot_seq = 0;
+    __sync_synchronize();
+    memcpy(slot, record, sizeof(AuditRecord));
+    __sync_synchronize();
+    *slot_seq = GUINT64_TO_LE(seq);
+    __sync_synchronize();
+    log->header->next_seq = GUINT64_TO_LE(log->next_seq);
+}
+
+guint64 audit_log_next_seq(AuditLog *log)
+{
+    g_assert(log != NULL);
+
+    volatile guint64 *next_seq = &log->header->next_seq;
+    guint64 next = GUINT64_FROM_LE(*next_seq);
+    __sync_synchronize();
+    return MAX(next, 1);
+}
+
+guint64 audit_log_first_seq(AuditLog *log)
+{
+    guint64 next = audit_log_next_seq(log);
+    return next > log->capacity ? next - log->capacity : 1;
+}
+
+gboolean audit_log_read(AuditLog *log, guint64 seq, AuditRecord *record)
+{
+    g_assert(log != NULL && record != NULL);
+
+    if (seq == 0)
+        return FALSE;
+
+    const AuditRecord *slot = &log->records[(seq - 1) % log->capacity];
+    const volatile guint64 *slot_seq = &slot->seq;
+
+    if (GUINT64_FROM_LE(*slot_seq) != seq)
+        return FALSE;
+    __sync_synchronize();
+    memcpy(record, (const void *) slot, sizeof(AuditRecord));
+    __sync_synchronize();
+    /* Overwritten while copying */
+    if (GUINT64_FROM_LE(*slot_seq) != seq)
+        return FALSE;
+
+    record->time = GUINT64_FROM_LE(record->time);
+    record->seq = seq;
+    record->passkey = GUINT32_FROM_LE(record->passkey);
+    record->address[sizeof(record->address) - 1] = '\0';
+    record->alias[sizeof(record->alias) - 1] = '\0';
+    record->detail[sizeof(record->detail) - 1] = '\0';
+    return TRUE;
+}
+
+void audit_address_from_path(const gchar *device_path, gchar address[18])
+{
+    address[0] = '\0';
+
+    const gchar *dev = device_path ? strstr(device_path, "/dev_") : NULL;
+    if (dev == NULL || strlen(dev + 5) < 17)
+        return;
+
+    for (gint i = 0; i < 17; i++)
+        address[i] = dev[5 + i] == '_' ? ':' : dev[5 + i];
+    address[17] = '\0';
+}
+
+const gchar *audit_decision_to_string(AuditDecision decision)
+{
+    return decision == AUDIT_DECISION_ACCEPTED ? "accepted" : "rejected";
+}
+
+const gchar *audit_reason_to_string(AuditReason reason)
+{
+    return reason < AUDIT_N_REASONS ? _reason_names[reason] : "unknown";
+}
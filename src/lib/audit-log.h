@@ -0,0 +1,111 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __AUDIT_LOG_H
+#define __AUDIT_LOG_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+/*
+ * Audit log of the agent's pairing and authorization decisions.
+ *
+ * A file of fixed-size records used as a ring buffer and mapped shared,
+ * so appending is a memcpy into memory the kernel writes back on its own:
+ * no write(), fsync() or allocation on the agent's reply path. Once full,
+ * the oldest records are overwritten. All integers are little-endian.
+ *
+ *   header   "BTAUDIT1", version, record size, capacity, next sequence (64 bytes)
+ *   records  AuditRecord x capacity, sequence N in slot (N - 1) % capacity
+ *
+ * A record is valid when its sequence matches the slot being read; it is
+ * zeroed while being written so readers skip half-written records.
+ */
+#define AUDIT_LOG_MAGIC "BTAUDIT1"
+#define AUDIT_LOG_VERSION 1
+#define AUDIT_LOG_DEFAULT_CAPACITY 65536 /* records, 8 MiB */
+
+typedef enum {
+    AUDIT_DECISION_ACCEPTED,
+    AUDIT_DECISION_REJECTED
+} AuditDecision;
+
+typedef enum {
+    AUDIT_REASON_NONE,
+    AUDIT_REASON_PIN_FILE,       /* PIN's file entry used or matched */
+    AUDIT_REASON_PIN_MISMATCH,   /* PIN's file entry did not match */
+    AUDIT_REASON_NO_PIN,         /* no entry and nobody to ask */
+    AUDIT_REASON_USER,           /* answered at the console */
+    AUDIT_REASON_PAIRED,
+    AUDIT_REASON_NOT_PAIRED,
+    AUDIT_REASON_NON_INTERACTIVE,
+    AUDIT_REASON_RATE_LIMITED,
+    AUDIT_REASON_BUSY,
+    AUDIT_REASON_LOOKUP_FAILED,
+    AUDIT_REASON_POLICY,         /* decided by the adapter's policy */
+    AUDIT_N_REASONS
+} AuditReason;
+
+typedef struct {
+    guint64 time;       /* usec since the epoch */
+    guint64 seq;        /* 1-based, 0 while being written */
+    guint8 method;      /* AgentMethodId */
+    guint8 decision;    /* AuditDecision */
+    guint8 reason;      /* AuditReason */
+    guint8 reserved;
+    guint32 passkey;    /* RequestConfirmation/DisplayPasskey */
+    gchar address[18];
+    gchar alias[48];
+    gchar detail[38];   /* service UUID for AuthorizeService */
+} AuditRecord;
+
+typedef struct _AuditLog AuditLog;
+
+/* Creates filename with room for `capacity` records, or reopens an existing log as it is */
+AuditLog *audit_log_open(const gchar *filename, guint capacity, GError **error);
+AuditLog *audit_log_open_readonly(const gchar *filename, GError **error);
+void audit_log_close(AuditLog *log);
+
+/* Fills in time and sequence; `record` is copied */
+void audit_log_append(AuditLog *log, AuditRecord *record);
+
+/* Sequences [first, next) may be read; older ones have been overwritten */
+guint64 audit_log_first_seq(AuditLog *log);
+guint64 audit_log_next_seq(AuditLog *log);
+/* FALSE if `seq` was overwritten or is being written */
+gboolean audit_log_read(AuditLog *log, guint64 seq, AuditRecord *record);
+
+/* "AA:BB:CC:DD:EE:FF" from a /org/bluez/hciX/dev_AA_BB_CC_DD_EE_FF path, empty if there is none */
+void audit_address_from_path(const gchar *device_path, gchar address[18]);
+
+const gchar *audit_decision_to_string(AuditDecision decision);
+const gchar *audit_reason_to_string(AuditReason reason);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __AUDIT_LOG_H */
@@ -0,0 +1,412 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "dbus-common.h"
+#include "helpers.h"
+#include "commands.h"
+#include "batch.h"
+
+typedef enum {
+    JOB_SYNC,
+    JOB_SET,
+    JOB_REMOVE,
+    JOB_DISCONNECT
+} BatchJobType;
+
+typedef struct {
+    BatchJobType type;
+    GString *out;
+    GString *err;
+    gboolean done;
+    gboolean failed;
+    /* Object the pending call works on, later commands on it wait for the reply */
+    gchar *object_path;
+    gchar *property;
+    GVariant *old_value;
+    GVariant *value;
+} BatchJob;
+
+/* Jobs in input order, printed as soon as everything before them is done */
+static GQueue *jobs = NULL;
+static GHashTable *busy_paths = NULL;
+static guint in_flight = 0;
+static gboolean any_failed = FALSE;
+
+/* Job whose output g_print()/g_printerr() are currently redirected to */
+static BatchJob *capture_job = NULL;
+static GPrintFunc saved_print = NULL;
+static GPrintFunc saved_printerr = NULL;
+
+static void _capture_stdout(const gchar *string)
+{
+    g_string_append(capture_job->out, string);
+}
+
+static void _capture_stderr(const gchar *string)
+{
+    g_string_append(capture_job->err, string);
+}
+
+static void _capture_begin(BatchJob *job)
+{
+    g_assert(capture_job == NULL);
+    capture_job = job;
+    saved_print = g_set_print_handler(_capture_stdout);
+    saved_printerr = g_set_printerr_handler(_capture_stderr);
+}
+
+static void _capture_end()
+{
+    g_set_print_handler(saved_print);
+    g_set_printerr_handler(saved_printerr);
+    capture_job = NULL;
+}
+
+static BatchJob *_job_new(BatchJobType type)
+{
+    BatchJob *job = g_new0(BatchJob, 1);
+    job->type = type;
+    job->out = g_string_new(NULL);
+    job->err = g_string_new(NULL);
+    g_queue_push_tail(jobs, job);
+    return job;
+}
+
+static void _job_free(BatchJob *job)
+{
+    g_string_free(job->out, TRUE);
+    g_string_free(job->err, TRUE);
+    g_free(job->object_path);
+    g_free(job->property);
+    if (job->old_value) g_variant_unref(job->old_value);
+    if (job->value) g_variant_unref(job->value);
+    g_free(job);
+}
+
+static void _job_finish(BatchJob *job, gboolean ok)
+{
+    job->done = TRUE;
+    job->failed = !ok;
+}
+
+static void _flush()
+{
+    BatchJob *job;
+    while ((job = g_queue_peek_head(jobs)) != NULL && job->done)
+    {
+        g_queue_pop_head(jobs);
+        fputs(job->out->str, stdout);
+        fflush(stdout);
+        fputs(job->err->str, stderr);
+        if (job->failed)
+            any_failed = TRUE;
+        _job_free(job);
+    }
+}
+
+static void _wait_until_idle(const gchar *object_path)
+{
+    /* One object at a time: commands on the same object keep their order */
+    while (object_path && g_hash_table_contains(busy_paths, object_path))
+        g_main_context_iteration(NULL, TRUE);
+    while (in_flight >= BATCH_MAX_IN_FLIGHT)
+        g_main_context_iteration(NULL, TRUE);
+}
+
+static void _drain()
+{
+    while (in_flight > 0)
+        g_main_context_iteration(NULL, TRUE);
+}
+
+static void _call_done(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    BatchJob *job = user_data;
+    GError *error = NULL;
+
+    GVariant *ret = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source_object), res, &error);
+
+    _capture_begin(job);
+    if (ret)
+    {
+        if (job->type == JOB_SET)
+            property_change_print(job->property, job->old_value, job->value);
+        else
+            g_print("Done\n");
+        g_variant_unref(ret);
+    }
+    else
+    {
+        print_error(error);
+        g_error_free(error);
+    }
+    _capture_end();
+
+    _job_finish(job, ret != NULL);
+    g_hash_table_remove(busy_paths, job->object_path);
+    in_flight--;
+
+    _flush();
+}
+
+static void _call(BatchJob *job, const gchar *object_path, const gchar *interface_name, const gchar *method_name, GVariant *parameters)
+{
+    g_hash_table_add(busy_paths, g_strdup(job->object_path));
+    in_flight++;
+    g_dbus_connection_call(system_conn, BLUEZ_DBUS_SERVICE_NAME, object_path, interface_name, method_name, parameters, NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), _call_done, job);
+}
+
+static gchar *_resolve_device(Adapter *adapter, const gchar *name)
+{
+    GError *error = NULL;
+    Device *device = find_device(adapter, name, &error);
+    return_val_if_error(error, NULL);
+
+    if (!device)
+    {
+        g_printerr("Error: Device not found.\n");
+        return NULL;
+    }
+
+    gchar *object_path = g_strdup(device_get_dbus_object_path(device));
+    g_object_unref(device);
+    return object_path;
+}
+
+static void _run_set(BatchJob *job, const gchar *object_path, const gchar *interface_name, const gchar *property, GVariant *value)
+{
+    GVariant *props = object_model_get_properties(object_model_get_default(), object_path, interface_name);
+
+    job->type = JOB_SET;
+    job->object_path = g_strdup(object_path);
+    job->property = g_strdup(property);
+    job->value = g_variant_ref_sink(value);
+    job->old_value = props ? g_variant_lookup_value(props, property, NULL) : NULL;
+    if (props) g_variant_unref(props);
+
+    _call(job, object_path, "org.freedesktop.DBus.Properties", "Set", g_variant_new("(ssv)", interface_name, property, value));
+}
+
+static void _run_line(BatchTool tool, Adapter *adapter, const gchar *adapter_name, guint line_no, gint argc, gchar **argv)
+{
+    const gchar *command = argv[0];
+    GError *error = NULL;
+
+    /* Reads see the result of every earlier write */
+    if (g_strcmp0(command, "list") == 0 || g_strcmp0(command, "info") == 0)
+        _drain();
+
+    BatchJob *job = _job_new(JOB_SYNC);
+    gboolean ok = FALSE;
+    gchar *device_path = NULL;
+
+    _capture_begin(job);
+
+    if (g_strcmp0(command, "list") == 0 && argc == 1)
+    {
+        ok = tool == BATCH_ADAPTER ? adapter_command_list() : device_command_list(adapter_name);
+    }
+    else if (g_strcmp0(command, "info") == 0 && tool == BATCH_ADAPTER && argc == 1)
+    {
+        ok = adapter_command_info(adapter_name);
+    }
+    else if (g_strcmp0(command, "info") == 0 && tool == BATCH_DEVICE && argc == 2)
+    {
+        ok = device_command_info(adapter_name, argv[1]);
+    }
+    else if (g_strcmp0(command, "set") == 0 && tool == BATCH_ADAPTER && argc == 3)
+    {
+        GVariant *v = adapter_property_value_parse(argv[1], argv[2], &error);
+        if (v)
+        {
+            _capture_end();
+            _wait_until_idle(adapter_get_dbus_object_path(adapter));
+            _run_set(job, adapter_get_dbus_object_path(adapter), ADAPTER_DBUS_INTERFACE, argv[1], v);
+            goto started;
+        }
+        g_printerr("line %u: %s\n", line_no, error->message);
+        g_error_free(error);
+    }
+    else if (g_strcmp0(command, "set") == 0 && tool == BATCH_DEVICE && argc == 4)
+    {
+        GVariant *v = device_property_value_parse(argv[2], argv[3], &error);
+        if (v == NULL)
+        {
+            g_printerr("line %u: %s\n", line_no, error->message);
+            g_error_free(error);
+        }
+        else if ((device_path = _resolve_device(adapter, argv[1])) != NULL)
+        {
+            _capture_end();
+            _wait_until_idle(device_path);
+            _run_set(job, device_path, DEVICE_DBUS_INTERFACE, argv[2], v);
+            goto started;
+        }
+        else
+        {
+            g_variant_unref(g_variant_ref_sink(v));
+        }
+    }
+    else if (g_strcmp0(command, "remove") == 0 && tool == BATCH_DEVICE && argc == 2)
+    {
+        if ((device_path = _resolve_device(adapter, argv[1])) != NULL)
+        {
+            _capture_end();
+            _wait_until_idle(device_path);
+            job->type = JOB_REMOVE;
+            job->object_path = g_strdup(device_path);
+            _call(job, adapter_get_dbus_object_path(adapter), ADAPTER_DBUS_INTERFACE, "RemoveDevice", g_variant_new("(o)", device_path));
+            goto started;
+        }
+    }
+    else if (g_strcmp0(command, "disconnect") == 0 && tool == BATCH_DEVICE && argc == 2)
+    {
+        if ((device_path = _resolve_device(adapter, argv[1])) != NULL)
+        {
+            g_print("Disconnecting: %s\n", argv[1]);
+            _capture_end();
+            _wait_until_idle(device_path);
+            job->type = JOB_DISCONNECT;
+            job->object_path = g_strdup(device_path);
+            _call(job, device_path, DEVICE_DBUS_INTERFACE, "Disconnect", NULL);
+            goto started;
+        }
+    }
+    else
+    {
+        g_printerr("line %u: Invalid command or arguments: %s\n", line_no, command);
+    }
+
+    _capture_end();
+    _job_finish(job, ok);
+
+started:
+    g_free(device_path);
+    _flush();
+}
+
+gboolean batch_run(BatchTool tool, const gchar *adapter_name, const gchar *filename)
+{
+    g_assert(filename != NULL);
+    GError *error = NULL;
+    ObjectModel *model = NULL;
+    Adapter *adapter = NULL;
+    gboolean ret = FALSE;
+
+    FILE *input = g_strcmp0(filename, "-") == 0 ? stdin : fopen(filename, "r");
+    if (input == NULL)
+    {
+        g_printerr("%s: %s\n", filename, g_strerror(errno));
+        return FALSE;
+    }
+
+    /* One object tree snapshot for the whole batch, kept current by signals */
+    model = object_model_get_default();
+    if (model)
+        g_object_ref(model);
+    else
+    {
+        model = object_model_new(&error);
+        if (error)
+            goto out;
+        object_model_set_default(model);
+    }
+
+    adapter = find_adapter(adapter_name, &error);
+    if (error)
+        goto out;
+    if (!adapter)
+    {
+        g_printerr("Error: Adapter not found.\n");
+        goto out;
+    }
+
+    jobs = g_queue_new();
+    busy_paths = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    any_failed = FALSE;
+
+    gchar *line = NULL;
+    size_t len = 0;
+    guint line_no = 0;
+
+    while (getline(&line, &len, input) != -1)
+    {
+        line_no++;
+        g_strstrip(line);
+        if (line[0] == '\0' || line[0] == '#')
+            continue;
+
+        gint argc = 0;
+        gchar **argv = NULL;
+        if (!g_shell_parse_argv(line, &argc, &argv, &error))
+        {
+            /* Keep the error in sequence with the surrounding output */
+            BatchJob *job = _job_new(JOB_SYNC);
+            g_string_append_printf(job->err, "line %u: %s\n", line_no, error->message);
+            g_clear_error(&error);
+            _job_finish(job, FALSE);
+            _flush();
+            continue;
+        }
+
+        _run_line(tool, adapter, adapter_name, line_no, argc, argv);
+        g_strfreev(argv);
+    }
+
+    _drain();
+    _flush();
+    free(line);
+
+    g_queue_free(jobs);
+    jobs = NULL;
+    g_hash_table_unref(busy_paths);
+    busy_paths = NULL;
+    ret = !any_failed;
+
+out:
+    if (error)
+    {
+        print_error(error);
+        g_error_free(error);
+    }
+    if (input != stdin)
+        fclose(input);
+    if (adapter)
+        g_object_unref(adapter);
+    if (model)
+        g_object_unref(model);
+
+    return ret;
+}
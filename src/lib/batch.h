@@ -0,0 +1,56 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __BATCH_H
+#define __BATCH_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+/* Maximum number of commands waiting for their D-Bus reply at once */
+#define BATCH_MAX_IN_FLIGHT 32
+
+typedef enum {
+    BATCH_ADAPTER,
+    BATCH_DEVICE
+} BatchTool;
+
+/*
+ * Runs newline delimited commands read from filename ("-" for stdin):
+ *   bt-adapter: list | info | set <property> <value>
+ *   bt-device:  list | info <name|mac> | set <name|mac> <property> <value>
+ *               | remove <name|mac> | disconnect <name|mac>
+ * Blank lines and lines starting with '#' are skipped.
+ * Commands on different objects are sent without waiting for each other;
+ * output is printed in input order. Returns FALSE if any command failed.
+ */
+gboolean batch_run(BatchTool tool, const gchar *adapter_name, const gchar *filename);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __BATCH_H */
@@ -11,6 +11,7 @@ extern "C" {
 #define BLUEZ_OBEX_DBUS_BASE_PATH "/org/bluez/obex"
 
 #include "manager.h"
+#include "object-model.h"
 #include "obex_agent.h"
 
 #include "bluez/adapter.h"
@@ -148,7 +148,7 @@ Adapter *adapter_new(const gchar *dbus_object_path)
 static void _adapter_create_gdbus_proxy(Adapter *self, const gchar *dbus_service_name, const gchar *dbus_object_path, GError **error)
 {
 	g_assert(ADAPTER_IS(self));
-	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, ADAPTER_DBUS_INTERFACE, NULL, error);
+	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, ADAPTER_DBUS_INTERFACE, dbus_call_cancellable(), error);
 
 	if(self->priv->proxy == NULL)
 		return;
@@ -171,21 +171,21 @@ const gchar *adapter_get_dbus_object_path(Adapter *self)
 void adapter_remove_device(Adapter *self, const gchar *device, GError **error)
 {
 	g_assert(ADAPTER_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "RemoveDevice", g_variant_new ("(o)", device), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "RemoveDevice", g_variant_new ("(o)", device), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void StartDiscovery() */
 void adapter_start_discovery(Adapter *self, GError **error)
 {
 	g_assert(ADAPTER_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "StartDiscovery", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "StartDiscovery", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void StopDiscovery() */
 void adapter_stop_discovery(Adapter *self, GError **error)
 {
 	g_assert(ADAPTER_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "StopDiscovery", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "StopDiscovery", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* Properties access methods */
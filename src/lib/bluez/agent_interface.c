@@ -0,0 +1,110 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <gio/gio.h>
+
+#include "agent_interface.h"
+
+static const GDBusArgInfo _agent_request_pin_code_in_device = {-1, (gchar *) "device", (gchar *) "o", NULL};
+static const GDBusArgInfo * const _agent_request_pin_code_in_args[] = {&_agent_request_pin_code_in_device, NULL};
+
+static const GDBusArgInfo _agent_request_pin_code_out_pincode = {-1, (gchar *) "pincode", (gchar *) "s", NULL};
+static const GDBusArgInfo * const _agent_request_pin_code_out_args[] = {&_agent_request_pin_code_out_pincode, NULL};
+
+static const GDBusArgInfo _agent_display_pin_code_in_device = {-1, (gchar *) "device", (gchar *) "o", NULL};
+static const GDBusArgInfo _agent_display_pin_code_in_pincode = {-1, (gchar *) "pincode", (gchar *) "s", NULL};
+static const GDBusArgInfo * const _agent_display_pin_code_in_args[] = {&_agent_display_pin_code_in_device, &_agent_display_pin_code_in_pincode, NULL};
+
+static const GDBusArgInfo _agent_request_passkey_in_device = {-1, (gchar *) "device", (gchar *) "o", NULL};
+static const GDBusArgInfo * const _agent_request_passkey_in_args[] = {&_agent_request_passkey_in_device, NULL};
+
+static const GDBusArgInfo _agent_request_passkey_out_passkey = {-1, (gchar *) "passkey", (gchar *) "u", NULL};
+static const GDBusArgInfo * const _agent_request_passkey_out_args[] = {&_agent_request_passkey_out_passkey, NULL};
+
+static const GDBusArgInfo _agent_display_passkey_in_device = {-1, (gchar *) "device", (gchar *) "o", NULL};
+static const GDBusArgInfo _agent_display_passkey_in_passkey = {-1, (gchar *) "passkey", (gchar *) "u", NULL};
+static const GDBusArgInfo _agent_display_passkey_in_entered = {-1, (gchar *) "entered", (gchar *) "q", NULL};
+static const GDBusArgInfo * const _agent_display_passkey_in_args[] = {&_agent_display_passkey_in_device, &_agent_display_passkey_in_passkey, &_agent_display_passkey_in_entered, NULL};
+
+static const GDBusArgInfo _agent_request_confirmation_in_device = {-1, (gchar *) "device", (gchar *) "o", NULL};
+static const GDBusArgInfo _agent_request_confirmation_in_passkey = {-1, (gchar *) "passkey", (gchar *) "u", NULL};
+static const GDBusArgInfo * const _agent_request_confirmation_in_args[] = {&_agent_request_confirmation_in_device, &_agent_request_confirmation_in_passkey, NULL};
+
+static const GDBusArgInfo _agent_request_authorization_in_device = {-1, (gchar *) "device", (gchar *) "o", NULL};
+static const GDBusArgInfo * const _agent_request_authorization_in_args[] = {&_agent_request_authorization_in_device, NULL};
+
+static const GDBusArgInfo _agent_authorize_service_in_device = {-1, (gchar *) "device", (gchar *) "o", NULL};
+static const GDBusArgInfo _agent_authorize_service_in_uuid = {-1, (gchar *) "uuid", (gchar *) "s", NULL};
+static const GDBusArgInfo * const _agent_authorize_service_in_args[] = {&_agent_authorize_service_in_device, &_agent_authorize_service_in_uuid, NULL};
+
+static const GDBusMethodInfo _agent_methods[] = {
+	{-1, (gchar *) "Release", NULL, NULL, NULL},
+	{-1, (gchar *) "RequestPinCode", (GDBusArgInfo **) &_agent_request_pin_code_in_args, (GDBusArgInfo **) &_agent_request_pin_code_out_args, NULL},
+	{-1, (gchar *) "DisplayPinCode", (GDBusArgInfo **) &_agent_display_pin_code_in_args, NULL, NULL},
+	{-1, (gchar *) "RequestPasskey", (GDBusArgInfo **) &_agent_request_passkey_in_args, (GDBusArgInfo **) &_agent_request_passkey_out_args, NULL},
+	{-1, (gchar *) "DisplayPasskey", (GDBusArgInfo **) &_agent_display_passkey_in_args, NULL, NULL},
+	{-1, (gchar *) "RequestConfirmation", (GDBusArgInfo **) &_agent_request_confirmation_in_args, NULL, NULL},
+	{-1, (gchar *) "RequestAuthorization", (GDBusArgInfo **) &_agent_request_authorization_in_args, NULL, NULL},
+	{-1, (gchar *) "AuthorizeService", (GDBusArgInfo **) &_agent_authorize_service_in_args, NULL, NULL},
+	{-1, (gchar *) "Cancel", NULL, NULL, NULL},
+};
+
+static const GDBusMethodInfo * const _agent_method_pointers[] = {
+	&_agent_methods[0],
+	&_agent_methods[1],
+	&_agent_methods[2],
+	&_agent_methods[3],
+	&_agent_methods[4],
+	&_agent_methods[5],
+	&_agent_methods[6],
+	&_agent_methods[7],
+	&_agent_methods[8],
+	NULL
+};
+
+static const GDBusInterfaceInfo _agent_interface_info = {
+	-1,
+	(gchar *) "org.bluez.Agent1",
+	(GDBusMethodInfo **) &_agent_method_pointers,
+	NULL,
+	NULL,
+	NULL
+};
+
+GDBusInterfaceInfo *agent_interface_info(void)
+{
+	return (GDBusInterfaceInfo *) &_agent_interface_info;
+}
+
+AgentMethodId agent_method_id(GDBusMethodInvocation *invocation)
+{
+	const GDBusMethodInfo *info = g_dbus_method_invocation_get_method_info(invocation);
+
+	if (info < _agent_methods || info >= _agent_methods + AGENT_N_METHODS)
+		return AGENT_N_METHODS;
+	return (AgentMethodId) (info - _agent_methods);
+}
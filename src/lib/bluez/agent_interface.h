@@ -0,0 +1,58 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __AGENT_INTERFACE_H
+#define __AGENT_INTERFACE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <gio/gio.h>
+
+/*
+ * Compiled introspection data for org.bluez.Agent1, exported by us.
+ * Method calls are dispatched by agent_method_id(), which maps the
+ * invocation's method info back to its index without comparing names.
+ */
+typedef enum {
+	AGENT_METHOD_RELEASE,
+	AGENT_METHOD_REQUEST_PIN_CODE,
+	AGENT_METHOD_DISPLAY_PIN_CODE,
+	AGENT_METHOD_REQUEST_PASSKEY,
+	AGENT_METHOD_DISPLAY_PASSKEY,
+	AGENT_METHOD_REQUEST_CONFIRMATION,
+	AGENT_METHOD_REQUEST_AUTHORIZATION,
+	AGENT_METHOD_AUTHORIZE_SERVICE,
+	AGENT_METHOD_CANCEL,
+	AGENT_N_METHODS
+} AgentMethodId;
+
+GDBusInterfaceInfo *agent_interface_info(void);
+AgentMethodId agent_method_id(GDBusMethodInvocation *invocation);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __AGENT_INTERFACE_H */
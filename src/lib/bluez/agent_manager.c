@@ -130,7 +130,7 @@ AgentManager *agent_manager_new()
 static void _agent_manager_create_gdbus_proxy(AgentManager *self, const gchar *dbus_service_name, const gchar *dbus_object_path, GError **error)
 {
 	g_assert(AGENT_MANAGER_IS(self));
-	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, AGENT_MANAGER_DBUS_INTERFACE, NULL, error);
+	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, AGENT_MANAGER_DBUS_INTERFACE, dbus_call_cancellable(), error);
 
 	if(self->priv->proxy == NULL)
 		return;
@@ -142,20 +142,20 @@ static void _agent_manager_create_gdbus_proxy(AgentManager *self, const gchar *d
 void agent_manager_register_agent(AgentManager *self, const gchar *agent, const gchar *capability, GError **error)
 {
 	g_assert(AGENT_MANAGER_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "RegisterAgent", g_variant_new ("(os)", agent, capability), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "RegisterAgent", g_variant_new ("(os)", agent, capability), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void RequestDefaultAgent(object agent) */
 void agent_manager_request_default_agent(AgentManager *self, const gchar *agent, GError **error)
 {
 	g_assert(AGENT_MANAGER_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "RequestDefaultAgent", g_variant_new ("(o)", agent), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "RequestDefaultAgent", g_variant_new ("(o)", agent), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void UnregisterAgent(object agent) */
 void agent_manager_unregister_agent(AgentManager *self, const gchar *agent, GError **error)
 {
 	g_assert(AGENT_MANAGER_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "UnregisterAgent", g_variant_new ("(o)", agent), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "UnregisterAgent", g_variant_new ("(o)", agent), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
@@ -130,7 +130,7 @@ Alert *alert_new()
 static void _alert_create_gdbus_proxy(Alert *self, const gchar *dbus_service_name, const gchar *dbus_object_path, GError **error)
 {
 	g_assert(ALERT_IS(self));
-	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, ALERT_DBUS_INTERFACE, NULL, error);
+	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, ALERT_DBUS_INTERFACE, dbus_call_cancellable(), error);
 
 	if(self->priv->proxy == NULL)
 		return;
@@ -142,20 +142,20 @@ static void _alert_create_gdbus_proxy(Alert *self, const gchar *dbus_service_nam
 void alert_new_alert(Alert *self, const gchar *category, const guint16 count, const gchar *description, GError **error)
 {
 	g_assert(ALERT_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "NewAlert", g_variant_new ("(sqs)", category, count, description), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "NewAlert", g_variant_new ("(sqs)", category, count, description), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void RegisterAlert(string category, object agent) */
 void alert_register_alert(Alert *self, const gchar *category, const gchar *agent, GError **error)
 {
 	g_assert(ALERT_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "RegisterAlert", g_variant_new ("(so)", category, agent), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "RegisterAlert", g_variant_new ("(so)", category, agent), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void UnreadAlert(string category, uint16 count) */
 void alert_unread_alert(Alert *self, const gchar *category, const guint16 count, GError **error)
 {
 	g_assert(ALERT_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "UnreadAlert", g_variant_new ("(sq)", category, count), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "UnreadAlert", g_variant_new ("(sq)", category, count), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
@@ -144,7 +144,7 @@ AlertAgent *alert_agent_new(const gchar *dbus_object_path)
 static void _alert_agent_create_gdbus_proxy(AlertAgent *self, const gchar *dbus_service_name, const gchar *dbus_object_path, GError **error)
 {
 	g_assert(ALERT_AGENT_IS(self));
-	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, ALERT_AGENT_DBUS_INTERFACE, NULL, error);
+	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, ALERT_AGENT_DBUS_INTERFACE, dbus_call_cancellable(), error);
 
 	if(self->priv->proxy == NULL)
 		return;
@@ -164,20 +164,20 @@ const gchar *alert_agent_get_dbus_object_path(AlertAgent *self)
 void alert_agent_mute_once(AlertAgent *self, GError **error)
 {
 	g_assert(ALERT_AGENT_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "MuteOnce", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "MuteOnce", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void Release() */
 void alert_agent_release(AlertAgent *self, GError **error)
 {
 	g_assert(ALERT_AGENT_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "Release", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "Release", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void SetRinger(string mode) */
 void alert_agent_set_ringer(AlertAgent *self, const gchar *mode, GError **error)
 {
 	g_assert(ALERT_AGENT_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "SetRinger", g_variant_new ("(s)", mode), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "SetRinger", g_variant_new ("(s)", mode), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
@@ -148,7 +148,7 @@ Device *device_new(const gchar *dbus_object_path)
 static void _device_create_gdbus_proxy(Device *self, const gchar *dbus_service_name, const gchar *dbus_object_path, GError **error)
 {
 	g_assert(DEVICE_IS(self));
-	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, DEVICE_DBUS_INTERFACE, NULL, error);
+	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, DEVICE_DBUS_INTERFACE, dbus_call_cancellable(), error);
 
 	if(self->priv->proxy == NULL)
 		return;
@@ -171,42 +171,42 @@ const gchar *device_get_dbus_object_path(Device *self)
 void device_cancel_pairing(Device *self, GError **error)
 {
 	g_assert(DEVICE_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "CancelPairing", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "CancelPairing", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void Connect() */
 void device_connect(Device *self, GError **error)
 {
 	g_assert(DEVICE_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "Connect", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "Connect", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void ConnectProfile(string uuid) */
 void device_connect_profile(Device *self, const gchar *uuid, GError **error)
 {
 	g_assert(DEVICE_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "ConnectProfile", g_variant_new ("(s)", uuid), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "ConnectProfile", g_variant_new ("(s)", uuid), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void Disconnect() */
 void device_disconnect(Device *self, GError **error)
 {
 	g_assert(DEVICE_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "Disconnect", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "Disconnect", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void DisconnectProfile(string uuid) */
 void device_disconnect_profile(Device *self, const gchar *uuid, GError **error)
 {
 	g_assert(DEVICE_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "DisconnectProfile", g_variant_new ("(s)", uuid), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "DisconnectProfile", g_variant_new ("(s)", uuid), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void Pair() */
 void device_pair(Device *self, GError **error)
 {
 	g_assert(DEVICE_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "Pair", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "Pair", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* asynchronous call to void Pair() */
@@ -217,8 +217,8 @@ void device_pair_async(Device *self, GAsyncReadyCallback callback, gpointer user
                        "Pair",
                        NULL,
                        G_DBUS_CALL_FLAGS_NONE,
-                       -1,
-                       NULL,
+                       dbus_call_timeout(),
+                       dbus_call_cancellable(),
                        callback,
                        user_data);
 }
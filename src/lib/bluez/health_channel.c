@@ -148,7 +148,7 @@ HealthChannel *health_channel_new(const gchar *dbus_object_path)
 static void _health_channel_create_gdbus_proxy(HealthChannel *self, const gchar *dbus_service_name, const gchar *dbus_object_path, GError **error)
 {
 	g_assert(HEALTH_CHANNEL_IS(self));
-	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, HEALTH_CHANNEL_DBUS_INTERFACE, NULL, error);
+	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, HEALTH_CHANNEL_DBUS_INTERFACE, dbus_call_cancellable(), error);
 
 	if(self->priv->proxy == NULL)
 		return;
@@ -172,8 +172,8 @@ guint32 health_channel_acquire(HealthChannel *self, GError **error)
 {
 	g_assert(HEALTH_CHANNEL_IS(self));
 	guint32 ret = 0;
-	GVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, "Acquire", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
-	if (proxy_ret != NULL)
+	GVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, "Acquire", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
+	if (proxy_ret == NULL)
 		return 0;
 	proxy_ret = g_variant_get_child_value(proxy_ret, 0);
 	ret = g_variant_get_uint32(proxy_ret);
@@ -185,7 +185,7 @@ guint32 health_channel_acquire(HealthChannel *self, GError **error)
 void health_channel_release(HealthChannel *self, GError **error)
 {
 	g_assert(HEALTH_CHANNEL_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "Release", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "Release", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* Properties access methods */
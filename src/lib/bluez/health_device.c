@@ -148,7 +148,7 @@ HealthDevice *health_device_new(const gchar *dbus_object_path)
 static void _health_device_create_gdbus_proxy(HealthDevice *self, const gchar *dbus_service_name, const gchar *dbus_object_path, GError **error)
 {
 	g_assert(HEALTH_DEVICE_IS(self));
-	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, HEALTH_DEVICE_DBUS_INTERFACE, NULL, error);
+	self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, HEALTH_DEVICE_DBUS_INTERFACE, dbus_call_cancellable(), error);
 
 	if(self->priv->proxy == NULL)
 		return;
@@ -172,8 +172,8 @@ const gchar *health_device_create_channel(HealthDevice *self, const gchar *appli
 {
 	g_assert(HEALTH_DEVICE_IS(self));
 	const gchar *ret = NULL;
-	GVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, "CreateChannel", g_variant_new ("(os)", application, configuration), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
-	if (proxy_ret != NULL)
+	GVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, "CreateChannel", g_variant_new ("(os)", application, configuration), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
+	if (proxy_ret == NULL)
 		return NULL;
 	proxy_ret = g_variant_get_child_value(proxy_ret, 0);
 	ret = g_variant_get_string(proxy_ret, NULL);
@@ -185,7 +185,7 @@ const gchar *health_device_create_channel(HealthDevice *self, const gchar *appli
 void health_device_destroy_channel(HealthDevice *self, const gchar *channel, GError **error)
 {
 	g_assert(HEALTH_DEVICE_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "DestroyChannel", g_variant_new ("(o)", channel), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "DestroyChannel", g_variant_new ("(o)", channel), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* boolean Echo() */
@@ -193,8 +193,8 @@ gboolean health_device_echo(HealthDevice *self, GError **error)
 {
 	g_assert(HEALTH_DEVICE_IS(self));
 	gboolean ret = FALSE;
-	GVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, "Echo", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
-	if (proxy_ret != NULL)
+	GVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, "Echo", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
+	if (proxy_ret == NULL)
 		return FALSE;
 	proxy_ret = g_variant_get_child_value(proxy_ret, 0);
 	ret = g_variant_get_boolean(proxy_ret);
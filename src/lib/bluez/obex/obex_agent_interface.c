@@ -0,0 +1,72 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <gio/gio.h>
+
+#include "obex_agent_interface.h"
+
+static const GDBusArgInfo _obex_agent_authorize_push_in_transfer = {-1, (gchar *) "transfer", (gchar *) "o", NULL};
+static const GDBusArgInfo * const _obex_agent_authorize_push_in_args[] = {&_obex_agent_authorize_push_in_transfer, NULL};
+
+static const GDBusArgInfo _obex_agent_authorize_push_out_filepath = {-1, (gchar *) "filepath", (gchar *) "s", NULL};
+static const GDBusArgInfo * const _obex_agent_authorize_push_out_args[] = {&_obex_agent_authorize_push_out_filepath, NULL};
+
+static const GDBusMethodInfo _obex_agent_methods[] = {
+	{-1, (gchar *) "Release", NULL, NULL, NULL},
+	{-1, (gchar *) "AuthorizePush", (GDBusArgInfo **) &_obex_agent_authorize_push_in_args, (GDBusArgInfo **) &_obex_agent_authorize_push_out_args, NULL},
+	{-1, (gchar *) "Cancel", NULL, NULL, NULL},
+};
+
+static const GDBusMethodInfo * const _obex_agent_method_pointers[] = {
+	&_obex_agent_methods[0],
+	&_obex_agent_methods[1],
+	&_obex_agent_methods[2],
+	NULL
+};
+
+static const GDBusInterfaceInfo _obex_agent_interface_info = {
+	-1,
+	(gchar *) "org.bluez.obex.Agent1",
+	(GDBusMethodInfo **) &_obex_agent_method_pointers,
+	NULL,
+	NULL,
+	NULL
+};
+
+GDBusInterfaceInfo *obex_agent_interface_info(void)
+{
+	return (GDBusInterfaceInfo *) &_obex_agent_interface_info;
+}
+
+ObexAgentMethodId obex_agent_method_id(GDBusMethodInvocation *invocation)
+{
+	const GDBusMethodInfo *info = g_dbus_method_invocation_get_method_info(invocation);
+
+	if (info < _obex_agent_methods || info >= _obex_agent_methods + OBEX_AGENT_N_METHODS)
+		return OBEX_AGENT_N_METHODS;
+	return (ObexAgentMethodId) (info - _obex_agent_methods);
+}
@@ -0,0 +1,52 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __OBEX_AGENT_INTERFACE_H
+#define __OBEX_AGENT_INTERFACE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <gio/gio.h>
+
+/*
+ * Compiled introspection data for org.bluez.obex.Agent1, exported by us.
+ * Method calls are dispatched by obex_agent_method_id(), which maps the
+ * invocation's method info back to its index without comparing names.
+ */
+typedef enum {
+	OBEX_AGENT_METHOD_RELEASE,
+	OBEX_AGENT_METHOD_AUTHORIZE_PUSH,
+	OBEX_AGENT_METHOD_CANCEL,
+	OBEX_AGENT_N_METHODS
+} ObexAgentMethodId;
+
+GDBusInterfaceInfo *obex_agent_interface_info(void);
+ObexAgentMethodId obex_agent_method_id(GDBusMethodInvocation *invocation);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __OBEX_AGENT_INTERFACE_H */
@@ -144,7 +144,7 @@ ObexFileTransfer *obex_file_transfer_new(const gchar *dbus_object_path)
 static void _obex_file_transfer_create_gdbus_proxy(ObexFileTransfer *self, const gchar *dbus_service_name, const gchar *dbus_object_path, GError **error)
 {
 	g_assert(OBEX_FILE_TRANSFER_IS(self));
-	self->priv->proxy = g_dbus_proxy_new_sync(session_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, OBEX_FILE_TRANSFER_DBUS_INTERFACE, NULL, error);
+	self->priv->proxy = g_dbus_proxy_new_sync(session_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, OBEX_FILE_TRANSFER_DBUS_INTERFACE, dbus_call_cancellable(), error);
 
 	if(self->priv->proxy == NULL)
 		return;
@@ -164,28 +164,28 @@ const gchar *obex_file_transfer_get_dbus_object_path(ObexFileTransfer *self)
 void obex_file_transfer_change_folder(ObexFileTransfer *self, const gchar *folder, GError **error)
 {
 	g_assert(OBEX_FILE_TRANSFER_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "ChangeFolder", g_variant_new ("(s)", folder), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "ChangeFolder", g_variant_new ("(s)", folder), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void CopyFile(string sourcefile, string targetfile) */
 void obex_file_transfer_copy_file(ObexFileTransfer *self, const gchar *sourcefile, const gchar *targetfile, GError **error)
 {
 	g_assert(OBEX_FILE_TRANSFER_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "CopyFile", g_variant_new ("(ss)", sourcefile, targetfile), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "CopyFile", g_variant_new ("(ss)", sourcefile, targetfile), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void CreateFolder(string folder) */
 void obex_file_transfer_create_folder(ObexFileTransfer *self, const gchar *folder, GError **error)
 {
 	g_assert(OBEX_FILE_TRANSFER_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "CreateFolder", g_variant_new ("(s)", folder), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "CreateFolder", g_variant_new ("(s)", folder), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* void Delete(string file) */
 void obex_file_transfer_delete(ObexFileTransfer *self, const gchar *file, GError **error)
 {
 	g_assert(OBEX_FILE_TRANSFER_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "Delete", g_variant_new ("(s)", file), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "Delete", g_variant_new ("(s)", file), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* object, dict GetFile(string targetfile, string sourcefile) */
@@ -193,8 +193,8 @@ GVariant *obex_file_transfer_get_file(ObexFileTransfer *self, const gchar *targe
 {
 	g_assert(OBEX_FILE_TRANSFER_IS(self));
 	GVariant *ret = NULL;
-	GVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, "GetFile", g_variant_new ("(ss)", targetfile, sourcefile), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
-	if (proxy_ret != NULL)
+	GVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, "GetFile", g_variant_new ("(ss)", targetfile, sourcefile), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
+	if (proxy_ret == NULL)
 		return NULL;
 	ret = g_variant_ref_sink(proxy_ret);
 	g_variant_unref(proxy_ret);
@@ -206,8 +206,8 @@ GVariant *obex_file_transfer_list_folder(ObexFileTransfer *self, GError **error)
 {
 	g_assert(OBEX_FILE_TRANSFER_IS(self));
 	GVariant *ret = NULL;
-	GVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, "ListFolder", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
-	if (proxy_ret != NULL)
+	GVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, "ListFolder", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
+	if (proxy_ret == NULL)
 		return NULL;
 	proxy_ret = g_variant_get_child_value(proxy_ret, 0);
 	ret = g_variant_ref_sink(proxy_ret);
@@ -219,7 +219,7 @@ GVariant *obex_file_transfer_list_folder(ObexFileTransfer *self, GError **error)
 void obex_file_transfer_move_file(ObexFileTransfer *self, const gchar *sourcefile, const gchar *targetfile, GError **error)
 {
 	g_assert(OBEX_FILE_TRANSFER_IS(self));
-	g_dbus_proxy_call_sync(self->priv->proxy, "MoveFile", g_variant_new ("(ss)", sourcefile, targetfile), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+	g_dbus_proxy_call_sync(self->priv->proxy, "MoveFile", g_variant_new ("(ss)", sourcefile, targetfile), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 /* object, dict PutFile(string sourcefile, string targetfile) */
@@ -227,8 +227,8 @@ GVariant *obex_file_transfer_put_file(ObexFileTransfer *self, const gchar *sourc
 {
 	g_assert(OBEX_FILE_TRANSFER_IS(self));
 	GVariant *ret = NULL;
-	GVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, "PutFile", g_variant_new ("(ss)", targetfile, sourcefile), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
-	if (proxy_ret != NULL)
+	GVariant *proxy_ret = g_dbus_proxy_call_sync(self->priv->proxy, "PutFile", g_variant_new ("(ss)", sourcefile, targetfile), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
+	if (proxy_ret == NULL)
 		return NULL;
 	ret = g_variant_ref_sink(proxy_ret);
 	g_variant_unref(proxy_ret);
@@ -0,0 +1,326 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+
+#include "helpers.h"
+#include "command-socket.h"
+
+gchar *command_socket_default_path()
+{
+    return g_build_filename(g_get_user_runtime_dir(), COMMAND_SOCKET_NAME, NULL);
+}
+
+gboolean command_socket_write_message(GOutputStream *stream, GVariant *message, GError **error)
+{
+    g_assert(stream != NULL && message != NULL);
+
+    g_variant_ref_sink(message);
+    gsize size = g_variant_get_size(message);
+    guint32 header = GUINT32_TO_BE((guint32) size);
+
+    gboolean ret = g_output_stream_write_all(stream, &header, sizeof(header), NULL, NULL, error) &&
+            g_output_stream_write_all(stream, g_variant_get_data(message), size, NULL, NULL, error) &&
+            g_output_stream_flush(stream, NULL, error);
+
+    g_variant_unref(message);
+    return ret;
+}
+
+GVariant *command_socket_read_message(GInputStream *stream, const GVariantType *type, GError **error)
+{
+    g_assert(stream != NULL && type != NULL);
+
+    guint32 header = 0;
+    gsize bytes_read = 0;
+
+    if (!g_input_stream_read_all(stream, &header, sizeof(header), &bytes_read, NULL, error))
+        return NULL;
+    if (bytes_read != sizeof(header))
+    {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_CLOSED, "Connection closed");
+        return NULL;
+    }
+
+    gsize size = GUINT32_FROM_BE(header);
+    if (size > COMMAND_SOCKET_MAX_MESSAGE)
+    {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE, "Message too large: %" G_GSIZE_FORMAT " bytes", size);
+        return NULL;
+    }
+
+    gchar *data = g_malloc(size);
+    if (!g_input_stream_read_all(stream, data, size, &bytes_read, NULL, error))
+    {
+        g_free(data);
+        return NULL;
+    }
+    if (bytes_read != size)
+    {
+        g_free(data);
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_CLOSED, "Connection closed");
+        return NULL;
+    }
+
+    /* Data comes from another process: let GVariant validate it */
+    GVariant *message = g_variant_new_from_data(type, data, size, FALSE, g_free, data);
+    return g_variant_ref_sink(message);
+}
+
+/* A message on its way in or out; GTask data of the async calls */
+typedef struct {
+    const GVariantType *type;
+    guint32 header;
+    gboolean in_body;   /* reading: the header is in */
+    gchar *data;        /* body read so far, or header and body to write */
+    gsize size;         /* of `data` */
+    gsize done;         /* bytes of the current part so far */
+} CommandSocketIO;
+
+static void _io_free(CommandSocketIO *io)
+{
+    g_free(io->data);
+    g_free(io);
+}
+
+static void _write_part(GTask *task);
+
+static void _write_done(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    GTask *task = user_data;
+    CommandSocketIO *io = g_task_get_task_data(task);
+    GError *error = NULL;
+
+    gssize written = g_output_stream_write_finish(G_OUTPUT_STREAM(source_object), res, &error);
+    if (written < 0)
+    {
+        g_task_return_error(task, error);
+        g_object_unref(task);
+        return;
+    }
+
+    io->done += written;
+    _write_part(task);
+}
+
+static void _write_part(GTask *task)
+{
+    CommandSocketIO *io = g_task_get_task_data(task);
+
+    if (io->done < io->size)
+    {
+        g_output_stream_write_async(g_task_get_source_object(task), io->data + io->done, io->size - io->done, G_PRIORITY_DEFAULT, g_task_get_cancellable(task), _write_done, task);
+        return;
+    }
+
+    g_task_return_boolean(task, TRUE);
+    g_object_unref(task);
+}
+
+void command_socket_write_message_async(GOutputStream *stream, GVariant *message, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+    g_assert(stream != NULL && message != NULL);
+
+    GTask *task = g_task_new(stream, cancellable, callback, user_data);
+    CommandSocketIO *io = g_new0(CommandSocketIO, 1);
+
+    g_variant_ref_sink(message);
+    gsize size = g_variant_get_size(message);
+    guint32 header = GUINT32_TO_BE((guint32) size);
+
+    /* One buffer, so a short write never splits header and body handling */
+    io->size = sizeof(header) + size;
+    io->data = g_malloc(io->size);
+    memcpy(io->data, &header, sizeof(header));
+    g_variant_store(message, io->data + sizeof(header));
+    g_variant_unref(message);
+
+    g_task_set_task_data(task, io, (GDestroyNotify) _io_free);
+    _write_part(task);
+}
+
+gboolean command_socket_write_message_finish(GOutputStream *stream, GAsyncResult *result, GError **error)
+{
+    g_assert(g_task_is_valid(result, stream));
+    return g_task_propagate_boolean(G_TASK(result), error);
+}
+
+static void _read_part(GTask *task);
+
+static void _read_done(GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+    GTask *task = user_data;
+    CommandSocketIO *io = g_task_get_task_data(task);
+    GError *error = NULL;
+
+    gssize bytes_read = g_input_stream_read_finish(G_INPUT_STREAM(source_object), res, &error);
+    if (bytes_read < 0)
+    {
+        g_task_return_error(task, error);
+        g_object_unref(task);
+        return;
+    }
+    if (bytes_read == 0)
+    {
+        g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_CLOSED, "Connection closed");
+        g_object_unref(task);
+        return;
+    }
+
+    io->done += bytes_read;
+    _read_part(task);
+}
+
+static void _read_part(GTask *task)
+{
+    CommandSocketIO *io = g_task_get_task_data(task);
+    GInputStream *stream = g_task_get_source_object(task);
+
+    if (!io->in_body)
+    {
+        if (io->done < sizeof(io->header))
+        {
+            g_input_stream_read_async(stream, (gchar *) &io->header + io->done, sizeof(io->header) - io->done, G_PRIORITY_DEFAULT, g_task_get_cancellable(task), _read_done, task);
+            return;
+        }
+
+        io->size = GUINT32_FROM_BE(io->header);
+        if (io->size > COMMAND_SOCKET_MAX_MESSAGE)
+        {
+            g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE, "Message too large: %" G_GSIZE_FORMAT " bytes", io->size);
+            g_object_unref(task);
+            return;
+        }
+        io->in_body = TRUE;
+        io->data = g_malloc(io->size);
+        io->done = 0;
+    }
+
+    if (io->done < io->size)
+    {
+        g_input_stream_read_async(stream, io->data + io->done, io->size - io->done, G_PRIORITY_DEFAULT, g_task_get_cancellable(task), _read_done, task);
+        return;
+    }
+
+    /* Data comes from another process: let GVariant validate it */
+    gchar *data = io->data;
+    io->data = NULL;
+    GVariant *message = g_variant_new_from_data(io->type, data, io->size, FALSE, g_free, data);
+    g_task_return_pointer(task, g_variant_ref_sink(message), (GDestroyNotify) g_variant_unref);
+    g_object_unref(task);
+}
+
+void command_socket_read_message_async(GInputStream *stream, const GVariantType *type, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+    g_assert(stream != NULL && type != NULL);
+
+    GTask *task = g_task_new(stream, cancellable, callback, user_data);
+    CommandSocketIO *io = g_new0(CommandSocketIO, 1);
+    io->type = type;
+    g_task_set_task_data(task, io, (GDestroyNotify) _io_free);
+    _read_part(task);
+}
+
+GVariant *command_socket_read_message_finish(GInputStream *stream, GAsyncResult *result, GError **error)
+{
+    g_assert(g_task_is_valid(result, stream));
+    return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+gboolean command_socket_forward(const gchar *tool, int argc, char *argv[], int *status)
+{
+    g_assert(tool != NULL && status != NULL);
+
+    const gchar *socket_env = g_getenv(COMMAND_SOCKET_ENV);
+    if (socket_env == NULL)
+        return FALSE;
+
+    gchar *socket_path = strlen(socket_env) > 0 ? g_strdup(socket_env) : command_socket_default_path();
+    GSocketAddress *address = g_unix_socket_address_new(socket_path);
+    GSocketClient *client = g_socket_client_new();
+    GError *error = NULL;
+
+    g_free(socket_path);
+
+    GSocketConnection *connection = g_socket_client_connect(client, G_SOCKET_CONNECTABLE(address), NULL, &error);
+    g_object_unref(address);
+    g_object_unref(client);
+    if (connection == NULL)
+    {
+        /* No daemon: quietly run the command ourselves */
+        g_error_free(error);
+        return FALSE;
+    }
+
+    GVariantBuilder args;
+    g_variant_builder_init(&args, G_VARIANT_TYPE_STRING_ARRAY);
+    for (int i = 0; i < argc; i++)
+        g_variant_builder_add(&args, "s", argv[i]);
+
+    GVariant *request = g_variant_new("(sas)", tool, &args);
+    if (!command_socket_write_message(g_io_stream_get_output_stream(G_IO_STREAM(connection)), request, &error))
+    {
+        g_error_free(error);
+        g_object_unref(connection);
+        return FALSE;
+    }
+
+    /* From here on the daemon may have run the command: never run it twice */
+    GVariant *reply = command_socket_read_message(g_io_stream_get_input_stream(G_IO_STREAM(connection)), COMMAND_SOCKET_REPLY_TYPE, &error);
+    g_object_unref(connection);
+    if (reply == NULL)
+    {
+        print_error(error);
+        g_error_free(error);
+        *status = EXIT_FAILURE;
+        return TRUE;
+    }
+
+    gint32 reply_status = 0;
+    const gchar *out_text = NULL;
+    const gchar *err_text = NULL;
+    g_variant_get(reply, "(i&s&s)", &reply_status, &out_text, &err_text);
+
+    if (reply_status == COMMAND_SOCKET_FALLBACK)
+    {
+        g_variant_unref(reply);
+        return FALSE;
+    }
+
+    fputs(out_text, stdout);
+    fputs(err_text, stderr);
+    fflush(stdout);
+    *status = reply_status;
+
+    g_variant_unref(reply);
+    return TRUE;
+}
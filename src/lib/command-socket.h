@@ -0,0 +1,71 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __COMMAND_SOCKET_H
+#define __COMMAND_SOCKET_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <gio/gio.h>
+
+/* Tools forward their argv to bt-daemon only when this is set */
+#define COMMAND_SOCKET_ENV "BLUEZ_TOOLS_SOCKET"
+#define COMMAND_SOCKET_NAME "bluez-tools.socket"
+
+/* Reply status asking the client to run the command itself */
+#define COMMAND_SOCKET_FALLBACK -1
+
+#define COMMAND_SOCKET_MAX_MESSAGE (1024 * 1024)
+
+/*
+ * Messages are a 4 byte big endian length followed by a serialized GVariant:
+ *   request (sas): tool name, argv
+ *   reply   (iss): exit status, stdout text, stderr text
+ */
+#define COMMAND_SOCKET_REQUEST_TYPE G_VARIANT_TYPE("(sas)")
+#define COMMAND_SOCKET_REPLY_TYPE G_VARIANT_TYPE("(iss)")
+
+gchar *command_socket_default_path();
+gboolean command_socket_write_message(GOutputStream *stream, GVariant *message, GError **error);
+GVariant *command_socket_read_message(GInputStream *stream, const GVariantType *type, GError **error);
+
+/* The same without blocking, for a server: a stalled peer only holds up its own connection */
+void command_socket_write_message_async(GOutputStream *stream, GVariant *message, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+gboolean command_socket_write_message_finish(GOutputStream *stream, GAsyncResult *result, GError **error);
+void command_socket_read_message_async(GInputStream *stream, const GVariantType *type, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+GVariant *command_socket_read_message_finish(GInputStream *stream, GAsyncResult *result, GError **error);
+
+/*
+ * Client side: hand argv over to a running bt-daemon.
+ * Returns FALSE when the command must be run locally, otherwise the
+ * daemon's output has been printed and *status holds the exit status.
+ */
+gboolean command_socket_forward(const gchar *tool, int argc, char *argv[], int *status);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __COMMAND_SOCKET_H */
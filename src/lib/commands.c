@@ -0,0 +1,450 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "dbus-common.h"
+#include "helpers.h"
+#include "commands.h"
+
+/* Property dictionary accessors, tolerant to missing properties */
+static const gchar *_props_get_string(GVariant *props, const gchar *name)
+{
+    const gchar *value = NULL;
+    g_variant_lookup(props, name, "&s", &value);
+    return value;
+}
+
+static guint32 _props_get_uint32(GVariant *props, const gchar *name)
+{
+    guint32 value = 0;
+    g_variant_lookup(props, name, "u", &value);
+    return value;
+}
+
+static gboolean _props_get_boolean(GVariant *props, const gchar *name)
+{
+    gboolean value = FALSE;
+    g_variant_lookup(props, name, "b", &value);
+    return value;
+}
+
+static void _props_print_uuids(GVariant *props)
+{
+    GVariantIter *uuids = NULL;
+    const gchar *uuid;
+    int j = 0;
+
+    g_print("  UUIDs: [");
+    if (g_variant_lookup(props, "UUIDs", "as", &uuids))
+    {
+        while (g_variant_iter_next(uuids, "&s", &uuid))
+        {
+            if (j++ > 0) g_print(", ");
+            g_print("%s", uuid2name(uuid));
+        }
+        g_variant_iter_free(uuids);
+    }
+    g_print("]\n");
+}
+
+/* One GetAll round trip, or none at all when the live object model is installed */
+static GVariant *_adapter_properties(Adapter *adapter, GError **error)
+{
+    ObjectModel *model = object_model_get_default();
+    if (model)
+    {
+        GVariant *props = object_model_get_properties(model, adapter_get_dbus_object_path(adapter), ADAPTER_DBUS_INTERFACE);
+        if (props)
+            return props;
+    }
+    return adapter_get_properties(adapter, error);
+}
+
+static GVariant *_device_properties(Device *device, GError **error)
+{
+    ObjectModel *model = object_model_get_default();
+    if (model)
+    {
+        GVariant *props = object_model_get_properties(model, device_get_dbus_object_path(device), DEVICE_DBUS_INTERFACE);
+        if (props)
+            return props;
+    }
+    return device_get_properties(device, error);
+}
+
+static GVariant *_parse_boolean(const gchar *value, GError **error)
+{
+    if (g_strcmp0(value, "0") == 0 || g_ascii_strcasecmp(value, "FALSE") == 0 || g_ascii_strcasecmp(value, "OFF") == 0)
+        return g_variant_new_boolean(FALSE);
+    if (g_strcmp0(value, "1") == 0 || g_ascii_strcasecmp(value, "TRUE") == 0 || g_ascii_strcasecmp(value, "ON") == 0)
+        return g_variant_new_boolean(TRUE);
+
+    g_set_error(error, g_quark_from_string("bluez-tools"), 1, "Invalid boolean value: %s", value);
+    return NULL;
+}
+
+GVariant *adapter_property_value_parse(const gchar *property, const gchar *value, GError **error)
+{
+    if (g_strcmp0(property, "Alias") == 0)
+        return g_variant_new_string(value);
+    else if (g_strcmp0(property, "Discoverable") == 0 || g_strcmp0(property, "Pairable") == 0 || g_strcmp0(property, "Powered") == 0)
+        return _parse_boolean(value, error);
+    else if (g_strcmp0(property, "DiscoverableTimeout") == 0 || g_strcmp0(property, "PairableTimeout") == 0)
+        return g_variant_new_uint32((guint32) atoi(value));
+
+    g_set_error(error, g_quark_from_string("bluez-tools"), 1, "Invalid property: %s", property);
+    return NULL;
+}
+
+GVariant *device_property_value_parse(const gchar *property, const gchar *value, GError **error)
+{
+    if (g_strcmp0(property, "Alias") == 0)
+        return g_variant_new_string(value);
+    else if (g_strcmp0(property, "Trusted") == 0 || g_strcmp0(property, "Blocked") == 0)
+        return _parse_boolean(value, error);
+
+    g_set_error(error, g_quark_from_string("bluez-tools"), 1, "Invalid property: %s", property);
+    return NULL;
+}
+
+void property_change_print(const gchar *property, GVariant *old_value, GVariant *v)
+{
+    if (old_value == NULL)
+        return;
+
+    if (g_variant_is_of_type(old_value, G_VARIANT_TYPE_STRING))
+        g_print("%s: %s -> %s\n", property, g_variant_get_string(old_value, NULL), g_variant_get_string(v, NULL));
+    else if (g_variant_is_of_type(old_value, G_VARIANT_TYPE_BOOLEAN))
+        g_print("%s: %u -> %u\n", property, g_variant_get_boolean(old_value), g_variant_get_boolean(v));
+    else if (g_variant_is_of_type(old_value, G_VARIANT_TYPE_UINT32))
+        g_print("%s: %u -> %u\n", property, g_variant_get_uint32(old_value), g_variant_get_uint32(v));
+}
+
+static Adapter *_find_adapter(const gchar *adapter_name)
+{
+    GError *error = NULL;
+    Adapter *adapter = find_adapter(adapter_name, &error);
+    return_val_if_error(error, NULL);
+
+    if (!adapter)
+        g_printerr("Error: Adapter not found.\n");
+
+    return adapter;
+}
+
+static Device *_find_device(Adapter *adapter, const gchar *device_name)
+{
+    GError *error = NULL;
+    Device *device = find_device(adapter, device_name, &error);
+    return_val_if_error(error, NULL);
+
+    if (!device)
+        g_printerr("Error: Device not found.\n");
+
+    return device;
+}
+
+gboolean adapter_command_list(void)
+{
+    GError *error = NULL;
+    Manager *manager = manager_new();
+    GVariant *objects = manager_get_managed_objects(manager, &error);
+    g_object_unref(manager);
+    return_val_if_error(error, FALSE);
+
+    const gchar *object_path;
+    GVariant *ifaces_and_properties;
+    GVariantIter i;
+    guint n = 0;
+
+    g_variant_iter_init(&i, objects);
+    while (g_variant_iter_next(&i, "{&o@a{sa{sv}}}", &object_path, &ifaces_and_properties))
+    {
+        GVariant *props = NULL;
+        if (g_variant_lookup(ifaces_and_properties, ADAPTER_DBUS_INTERFACE, "@a{sv}", &props))
+        {
+            if (n++ == 0)
+                g_print("Available adapters:\n");
+            g_print("%s (%s)\n", _props_get_string(props, "Name"), _props_get_string(props, "Address"));
+            g_variant_unref(props);
+        }
+        g_variant_unref(ifaces_and_properties);
+    }
+    g_variant_unref(objects);
+
+    if (n == 0)
+    {
+        g_print("No adapters found\n");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+gboolean adapter_command_info(const gchar *adapter_name)
+{
+    GError *error = NULL;
+    Adapter *adapter = _find_adapter(adapter_name);
+    if (!adapter)
+        return FALSE;
+
+    GVariant *props = _adapter_properties(adapter, &error);
+    if (error)
+    {
+        g_object_unref(adapter);
+        return_val_if_error(error, FALSE);
+    }
+
+    gchar *adapter_intf = g_path_get_basename(adapter_get_dbus_object_path(adapter));
+    g_print("[%s]\n", adapter_intf);
+    g_print("  Name: %s\n", _props_get_string(props, "Name"));
+    g_print("  Address: %s\n", _props_get_string(props, "Address"));
+    g_print("  Alias: %s [rw]\n", _props_get_string(props, "Alias"));
+    g_print("  Class: 0x%x\n", _props_get_uint32(props, "Class"));
+    g_print("  Discoverable: %d [rw]\n", _props_get_boolean(props, "Discoverable"));
+    g_print("  DiscoverableTimeout: %d [rw]\n", _props_get_uint32(props, "DiscoverableTimeout"));
+    g_print("  Discovering: %d\n", _props_get_boolean(props, "Discovering"));
+    g_print("  Pairable: %d [rw]\n", _props_get_boolean(props, "Pairable"));
+    g_print("  PairableTimeout: %d [rw]\n", _props_get_uint32(props, "PairableTimeout"));
+    g_print("  Powered: %d [rw]\n", _props_get_boolean(props, "Powered"));
+    _props_print_uuids(props);
+
+    g_free(adapter_intf);
+    g_variant_unref(props);
+    g_object_unref(adapter);
+
+    return TRUE;
+}
+
+gboolean adapter_command_set(const gchar *adapter_name, const gchar *property, GVariant *v)
+{
+    GError *error = NULL;
+    Adapter *adapter = _find_adapter(adapter_name);
+    if (!adapter)
+        return FALSE;
+
+    GVariant *props = _adapter_properties(adapter, &error);
+    if (!error)
+    {
+        if (g_strcmp0(property, "Alias") == 0)
+            adapter_set_alias(adapter, g_variant_get_string(v, NULL), &error);
+        else if (g_strcmp0(property, "Discoverable") == 0)
+            adapter_set_discoverable(adapter, g_variant_get_boolean(v), &error);
+        else if (g_strcmp0(property, "DiscoverableTimeout") == 0)
+            adapter_set_discoverable_timeout(adapter, g_variant_get_uint32(v), &error);
+        else if (g_strcmp0(property, "Pairable") == 0)
+            adapter_set_pairable(adapter, g_variant_get_boolean(v), &error);
+        else if (g_strcmp0(property, "PairableTimeout") == 0)
+            adapter_set_pairable_timeout(adapter, g_variant_get_uint32(v), &error);
+        else if (g_strcmp0(property, "Powered") == 0)
+            adapter_set_powered(adapter, g_variant_get_boolean(v), &error);
+    }
+    g_object_unref(adapter);
+
+    if (error)
+    {
+        if (props) g_variant_unref(props);
+        return_val_if_error(error, FALSE);
+    }
+
+    GVariant *old_value = g_variant_lookup_value(props, property, NULL);
+    property_change_print(property, old_value, v);
+    if (old_value) g_variant_unref(old_value);
+    g_variant_unref(props);
+
+    return TRUE;
+}
+
+gboolean device_command_list(const gchar *adapter_name)
+{
+    GError *error = NULL;
+    Adapter *adapter = _find_adapter(adapter_name);
+    if (!adapter)
+        return FALSE;
+
+    Manager *manager = manager_new();
+    GVariant *objects = manager_get_managed_objects(manager, &error);
+    g_object_unref(manager);
+    if (error)
+    {
+        g_object_unref(adapter);
+        return_val_if_error(error, FALSE);
+    }
+
+    const gchar *object_path;
+    GVariant *ifaces_and_properties;
+    GVariantIter i;
+    guint n = 0;
+
+    g_variant_iter_init(&i, objects);
+    while (g_variant_iter_next(&i, "{&o@a{sa{sv}}}", &object_path, &ifaces_and_properties))
+    {
+        GVariant *props = NULL;
+        if (g_variant_lookup(ifaces_and_properties, DEVICE_DBUS_INTERFACE, "@a{sv}", &props))
+        {
+            const gchar *adapter_path = NULL;
+            if (g_variant_lookup(props, "Adapter", "&o", &adapter_path) && g_strcmp0(adapter_path, adapter_get_dbus_object_path(adapter)) == 0)
+            {
+                if (n++ == 0)
+                    g_print("Added devices:\n");
+                g_print("%s (%s)\n", _props_get_string(props, "Alias"), _props_get_string(props, "Address"));
+            }
+            g_variant_unref(props);
+        }
+        g_variant_unref(ifaces_and_properties);
+    }
+    g_variant_unref(objects);
+    g_object_unref(adapter);
+
+    if (n == 0)
+    {
+        g_print("No devices found\n");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+gboolean device_command_info(const gchar *adapter_name, const gchar *device_name)
+{
+    GError *error = NULL;
+    Adapter *adapter = _find_adapter(adapter_name);
+    if (!adapter)
+        return FALSE;
+
+    Device *device = _find_device(adapter, device_name);
+    g_object_unref(adapter);
+    if (!device)
+        return FALSE;
+
+    GVariant *props = _device_properties(device, &error);
+    g_object_unref(device);
+    return_val_if_error(error, FALSE);
+
+    g_print("[%s]\n", _props_get_string(props, "Address"));
+    g_print("  Name: %s\n", _props_get_string(props, "Name"));
+    g_print("  Alias: %s [rw]\n", _props_get_string(props, "Alias"));
+    g_print("  Address: %s\n", _props_get_string(props, "Address"));
+    g_print("  Icon: %s\n", _props_get_string(props, "Icon"));
+    g_print("  Class: 0x%x\n", _props_get_uint32(props, "Class"));
+    g_print("  Paired: %d\n", _props_get_boolean(props, "Paired"));
+    g_print("  Trusted: %d [rw]\n", _props_get_boolean(props, "Trusted"));
+    g_print("  Blocked: %d [rw]\n", _props_get_boolean(props, "Blocked"));
+    g_print("  Connected: %d\n", _props_get_boolean(props, "Connected"));
+    _props_print_uuids(props);
+
+    g_variant_unref(props);
+
+    return TRUE;
+}
+
+gboolean device_command_disconnect(const gchar *adapter_name, const gchar *device_name)
+{
+    GError *error = NULL;
+    Adapter *adapter = _find_adapter(adapter_name);
+    if (!adapter)
+        return FALSE;
+
+    Device *device = _find_device(adapter, device_name);
+    g_object_unref(adapter);
+    if (!device)
+        return FALSE;
+
+    g_print("Disconnecting: %s\n", device_name);
+    device_disconnect(device, &error);
+    g_object_unref(device);
+    return_val_if_error(error, FALSE);
+
+    g_print("Done\n");
+    return TRUE;
+}
+
+gboolean device_command_remove(const gchar *adapter_name, const gchar *device_name)
+{
+    GError *error = NULL;
+    Adapter *adapter = _find_adapter(adapter_name);
+    if (!adapter)
+        return FALSE;
+
+    Device *device = _find_device(adapter, device_name);
+    if (!device)
+    {
+        g_object_unref(adapter);
+        return FALSE;
+    }
+
+    adapter_remove_device(adapter, device_get_dbus_object_path(device), &error);
+    g_object_unref(device);
+    g_object_unref(adapter);
+    return_val_if_error(error, FALSE);
+
+    g_print("Done\n");
+    return TRUE;
+}
+
+gboolean device_command_set(const gchar *adapter_name, const gchar *device_name, const gchar *property, GVariant *v)
+{
+    GError *error = NULL;
+    Adapter *adapter = _find_adapter(adapter_name);
+    if (!adapter)
+        return FALSE;
+
+    Device *device = _find_device(adapter, device_name);
+    g_object_unref(adapter);
+    if (!device)
+        return FALSE;
+
+    GVariant *props = _device_properties(device, &error);
+    if (!error)
+    {
+        if (g_strcmp0(property, "Alias") == 0)
+            device_set_alias(device, g_variant_get_string(v, NULL), &error);
+        else if (g_strcmp0(property, "Blocked") == 0)
+            device_set_blocked(device, g_variant_get_boolean(v), &error);
+        else if (g_strcmp0(property, "Trusted") == 0)
+            device_set_trusted(device, g_variant_get_boolean(v), &error);
+    }
+    g_object_unref(device);
+
+    if (error)
+    {
+        if (props) g_variant_unref(props);
+        return_val_if_error(error, FALSE);
+    }
+
+    GVariant *old_value = g_variant_lookup_value(props, property, NULL);
+    property_change_print(property, old_value, v);
+    if (old_value) g_variant_unref(old_value);
+    g_variant_unref(props);
+
+    return TRUE;
+}
@@ -0,0 +1,64 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __COMMANDS_H
+#define __COMMANDS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+#include "bluez-api.h"
+
+/*
+ * bt-adapter/bt-device actions shared by the tools and bt-daemon.
+ * Output goes through g_print()/g_printerr(); they never exit the process
+ * and return FALSE when the command failed.
+ */
+
+/* Property value parsers for --set */
+GVariant *adapter_property_value_parse(const gchar *property, const gchar *value, GError **error);
+GVariant *device_property_value_parse(const gchar *property, const gchar *value, GError **error);
+
+/* Prints "<property>: <old> -> <new>" */
+void property_change_print(const gchar *property, GVariant *old_value, GVariant *new_value);
+
+/* bt-adapter */
+gboolean adapter_command_list(void);
+gboolean adapter_command_info(const gchar *adapter_name);
+gboolean adapter_command_set(const gchar *adapter_name, const gchar *property, GVariant *value);
+
+/* bt-device */
+gboolean device_command_list(const gchar *adapter_name);
+gboolean device_command_info(const gchar *adapter_name, const gchar *device_name);
+gboolean device_command_disconnect(const gchar *adapter_name, const gchar *device_name);
+gboolean device_command_remove(const gchar *adapter_name, const gchar *device_name);
+gboolean device_command_set(const gchar *adapter_name, const gchar *device_name, const gchar *property, GVariant *value);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __COMMANDS_H */
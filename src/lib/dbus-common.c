@@ -3,6 +3,7 @@
 #endif
 
 #include <gio/gio.h>
+#include <glib-unix.h>
 
 #include "bluez-api.h"
 
@@ -13,6 +14,14 @@ GDBusConnection *system_conn = NULL;
 
 static gboolean dbus_initialized = FALSE;
 
+static gint call_timeout = -1;
+static gint64 call_deadline = 0;
+static GCancellable *call_cancellable = NULL;
+
+/* The watch thread reads call_cancellable, the main thread sets it */
+static GMutex call_lock;
+static GMainContext *watch_context = NULL;
+
 void dbus_init()
 {
     dbus_initialized = TRUE;
@@ -61,3 +70,121 @@ void dbus_disconnect()
     if (session_conn)
         dbus_session_disconnect();
 }
+
+void dbus_set_call_timeout(gint timeout_msec)
+{
+    call_timeout = timeout_msec > 0 ? timeout_msec : -1;
+}
+
+void dbus_set_call_deadline(gint64 deadline)
+{
+    call_deadline = deadline;
+}
+
+void dbus_set_call_cancellable(GCancellable *cancellable)
+{
+    if (cancellable)
+        g_object_ref(cancellable);
+    g_mutex_lock(&call_lock);
+    g_clear_object(&call_cancellable);
+    call_cancellable = cancellable;
+    g_mutex_unlock(&call_lock);
+}
+
+static gpointer _watch_thread(gpointer data)
+{
+    GMainLoop *loop = g_main_loop_new(watch_context, FALSE);
+    g_main_loop_run(loop);
+    g_main_loop_unref(loop);
+    return NULL;
+}
+
+static void _watch_source(GSource *source)
+{
+    /* Started on first use, after any fork() */
+    if (!watch_context)
+    {
+        watch_context = g_main_context_new();
+        g_thread_unref(g_thread_new("dbus-call-watch", _watch_thread, NULL));
+    }
+
+    g_source_attach(source, watch_context);
+}
+
+static gboolean _cancel_calls(gpointer data)
+{
+    g_mutex_lock(&call_lock);
+    if (call_cancellable)
+        g_cancellable_cancel(call_cancellable);
+    g_mutex_unlock(&call_lock);
+
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean _socket_hangup(GSocket *socket, GIOCondition condition, gpointer user_data)
+{
+    g_cancellable_cancel(G_CANCELLABLE(user_data));
+    return G_SOURCE_REMOVE;
+}
+
+void dbus_cancel_calls_on_signal(gint signum)
+{
+    g_mutex_lock(&call_lock);
+    if (!call_cancellable)
+        call_cancellable = g_cancellable_new();
+    g_mutex_unlock(&call_lock);
+
+    GSource *source = g_unix_signal_source_new(signum);
+    g_source_set_callback(source, _cancel_calls, NULL, NULL);
+    _watch_source(source);
+    g_source_unref(source);
+}
+
+GSource *dbus_cancel_calls_on_hangup(GSocket *socket)
+{
+    g_assert(socket != NULL && call_cancellable != NULL);
+
+    GSource *source = g_socket_create_source(socket, G_IO_HUP | G_IO_ERR, NULL);
+    g_source_set_callback(source, (GSourceFunc) _socket_hangup, g_object_ref(call_cancellable), g_object_unref);
+    _watch_source(source);
+    return source;
+}
+
+gint dbus_call_timeout()
+{
+    if (call_deadline == 0)
+        return call_timeout;
+
+    gint64 left = (call_deadline - g_get_monotonic_time()) / 1000;
+    /* Past the deadline: fail fast rather than waiting for the default */
+    if (left < 1)
+        left = 1;
+    if (call_timeout > 0 && call_timeout < left)
+        return call_timeout;
+    return left < G_MAXINT ? (gint) left : G_MAXINT - 1;
+}
+
+gint64 dbus_call_deadline()
+{
+    return call_deadline;
+}
+
+GCancellable *dbus_call_cancellable()
+{
+    return call_cancellable;
+}
+
+gboolean dbus_call_timeout_parse(const gchar *value, gint *timeout_msec, GError **error)
+{
+    gchar *end = NULL;
+    gdouble seconds = g_ascii_strtod(value, &end);
+
+    if (end == value || *end != '\0' || seconds <= 0 || seconds > G_MAXINT / 1000)
+    {
+        g_set_error(error, g_quark_from_string("bluez-tools"), 0, "Invalid timeout: %s", value);
+        return FALSE;
+    }
+
+    *timeout_msec = MAX((gint) (seconds * 1000), 1);
+    return TRUE;
+}
@@ -17,6 +17,36 @@ gboolean dbus_system_connect(GError **error);
 void dbus_system_disconnect();
 void dbus_disconnect();
 
+/*
+ * Limits applied to every method call made through the wrapper library.
+ *
+ * The call timeout bounds a single call (-1 keeps the D-Bus default).
+ * The deadline, a g_get_monotonic_time() value (0 for none), bounds a whole
+ * command: calls issued close to it get only the time that is left.
+ * Cancelling the cancellable aborts the call in flight and every later one.
+ */
+void dbus_set_call_timeout(gint timeout_msec);
+void dbus_set_call_deadline(gint64 deadline);
+void dbus_set_call_cancellable(GCancellable *cancellable);
+gint dbus_call_timeout();
+gint64 dbus_call_deadline();
+GCancellable *dbus_call_cancellable();
+
+/*
+ * A synchronous call holds up the main loop, and the tool's own handlers
+ * with it: these watch from a thread of their own instead.
+ * On signum, cancel the call cancellable of the moment (one is set up if
+ * there is none); it stays cancelled, so set a fresh one, or none, before
+ * making calls again, e.g. to clean up.
+ * On the socket's hangup, cancel the current cancellable, which must be
+ * set; destroy the returned source once the calls are over.
+ */
+void dbus_cancel_calls_on_signal(gint signum);
+GSource *dbus_cancel_calls_on_hangup(GSocket *socket);
+
+/* Parses a --timeout option value (seconds, fractions allowed) into milliseconds */
+gboolean dbus_call_timeout_parse(const gchar *value, gint *timeout_msec, GError **error);
+
 #ifdef	__cplusplus
 }
 #endif
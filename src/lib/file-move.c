@@ -0,0 +1,293 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/* copy_file_range(), fallocate() */
+#define _GNU_SOURCE
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "file-move.h"
+
+#define FILE_MOVE_CHUNK (16 * 1024 * 1024)
+
+typedef struct {
+    gchar *src;
+    gchar *dst;
+    FileMoveSync sync;
+} FileMoveData;
+
+static const gchar *_sync_names[] = {"none", "data", "full"};
+
+gboolean file_move_sync_from_string(const gchar *name, FileMoveSync *sync)
+{
+    for (guint i = 0; i < G_N_ELEMENTS(_sync_names); i++)
+    {
+        if (g_strcmp0(name, _sync_names[i]) == 0)
+        {
+            *sync = i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static void _set_errno_error(GError **error, const gchar *filename, int err)
+{
+    g_set_error(error, g_quark_from_string("bluez-tools"), 1, "%s: %s", filename, g_strerror(err));
+}
+
+static gboolean _sync_dir(const gchar *filename, GError **error)
+{
+    gchar *dir = g_path_get_dirname(filename);
+    int fd = g_open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC, 0);
+    int err = fd < 0 || fsync(fd) < 0 ? errno : 0;
+
+    if (fd >= 0)
+        close(fd);
+    if (err)
+        _set_errno_error(error, dir, err);
+    g_free(dir);
+    return err == 0;
+}
+
+typedef enum {
+    COPY_FILE_RANGE,    /* within the kernel, reflinked where the filesystem can */
+    COPY_SENDFILE,      /* within the kernel, any pair of files */
+    COPY_READ_WRITE
+} CopyMethod;
+
+static ssize_t _write_all(int out, const gchar *buffer, ssize_t n)
+{
+    for (ssize_t done = 0; done < n;)
+    {
+        ssize_t w = write(out, buffer + done, n - done);
+        if (w < 0 && errno != EINTR)
+            return -1;
+        /* No progress and no error: don't spin on it */
+        if (w == 0)
+        {
+            errno = EIO;
+            return -1;
+        }
+        done += MAX(w, 0);
+    }
+    return n;
+}
+
+static ssize_t _copy_chunk(CopyMethod method, int in, int out)
+{
+    gchar buffer[64 * 1024];
+    ssize_t n;
+
+    switch (method)
+    {
+#ifdef HAVE_COPY_FILE_RANGE
+    case COPY_FILE_RANGE:
+        return copy_file_range(in, NULL, out, NULL, FILE_MOVE_CHUNK, 0);
+#endif
+    case COPY_SENDFILE:
+        return sendfile(out, in, NULL, FILE_MOVE_CHUNK);
+    default:
+        n = read(in, buffer, sizeof(buffer));
+        return n > 0 ? _write_all(out, buffer, n) : n;
+    }
+}
+
+/* Copies up to EOF, without passing the data through user space when the kernel can */
+static gboolean _copy_data(int in, int out, guint64 *copied, int *err)
+{
+#ifdef HAVE_COPY_FILE_RANGE
+    CopyMethod method = COPY_FILE_RANGE;
+#else
+    CopyMethod method = COPY_SENDFILE;
+#endif
+    guint64 done = 0;
+
+    for (;;)
+    {
+        ssize_t n = _copy_chunk(method, in, out);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        /* Not across these filesystems or not on this kernel: the next method, from the start */
+        if (n < 0 && done == 0 && method != COPY_READ_WRITE && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP))
+        {
+            method++;
+            continue;
+        }
+        if (n < 0)
+        {
+            *err = errno;
+            return FALSE;
+        }
+        if (n == 0)
+            break;
+        done += n;
+    }
+
+    *copied = done;
+    return TRUE;
+}
+
+static gboolean _copy_file(const gchar *src, const gchar *dst, FileMoveSync sync, GError **error)
+{
+    struct stat st;
+    int in = g_open(src, O_RDONLY | O_CLOEXEC, 0);
+    if (in < 0 || fstat(in, &st) < 0)
+    {
+        _set_errno_error(error, src, errno);
+        if (in >= 0)
+            close(in);
+        return FALSE;
+    }
+
+    /* Written under a temporary name, so `dst` never shows up half copied */
+    gchar *tmp = g_strdup_printf("%s.XXXXXX", dst);
+    int out = g_mkstemp_full(tmp, O_WRONLY | O_CLOEXEC, st.st_mode & 0777);
+    if (out < 0)
+    {
+        _set_errno_error(error, tmp, errno);
+        close(in);
+        g_free(tmp);
+        return FALSE;
+    }
+
+    /* What is on disk, not what the sender announced */
+    guint64 length = st.st_size;
+    guint64 copied = 0;
+    int err = 0;
+
+#ifdef HAVE_FALLOCATE
+    /* One extent up front; filesystems without it just grow the file as before */
+    if (length > 0 && fallocate(out, 0, 0, length) < 0 && errno != EOPNOTSUPP && errno != ENOSYS)
+        err = errno;
+#endif
+
+    if (err == 0 && _copy_data(in, out, &copied, &err))
+    {
+        /* The source shrank under us */
+        if (copied < length && ftruncate(out, copied) < 0)
+            err = errno;
+        if (err == 0 && sync == FILE_MOVE_SYNC_DATA && fdatasync(out) < 0)
+            err = errno;
+        if (err == 0 && sync == FILE_MOVE_SYNC_FULL && fsync(out) < 0)
+            err = errno;
+        /* g_mkstemp_full() applied the umask */
+        if (err == 0 && fchmod(out, st.st_mode & 0777) < 0)
+            err = errno;
+    }
+
+    close(in);
+    if (close(out) < 0 && err == 0)
+        err = errno;
+    if (err == 0 && g_rename(tmp, dst) < 0)
+        err = errno;
+
+    if (err)
+    {
+        _set_errno_error(error, dst, err);
+        g_unlink(tmp);
+        g_free(tmp);
+        return FALSE;
+    }
+    g_free(tmp);
+
+    if (sync == FILE_MOVE_SYNC_FULL && !_sync_dir(dst, error))
+        return FALSE;
+
+    /* Only once the copy is in place */
+    if (g_unlink(src) < 0)
+    {
+        _set_errno_error(error, src, errno);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean file_move(const gchar *src, const gchar *dst, FileMoveSync sync, GError **error)
+{
+    g_assert(src != NULL && dst != NULL);
+
+    if (g_rename(src, dst) == 0)
+        return sync != FILE_MOVE_SYNC_FULL || _sync_dir(dst, error);
+
+    if (errno != EXDEV)
+    {
+        _set_errno_error(error, src, errno);
+        return FALSE;
+    }
+
+    return _copy_file(src, dst, sync, error);
+}
+
+static void _file_move_data_free(gpointer data)
+{
+    FileMoveData *move = data;
+    g_free(move->src);
+    g_free(move->dst);
+    g_free(move);
+}
+
+static void _file_move_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+    FileMoveData *move = task_data;
+    GError *error = NULL;
+
+    if (file_move(move->src, move->dst, move->sync, &error))
+        g_task_return_boolean(task, TRUE);
+    else
+        g_task_return_error(task, error);
+}
+
+void file_move_async(const gchar *src, const gchar *dst, FileMoveSync sync, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+    g_assert(src != NULL && dst != NULL);
+
+    FileMoveData *move = g_new0(FileMoveData, 1);
+    move->src = g_strdup(src);
+    move->dst = g_strdup(dst);
+    move->sync = sync;
+
+    GTask *task = g_task_new(NULL, cancellable, callback, user_data);
+    g_task_set_task_data(task, move, _file_move_data_free);
+    g_task_run_in_thread(task, _file_move_thread);
+    g_object_unref(task);
+}
+
+gboolean file_move_finish(GAsyncResult *res, GError **error)
+{
+    return g_task_propagate_boolean(G_TASK(res), error);
+}
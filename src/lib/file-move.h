@@ -0,0 +1,56 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __FILE_MOVE_H
+#define __FILE_MOVE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <gio/gio.h>
+
+/*
+ * Move a file, across filesystems too. A rename when it can be one;
+ * otherwise the data is copied in the kernel (copy_file_range, then
+ * sendfile) into a preallocated temporary file next to the destination,
+ * which is renamed into place before the source is removed.
+ */
+typedef enum {
+    FILE_MOVE_SYNC_NONE,    /* leave write-back to the kernel */
+    FILE_MOVE_SYNC_DATA,    /* fdatasync a copied file before the source goes */
+    FILE_MOVE_SYNC_FULL     /* fsync the file and its directory, renames too */
+} FileMoveSync;
+
+gboolean file_move_sync_from_string(const gchar *name, FileMoveSync *sync);
+
+gboolean file_move(const gchar *src, const gchar *dst, FileMoveSync sync, GError **error);
+/* Same, in a worker thread */
+void file_move_async(const gchar *src, const gchar *dst, FileMoveSync sync, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+gboolean file_move_finish(GAsyncResult *res, GError **error);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __FILE_MOVE_H */
@@ -0,0 +1,141 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "ftp-cache.h"
+
+struct _FtpCache {
+    ObexFileTransfer *ftp;
+    GHashTable *listings;   /* folder -> aa{sv} */
+};
+
+FtpCache *ftp_cache_new(ObexFileTransfer *ftp)
+{
+    g_assert(ftp != NULL);
+
+    FtpCache *cache = g_new0(FtpCache, 1);
+    cache->ftp = g_object_ref(ftp);
+    cache->listings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_variant_unref);
+    return cache;
+}
+
+void ftp_cache_free(FtpCache *cache)
+{
+    if (!cache)
+        return;
+
+    g_hash_table_unref(cache->listings);
+    g_object_unref(cache->ftp);
+    g_free(cache);
+}
+
+GVariant *ftp_cache_list(FtpCache *cache, const gchar *cwd, const gchar *folder, GError **error)
+{
+    g_assert(cache != NULL && cwd != NULL && folder != NULL);
+
+    GVariant *listing = g_hash_table_lookup(cache->listings, folder);
+    if (listing)
+        return g_variant_ref(listing);
+
+    GError *list_error = NULL;
+    GError *back_error = NULL;
+    gboolean away = g_strcmp0(cwd, folder) != 0;
+
+    if (away)
+        obex_file_transfer_change_folder(cache->ftp, folder, &list_error);
+    if (!list_error)
+        listing = obex_file_transfer_list_folder(cache->ftp, &list_error);
+    if (away)
+    {
+        /* Back even if the folder was not there: the failed SETPATH may have moved the session anyway */
+        obex_file_transfer_change_folder(cache->ftp, cwd, &back_error);
+    }
+
+    if (listing)
+        g_hash_table_insert(cache->listings, g_strdup(folder), g_variant_ref(listing));
+
+    if (back_error)
+    {
+        /* Somewhere the caller can name, if the device lets us */
+        GError *root_error = NULL;
+        obex_file_transfer_change_folder(cache->ftp, "/", &root_error);
+        g_set_error(error, g_quark_from_string("bluez-tools"), FTP_CACHE_ERROR_CWD_LOST, "Can not return to %s (%s), %s", cwd, back_error->message, root_error ? "current folder unknown" : "now at /");
+
+        if (root_error)
+            g_error_free(root_error);
+        g_error_free(back_error);
+        g_clear_error(&list_error);
+        if (listing)
+            g_variant_unref(listing);
+        return NULL;
+    }
+
+    if (list_error)
+    {
+        g_propagate_error(error, list_error);
+        return NULL;
+    }
+
+    return listing;
+}
+
+void ftp_cache_invalidate(FtpCache *cache, const gchar *folder)
+{
+    g_assert(cache != NULL && folder != NULL);
+
+    gsize len = strlen(folder);
+    GHashTableIter iter;
+    gpointer key;
+
+    g_hash_table_iter_init(&iter, cache->listings);
+    while (g_hash_table_iter_next(&iter, &key, NULL))
+    {
+        const gchar *cached = key;
+        /* The folder itself, or one below it; "/" is above everything */
+        if (strncmp(cached, folder, len) == 0 && (cached[len] == '\0' || cached[len] == '/' || (len > 0 && folder[len - 1] == '/')))
+            g_hash_table_iter_remove(&iter);
+    }
+}
+
+void ftp_cache_invalidate_entry(FtpCache *cache, const gchar *path)
+{
+    g_assert(cache != NULL && path != NULL);
+
+    gchar *parent = g_path_get_dirname(path);
+    g_hash_table_remove(cache->listings, parent);
+    ftp_cache_invalidate(cache, path);
+    g_free(parent);
+}
+
+void ftp_cache_clear(FtpCache *cache)
+{
+    g_assert(cache != NULL);
+    g_hash_table_remove_all(cache->listings);
+}
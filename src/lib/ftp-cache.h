@@ -0,0 +1,68 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __FTP_CACHE_H
+#define __FTP_CACHE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+#include "bluez-api.h"
+
+/*
+ * Folder listings of an FTP session, kept until something we do changes
+ * the folder (or an explicit refresh), so that ls and path completion do
+ * not cost a Bluetooth round trip each. Folders are absolute paths as
+ * ftp_path_resolve() makes them. Changes made on the device itself are
+ * not noticed.
+ */
+typedef struct _FtpCache FtpCache;
+
+FtpCache *ftp_cache_new(ObexFileTransfer *ftp);
+void ftp_cache_free(FtpCache *cache);
+
+/*
+ * aa{sv} listing of `folder`, to be unreffed. Listing a folder other than
+ * `cwd`, the session's current one, moves the session there and back.
+ * If it can't get back, the session is moved to the root folder and the
+ * call fails with FTP_CACHE_ERROR_CWD_LOST: the caller's idea of the
+ * current folder is wrong from then on.
+ */
+#define FTP_CACHE_ERROR_CWD_LOST 3
+
+GVariant *ftp_cache_list(FtpCache *cache, const gchar *cwd, const gchar *folder, GError **error);
+
+/* Drops `folder` and everything below it */
+void ftp_cache_invalidate(FtpCache *cache, const gchar *folder);
+/* Drops the folder `path` is in, and `path` itself if it is a folder */
+void ftp_cache_invalidate_entry(FtpCache *cache, const gchar *path);
+void ftp_cache_clear(FtpCache *cache);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __FTP_CACHE_H */
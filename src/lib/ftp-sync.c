@@ -0,0 +1,488 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "dbus-common.h"
+#include "ftp-sync.h"
+
+/* Modification times closer than this are the same: FAT keeps them to 2 seconds */
+#define FTP_SYNC_TIME_SLACK 2
+
+typedef struct {
+    gchar *folder;      /* remote, absolute */
+    gchar *name;
+    gchar *local;
+    guint64 size;
+    gint64 modified;    /* remote, unix time, 0 if not known */
+} FtpSyncItem;
+
+typedef struct {
+    ObexFileTransfer *ftp;
+    FtpSyncDirection direction;
+    FtpSyncStats *stats;
+    GPtrArray *items;       /* what differs, in walk order, which groups it by folder */
+    GHashTable *transfers;  /* transfer path -> FtpSyncItem being transferred */
+} FtpSync;
+
+static void _item_free(gpointer data)
+{
+    FtpSyncItem *item = data;
+    g_free(item->folder);
+    g_free(item->name);
+    g_free(item->local);
+    g_free(item);
+}
+
+gchar *ftp_path_resolve(const gchar *cwd, const gchar *path)
+{
+    gchar *joined = path && path[0] == '/' ? g_strdup(path) : g_strconcat(cwd ? cwd : "/", "/", path, NULL);
+    gchar **parts = g_strsplit(joined, "/", -1);
+    GString *resolved = g_string_new(NULL);
+
+    for (guint i = 0; parts[i] != NULL; i++)
+    {
+        if (parts[i][0] == '\0' || g_strcmp0(parts[i], ".") == 0)
+            continue;
+        if (g_strcmp0(parts[i], "..") == 0)
+        {
+            gchar *slash = strrchr(resolved->str, '/');
+            if (slash)
+                g_string_truncate(resolved, slash - resolved->str);
+            continue;
+        }
+        g_string_append_c(resolved, '/');
+        g_string_append(resolved, parts[i]);
+    }
+    if (resolved->len == 0)
+        g_string_append_c(resolved, '/');
+
+    g_strfreev(parts);
+    g_free(joined);
+    return g_string_free(resolved, FALSE);
+}
+
+/* OBEX time: "YYYYMMDDTHHMMSS", UTC with a trailing 'Z', local time otherwise */
+static gint64 _parse_time(const gchar *value)
+{
+    gint year, month, day, hour, minute, second;
+
+    if (!value || sscanf(value, "%4d%2d%2dT%2d%2d%2d", &year, &month, &day, &hour, &minute, &second) != 6)
+        return 0;
+
+    GDateTime *time = value[strlen(value) - 1] == 'Z' ?
+            g_date_time_new_utc(year, month, day, hour, minute, second) :
+            g_date_time_new_local(year, month, day, hour, minute, second);
+    if (!time)
+        return 0;
+
+    gint64 unix_time = g_date_time_to_unix(time);
+    g_date_time_unref(time);
+    return unix_time;
+}
+
+/* The remote side names entries; none of them may lead out of the local tree */
+static gboolean _valid_name(const gchar *name)
+{
+    return name && name[0] != '\0' && g_strcmp0(name, ".") != 0 && g_strcmp0(name, "..") != 0 && strchr(name, '/') == NULL;
+}
+
+gchar *ftp_part_path(const gchar *local)
+{
+    gchar *dir = g_path_get_dirname(local);
+    gchar *base = g_path_get_basename(local);
+    gchar *part_name = g_strdup_printf(".%s.part", base);
+    gchar *part = g_build_filename(dir, part_name, NULL);
+    g_free(part_name);
+    g_free(base);
+    g_free(dir);
+    return part;
+}
+
+static void _add_item(FtpSync *sync, const gchar *folder, const gchar *name, const gchar *local, guint64 size, gint64 modified)
+{
+    FtpSyncItem *item = g_new0(FtpSyncItem, 1);
+    item->folder = g_strdup(folder);
+    item->name = g_strdup(name);
+    item->local = g_strdup(local);
+    item->size = size;
+    item->modified = modified;
+    g_ptr_array_add(sync->items, item);
+}
+
+static GVariant *_list_folder(FtpSync *sync, const gchar *folder, GError **error)
+{
+    obex_file_transfer_change_folder(sync->ftp, folder, error);
+    if (*error)
+        return NULL;
+    return obex_file_transfer_list_folder(sync->ftp, error);
+}
+
+/* Remote -> local: files missing here, or of another size or time */
+static gboolean _walk_remote(FtpSync *sync, const gchar *folder, const gchar *local_dir, GError **error)
+{
+    GVariant *listing = _list_folder(sync, folder, error);
+    if (!listing)
+        return FALSE;
+
+    if (g_mkdir_with_parents(local_dir, 0755) != 0)
+    {
+        *error = g_error_new(g_quark_from_string("bluez-tools"), 1, "%s: %s", local_dir, g_strerror(errno));
+        g_variant_unref(listing);
+        return FALSE;
+    }
+
+    /* Entered once this listing is done with, each ChangeFolder moves the session */
+    GPtrArray *subfolders = g_ptr_array_new_with_free_func(g_free);
+    GVariantIter iter;
+    GVariant *entry;
+
+    g_variant_iter_init(&iter, listing);
+    while ((entry = g_variant_iter_next_value(&iter)) != NULL)
+    {
+        const gchar *name = NULL, *type = NULL, *modified = NULL;
+        guint64 size = 0;
+        g_variant_lookup(entry, "Name", "&s", &name);
+        g_variant_lookup(entry, "Type", "&s", &type);
+        g_variant_lookup(entry, "Size", "t", &size);
+        g_variant_lookup(entry, "Modified", "&s", &modified);
+
+        if (!_valid_name(name))
+        {
+            g_printerr("%s: Invalid name in listing, skipped\n", folder);
+        }
+        else if (g_strcmp0(type, "folder") == 0)
+        {
+            g_ptr_array_add(subfolders, g_strdup(name));
+        }
+        else
+        {
+            gchar *local = g_build_filename(local_dir, name, NULL);
+            gint64 remote_time = _parse_time(modified);
+            GStatBuf buf;
+
+            sync->stats->files++;
+            if (g_stat(local, &buf) != 0 || !S_ISREG(buf.st_mode) || (guint64) buf.st_size != size ||
+                (remote_time && ABS((gint64) buf.st_mtime - remote_time) > FTP_SYNC_TIME_SLACK))
+                _add_item(sync, folder, name, local, size, remote_time);
+            g_free(local);
+        }
+        g_variant_unref(entry);
+    }
+    g_variant_unref(listing);
+
+    gboolean ok = TRUE;
+    for (guint i = 0; ok && i < subfolders->len; i++)
+    {
+        const gchar *name = g_ptr_array_index(subfolders, i);
+        gchar *child = g_build_path("/", folder, name, NULL);
+        gchar *child_dir = g_build_filename(local_dir, name, NULL);
+        ok = _walk_remote(sync, child, child_dir, error);
+        g_free(child_dir);
+        g_free(child);
+    }
+    g_ptr_array_unref(subfolders);
+    return ok;
+}
+
+static gint _compare_names(gconstpointer a, gconstpointer b)
+{
+    return g_strcmp0(*(const gchar **) a, *(const gchar **) b);
+}
+
+/* Local -> remote: files missing there, of another size, or newer here */
+static gboolean _walk_local(FtpSync *sync, const gchar *local_dir, const gchar *folder, GError **error)
+{
+    GDir *dir = g_dir_open(local_dir, 0, error);
+    if (!dir)
+        return FALSE;
+
+    GPtrArray *names = g_ptr_array_new_with_free_func(g_free);
+    const gchar *dir_name;
+    while ((dir_name = g_dir_read_name(dir)) != NULL)
+        g_ptr_array_add(names, g_strdup(dir_name));
+    g_dir_close(dir);
+    g_ptr_array_sort(names, _compare_names);
+
+    /* Name -> a{sv} of what the folder has already; a folder that is not there yet is created empty */
+    GHashTable *remote = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify) g_variant_unref);
+    GError *list_error = NULL;
+    GVariant *listing = _list_folder(sync, folder, &list_error);
+    if (listing)
+    {
+        GVariantIter iter;
+        GVariant *entry;
+        g_variant_iter_init(&iter, listing);
+        while ((entry = g_variant_iter_next_value(&iter)) != NULL)
+        {
+            const gchar *name = NULL;
+            if (g_variant_lookup(entry, "Name", "&s", &name))
+                g_hash_table_replace(remote, (gpointer) name, entry);
+            else
+                g_variant_unref(entry);
+        }
+    }
+    else
+    {
+        g_clear_error(&list_error);
+        gchar *parent = g_path_get_dirname(folder);
+        gchar *base = g_path_get_basename(folder);
+        obex_file_transfer_change_folder(sync->ftp, parent, &list_error);
+        if (!list_error)
+            obex_file_transfer_create_folder(sync->ftp, base, &list_error);
+        g_free(base);
+        g_free(parent);
+        if (list_error)
+        {
+            g_propagate_error(error, list_error);
+            g_hash_table_unref(remote);
+            g_ptr_array_unref(names);
+            return FALSE;
+        }
+    }
+
+    GPtrArray *subfolders = g_ptr_array_new_with_free_func(g_free);
+    for (guint i = 0; i < names->len; i++)
+    {
+        const gchar *name = g_ptr_array_index(names, i);
+        gchar *local = g_build_filename(local_dir, name, NULL);
+        GStatBuf buf;
+
+        if (g_stat(local, &buf) == 0 && S_ISDIR(buf.st_mode))
+        {
+            g_ptr_array_add(subfolders, g_strdup(name));
+        }
+        else if (g_stat(local, &buf) == 0 && S_ISREG(buf.st_mode))
+        {
+            GVariant *entry = g_hash_table_lookup(remote, name);
+            guint64 size = 0;
+            const gchar *modified = NULL;
+            gint64 remote_time = 0;
+
+            if (entry)
+            {
+                g_variant_lookup(entry, "Size", "t", &size);
+                g_variant_lookup(entry, "Modified", "&s", &modified);
+                remote_time = _parse_time(modified);
+            }
+
+            sync->stats->files++;
+            /* The device stamps what it receives, so an unchanged file is never newer than its copy */
+            if (!entry || size != (guint64) buf.st_size || (remote_time && (gint64) buf.st_mtime > remote_time + FTP_SYNC_TIME_SLACK))
+                _add_item(sync, folder, name, local, buf.st_size, 0);
+        }
+        g_free(local);
+    }
+    g_hash_table_unref(remote);
+    if (listing)
+        g_variant_unref(listing);
+    g_ptr_array_unref(names);
+
+    gboolean ok = TRUE;
+    for (guint i = 0; ok && i < subfolders->len; i++)
+    {
+        const gchar *name = g_ptr_array_index(subfolders, i);
+        gchar *child = g_build_path("/", folder, name, NULL);
+        gchar *child_dir = g_build_filename(local_dir, name, NULL);
+        ok = _walk_local(sync, child_dir, child, error);
+        g_free(child_dir);
+        g_free(child);
+    }
+    g_ptr_array_unref(subfolders);
+    return ok;
+}
+
+static void _transfer_done(FtpSync *sync, const gchar *transfer_path, gboolean ok)
+{
+    FtpSyncItem *item = g_hash_table_lookup(sync->transfers, transfer_path);
+    if (!item)
+        return;
+
+    if (sync->direction == FTP_SYNC_MIRROR)
+    {
+        gchar *part = ftp_part_path(item->local);
+        if (ok && g_rename(part, item->local) != 0)
+        {
+            g_printerr("%s: %s\n", item->local, g_strerror(errno));
+            ok = FALSE;
+        }
+        if (ok && item->modified)
+        {
+            struct utimbuf times = {item->modified, item->modified};
+            g_utime(item->local, &times);
+        }
+        if (!ok)
+            g_unlink(part);
+        g_free(part);
+    }
+
+    if (ok)
+    {
+        sync->stats->transferred++;
+        sync->stats->bytes += item->size;
+    }
+    else
+    {
+        g_print("Failed: %s/%s\n", g_strcmp0(item->folder, "/") == 0 ? "" : item->folder, item->name);
+        sync->stats->failed++;
+    }
+
+    g_hash_table_remove(sync->transfers, transfer_path);
+}
+
+static void _transfer_properties_changed(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    GVariant *changed = g_variant_get_child_value(parameters, 1);
+    const gchar *status = NULL;
+
+    if (g_variant_lookup(changed, "Status", "&s", &status))
+    {
+        if (g_strcmp0(status, "complete") == 0)
+            _transfer_done(user_data, object_path, TRUE);
+        else if (g_strcmp0(status, "error") == 0)
+            _transfer_done(user_data, object_path, FALSE);
+    }
+    g_variant_unref(changed);
+}
+
+/* A transfer that goes away without a final status failed */
+static void _transfer_removed(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    const gchar *transfer_path = NULL;
+    g_variant_get(parameters, "(&o@as)", &transfer_path, NULL);
+    _transfer_done(user_data, transfer_path, FALSE);
+}
+
+static void _wait_in_flight(FtpSync *sync, guint limit)
+{
+    while (g_hash_table_size(sync->transfers) > limit)
+        g_main_context_iteration(NULL, TRUE);
+}
+
+static void _submit(FtpSync *sync, FtpSyncItem *item)
+{
+    GError *error = NULL;
+    GVariant *ret = NULL;
+    gchar *part = NULL;
+
+    g_print("%s %s/%s\n", sync->direction == FTP_SYNC_MIRROR ? "get" : "put", g_strcmp0(item->folder, "/") == 0 ? "" : item->folder, item->name);
+
+    if (sync->direction == FTP_SYNC_MIRROR)
+    {
+        part = ftp_part_path(item->local);
+        ret = obex_file_transfer_get_file(sync->ftp, part, item->name, &error);
+    }
+    else
+    {
+        ret = obex_file_transfer_put_file(sync->ftp, item->local, item->name, &error);
+    }
+
+    if (!ret)
+    {
+        g_print("Failed: %s\n", error->message);
+        g_error_free(error);
+        if (part)
+            g_unlink(part);
+        sync->stats->failed++;
+    }
+    else
+    {
+        /* Signals about it are only handled once it is in the table */
+        const gchar *transfer_path = NULL;
+        g_variant_get(ret, "(&o@a{sv})", &transfer_path, NULL);
+        g_hash_table_insert(sync->transfers, g_strdup(transfer_path), item);
+        g_variant_unref(ret);
+    }
+    g_free(part);
+}
+
+gboolean ftp_sync_run(ObexFileTransfer *ftp, FtpSyncDirection direction, const gchar *remote_folder, const gchar *local_dir, FtpSyncStats *stats, GError **error)
+{
+    g_assert(ftp != NULL && remote_folder != NULL && local_dir != NULL && stats != NULL);
+
+    FtpSync sync = {ftp, direction, stats, NULL, NULL};
+    memset(stats, 0, sizeof(FtpSyncStats));
+    sync.items = g_ptr_array_new_with_free_func(_item_free);
+
+    gboolean ok = direction == FTP_SYNC_MIRROR ?
+            _walk_remote(&sync, remote_folder, local_dir, error) :
+            _walk_local(&sync, local_dir, remote_folder, error);
+    if (!ok)
+    {
+        g_ptr_array_unref(sync.items);
+        return FALSE;
+    }
+    stats->changed = sync.items->len;
+
+    sync.transfers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    guint properties_id = g_dbus_connection_signal_subscribe(session_conn, BLUEZ_OBEX_DBUS_SERVICE_NAME, "org.freedesktop.DBus.Properties", "PropertiesChanged", NULL, OBEX_TRANSFER_DBUS_INTERFACE, G_DBUS_SIGNAL_FLAGS_NONE, _transfer_properties_changed, &sync, NULL);
+    guint removed_id = g_dbus_connection_signal_subscribe(session_conn, BLUEZ_OBEX_DBUS_SERVICE_NAME, "org.freedesktop.DBus.ObjectManager", "InterfacesRemoved", NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, _transfer_removed, &sync, NULL);
+
+    const gchar *folder = NULL;
+    for (guint i = 0; i < sync.items->len; i++)
+    {
+        FtpSyncItem *item = g_ptr_array_index(sync.items, i);
+
+        if (g_strcmp0(item->folder, folder) != 0)
+        {
+            /* Names are relative to the current folder: the previous one's transfers finish first */
+            _wait_in_flight(&sync, 0);
+            GError *folder_error = NULL;
+            obex_file_transfer_change_folder(ftp, item->folder, &folder_error);
+            if (folder_error)
+            {
+                g_print("Failed: %s: %s\n", item->folder, folder_error->message);
+                g_error_free(folder_error);
+                stats->failed++;
+                folder = NULL;
+                continue;
+            }
+            folder = item->folder;
+        }
+
+        /* One transfer running and the next queued behind it in obexd */
+        _wait_in_flight(&sync, FTP_SYNC_PIPELINE - 1);
+        _submit(&sync, item);
+    }
+    _wait_in_flight(&sync, 0);
+
+    g_dbus_connection_signal_unsubscribe(session_conn, properties_id);
+    g_dbus_connection_signal_unsubscribe(session_conn, removed_id);
+    g_hash_table_unref(sync.transfers);
+    g_ptr_array_unref(sync.items);
+
+    obex_file_transfer_change_folder(ftp, remote_folder, NULL);
+    return TRUE;
+}
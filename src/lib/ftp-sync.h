@@ -0,0 +1,72 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __FTP_SYNC_H
+#define __FTP_SYNC_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+#include "bluez-api.h"
+
+/*
+ * Mirroring between a folder of an OBEX FTP session and a local directory.
+ * Both trees are compared first, by size and modification time, and only
+ * files that differ are transferred. obexd runs a session's requests in
+ * order, so within a folder the next GetFile/PutFile is issued while the
+ * current transfer is still running and the link does not idle between
+ * files. Downloaded files get the remote modification time, so the next
+ * run finds them unchanged.
+ */
+#define FTP_SYNC_PIPELINE 2 /* transfers handed to obexd at once */
+
+typedef enum {
+    FTP_SYNC_MIRROR,    /* remote -> local */
+    FTP_SYNC_PUSH       /* local -> remote */
+} FtpSyncDirection;
+
+typedef struct {
+    guint files;        /* compared */
+    guint changed;      /* to be transferred */
+    guint transferred;
+    guint failed;
+    guint64 bytes;
+} FtpSyncStats;
+
+/* `path` relative to the remote folder `cwd`, as an absolute path without "." or ".." */
+gchar *ftp_path_resolve(const gchar *cwd, const gchar *path);
+
+/* Downloads go to this hidden file next to `local` until they are complete */
+gchar *ftp_part_path(const gchar *local);
+
+/* Leaves the session in `remote_folder` */
+gboolean ftp_sync_run(ObexFileTransfer *ftp, FtpSyncDirection direction, const gchar *remote_folder, const gchar *local_dir, FtpSyncStats *stats, GError **error);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __FTP_SYNC_H */
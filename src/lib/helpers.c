@@ -152,6 +152,16 @@ int xtoi(const gchar *str)
     return i;
 }
 
+/* Reuse pooled proxies when a live object model is installed */
+static gpointer _object_proxy_new(GType type, const gchar *object_path)
+{
+    ObjectModel *model = object_model_get_default();
+    if (model)
+        return object_model_get_proxy(model, type, object_path);
+
+    return g_object_new(type, "DBusObjectPath", object_path, NULL);
+}
+
 Adapter *find_adapter(const gchar *name, GError **error)
 {
     gchar *adapter_path = NULL;
@@ -166,7 +176,7 @@ Adapter *find_adapter(const gchar *name, GError **error)
         if (adapter_path)
         {
             // adapter = g_object_new(ADAPTER_TYPE, "DBusObjectPath", adapter_path, NULL);
-            adapter = adapter_new(adapter_path);
+            adapter = _object_proxy_new(ADAPTER_TYPE, adapter_path);
         }
     }
     else
@@ -178,7 +188,7 @@ Adapter *find_adapter(const gchar *name, GError **error)
         if (adapter_path)
         {
             // adapter = g_object_new(ADAPTER_TYPE, "DBusObjectPath", adapter_path, NULL);
-            adapter = adapter_new(adapter_path);
+            adapter = _object_proxy_new(ADAPTER_TYPE, adapter_path);
         }
         else
         {
@@ -189,7 +199,7 @@ Adapter *find_adapter(const gchar *name, GError **error)
             {
                 adapter_path = g_ptr_array_index(adapters_list, i);
                 // adapter = g_object_new(ADAPTER_TYPE, "DBusObjectPath", adapter_path, NULL);
-                adapter = adapter_new(adapter_path);
+                adapter = _object_proxy_new(ADAPTER_TYPE, adapter_path);
                 adapter_path = NULL;
 
                 if (g_strcmp0(name, adapter_get_name(adapter, error)) == 0)
@@ -257,7 +267,7 @@ Device *find_device(Adapter *adapter, const gchar *name, GError **error)
                     {
                         if(g_strcmp0(g_ascii_strdown(address, -1), g_ascii_strdown(name, -1)) == 0)
                         {
-                            device = device_new(object_path);
+                            device = _object_proxy_new(DEVICE_TYPE, object_path);
                         }
                         g_free(address);
                     }
@@ -271,7 +281,7 @@ Device *find_device(Adapter *adapter, const gchar *name, GError **error)
                         g_variant_lookup(properties, "Alias", "s", &device_alias);
                         
                         if (g_strcmp0(name, device_name) == 0 || g_strcmp0(name, device_alias) == 0) {
-                            device = device_new(object_path);
+                            device = _object_proxy_new(DEVICE_TYPE, object_path);
                         }
                         
                         g_free(device_alias);
@@ -316,9 +326,9 @@ gboolean intf_supported(const gchar *dbus_service_name, const gchar *dbus_object
 
     /* Getting introspection XML */
     GError *error = NULL;
-    GDBusProxy *introspection_proxy = g_dbus_proxy_new_sync(conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, "org.freedesktop.DBus.Introspectable", NULL, &error);
+    GDBusProxy *introspection_proxy = g_dbus_proxy_new_sync(conn, G_DBUS_PROXY_FLAGS_NONE, NULL, dbus_service_name, dbus_object_path, "org.freedesktop.DBus.Introspectable", dbus_call_cancellable(), &error);
     g_assert(introspection_proxy != NULL);
-    GVariant *introspection_ret = g_dbus_proxy_call_sync(introspection_proxy, "Introspect", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+    GVariant *introspection_ret = g_dbus_proxy_call_sync(introspection_proxy, "Introspect", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), &error);
     gchar *introspection_xml = NULL;
     if (!introspection_ret)
     {
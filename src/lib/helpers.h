@@ -38,12 +38,23 @@ Adapter *find_adapter(const gchar *name, GError **error);
 Device *find_device(Adapter *adapter, const gchar *name, GError **error);
 
 /* Others helpers */
+#define print_error(error) \
+	g_printerr("%s: %s\n", (error->domain == G_DBUS_ERROR && g_dbus_error_get_remote_error(error) != NULL && strlen(g_dbus_error_get_remote_error(error)) ? g_dbus_error_get_remote_error(error) : "Error"), error->message)
+
 #define exit_if_error(error) G_STMT_START{ \
 if (error) { \
-	g_printerr("%s: %s\n", (error->domain == G_DBUS_ERROR && g_dbus_error_get_remote_error(error) != NULL && strlen(g_dbus_error_get_remote_error(error)) ? g_dbus_error_get_remote_error(error) : "Error"), error->message); \
+	print_error(error); \
 	exit(EXIT_FAILURE); \
 }; }G_STMT_END
 
+/* Same as exit_if_error(), for code that must not terminate the process */
+#define return_val_if_error(error, val) G_STMT_START{ \
+if (error) { \
+	print_error(error); \
+	g_clear_error(&error); \
+	return (val); \
+}; }G_STMT_END
+
 /* Convert hex string to int */
 int xtoi(const gchar *str);
 
@@ -57,7 +57,7 @@ static void manager_init(Manager *self)
     GError *error = NULL;
 
     g_assert(system_conn != NULL);
-    self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, BLUEZ_DBUS_SERVICE_NAME, MANAGER_DBUS_PATH, MANAGER_DBUS_INTERFACE, NULL, &error);
+    self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES | G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS, NULL, BLUEZ_DBUS_SERVICE_NAME, MANAGER_DBUS_PATH, MANAGER_DBUS_INTERFACE, dbus_call_cancellable(), &error);
 
     if (self->priv->proxy == NULL)
     {
@@ -75,11 +75,20 @@ GVariant *manager_get_managed_objects(Manager *self, GError **error)
 {
     g_assert(MANAGER_IS(self));
 
+    /* Answer from the live object model when one is installed */
+    ObjectModel *model = object_model_get_default();
+    if (model != NULL)
+        return object_model_get_managed_objects(model);
+
     GVariant *retVal = NULL;
-    retVal = g_dbus_proxy_call_sync(self->priv->proxy, "GetManagedObjects", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+    retVal = g_dbus_proxy_call_sync(self->priv->proxy, "GetManagedObjects", NULL, G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 
     if (retVal != NULL)
-        retVal = g_variant_get_child_value(retVal, 0);
+    {
+        GVariant *objects = g_variant_get_child_value(retVal, 0);
+        g_variant_unref(retVal);
+        retVal = objects;
+    }
 
     return retVal;
 }
@@ -35,6 +35,7 @@
 #include "properties.h"
 
 #include "obex_agent.h"
+#include "bluez/obex/obex_agent_interface.h"
 #include "bluez/obex/obex_transfer.h"
 
 #define OBEX_AGENT_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE((obj), OBEX_AGENT_TYPE, ObexAgentPrivate))
@@ -48,6 +49,7 @@ struct _ObexAgentPrivate {
         gpointer user_data;
         void (*agent_approved_callback)(ObexAgent *, const gchar *, const gchar *, const guint64, gpointer);
         gpointer approved_user_data;
+        ObjectModel *model;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE(ObexAgent, obex_agent, G_TYPE_OBJECT);
@@ -58,7 +60,6 @@ enum {
         PROP_AUTO_ACCPET, /* readwrite, construct only */
 };
 
-static const gchar *_obex_agent_introspect_xml = "<node name=\"/org/blueztools/obex\">\n\t<interface name=\"org.bluez.obex.Agent1\">\n\t\t<method name=\"Release\">\n\t\t</method>\n\t\t<method name=\"AuthorizePush\">\n\t\t\t<arg name=\"transfer\" direction=\"in\" type=\"o\"/>\n\t\t\t<arg name=\"filepath\" direction=\"out\" type=\"s\"/>\n\t\t</method>\n\t\t<method name=\"Cancel\">\n\t\t</method>\n\t</interface>\n</node>\n";
 
 /* Client API */
 static gboolean _update_progress = FALSE;
@@ -74,7 +75,11 @@ static void obex_agent_dispose(GObject *gobject)
 	ObexAgent *self = OBEX_AGENT(gobject);
 
         if(self->priv->registration_id)
+        {
             g_dbus_connection_unregister_object(session_conn, self->priv->registration_id);
+            g_dbus_interface_info_cache_release(obex_agent_interface_info());
+            self->priv->registration_id = 0;
+        }
 	/* Root folder free */
 	g_free(self->priv->root_folder);
         /* callback free */
@@ -89,6 +94,7 @@ static void obex_agent_dispose(GObject *gobject)
         /* user data free */
         if(self->priv->approved_user_data)
             self->priv->approved_user_data = NULL;
+        g_clear_object(&self->priv->model);
 	/* Chain up to the parent class */
 	G_OBJECT_CLASS(obex_agent_parent_class)->dispose(gobject);
 }
@@ -144,14 +150,12 @@ static void obex_agent_init(ObexAgent *self)
         GDBusInterfaceVTable obex_agent_table;
         memset(&obex_agent_table, 0x0, sizeof(obex_agent_table));
     
-        GDBusNodeInfo *obex_agent_node_info = g_dbus_node_info_new_for_xml(_obex_agent_introspect_xml, &error);
-        g_assert(error == NULL);
-        GDBusInterfaceInfo *obex_agent_interface_info = g_dbus_node_info_lookup_interface(obex_agent_node_info, OBEX_AGENT_DBUS_INTERFACE);
+        GDBusInterfaceInfo *interface_info = obex_agent_interface_info();
+        g_dbus_interface_info_cache_build(interface_info);
         obex_agent_table.method_call = _obex_agent_method_call_func;
-	self->priv->registration_id = g_dbus_connection_register_object(session_conn, OBEX_AGENT_DBUS_PATH, obex_agent_interface_info, &obex_agent_table, self, _obex_agent_g_destroy_notify, &error);
+	self->priv->registration_id = g_dbus_connection_register_object(session_conn, OBEX_AGENT_DBUS_PATH, interface_info, &obex_agent_table, self, _obex_agent_g_destroy_notify, &error);
         g_assert(error == NULL);
         g_assert(self->priv->registration_id != 0);
-        g_dbus_node_info_unref(obex_agent_node_info);
 }
 
 static void _obex_agent_get_property(GObject *object, guint property_id, GValue *value, GParamSpec *pspec)
@@ -203,20 +207,33 @@ static void _obex_agent_method_call_func(GDBusConnection *connection, const gcha
     g_assert(user_data != NULL);
     ObexAgent *self = user_data;
     
-    if (g_strcmp0(method_name, "AuthorizePush") == 0)
+    switch (obex_agent_method_id(invocation))
+    {
+    case OBEX_AGENT_METHOD_AUTHORIZE_PUSH:
     {
         const gchar *transfer = g_variant_get_string(g_variant_get_child_value(parameters, 0), NULL);
-        if (intf_supported(OBEX_TRANSFER_DBUS_SERVICE, transfer, OBEX_TRANSFER_DBUS_INTERFACE))
+        gboolean known = self->priv->model && object_model_has_interface(self->priv->model, transfer, OBEX_TRANSFER_DBUS_INTERFACE);
+        if (known || intf_supported(OBEX_TRANSFER_DBUS_SERVICE, transfer, OBEX_TRANSFER_DBUS_INTERFACE))
         {
-            ObexTransfer *transfer_t = obex_transfer_new(transfer);
+            gchar *filename = NULL;
+            guint64 size = 0;
+            if (known)
+            {
+                filename = g_strdup(object_model_get_string(self->priv->model, transfer, OBEX_TRANSFER_DBUS_INTERFACE, "Name"));
+                size = object_model_get_uint64(self->priv->model, transfer, OBEX_TRANSFER_DBUS_INTERFACE, "Size");
+            }
+            else
+            {
+                ObexTransfer *transfer_t = obex_transfer_new(transfer);
+                // Filename seems to be always NULL
+                // g_print("  Filename: %s\n", obex_transfer_get_filename(transfer_t, NULL));
+                filename = g_strdup(obex_transfer_get_name(transfer_t, NULL));
+                size = obex_transfer_get_size(transfer_t, NULL);
+                g_object_unref(transfer_t);
+            }
             g_print("[Transfer Request]\n");
-            g_print("  Name: %s\n", obex_transfer_get_name(transfer_t, NULL));
-            g_print("  Size: %" G_GINT64_FORMAT " bytes\n", obex_transfer_get_size(transfer_t, NULL));
-            // Filename seems to be always NULL
-            // g_print("  Filename: %s\n", obex_transfer_get_filename(transfer_t, NULL));
-            const gchar *filename = obex_transfer_get_name(transfer_t, NULL);
-            const guint64 size = obex_transfer_get_size(transfer_t, NULL);
-            g_object_unref(transfer_t);
+            g_print("  Name: %s\n", filename);
+            g_print("  Size: %" G_GUINT64_FORMAT " bytes\n", size);
 
             gchar yn[4] = {0,};
 			if (TRUE == self->priv->auto_accept)
@@ -244,12 +261,14 @@ static void _obex_agent_method_call_func(GDBusConnection *connection, const gcha
                 
                 // Return string
                 g_dbus_method_invocation_return_value(invocation, ret);
+                g_free(filename);
                 return;
             }
             else
             {
                 // Return error
                 g_dbus_method_invocation_return_dbus_error(invocation, "org.bluez.obex.Error.Rejected", "File transfer rejected");
+                g_free(filename);
                 return;
             }
         }
@@ -261,14 +280,16 @@ static void _obex_agent_method_call_func(GDBusConnection *connection, const gcha
             return;
         }
     }
-    else if (g_strcmp0(method_name, "Cancel") == 0)
+
+    case OBEX_AGENT_METHOD_CANCEL:
     {
         g_print("Request cancelled\n");
         // Return void
         g_dbus_method_invocation_return_value(invocation, NULL);
         return;
     }
-    else if (g_strcmp0(method_name, "Release") == 0)
+
+    case OBEX_AGENT_METHOD_RELEASE:
     {
         if (_update_progress)
         {
@@ -284,6 +305,11 @@ static void _obex_agent_method_call_func(GDBusConnection *connection, const gcha
         g_dbus_method_invocation_return_value(invocation, NULL);
         return;
     }
+
+    default:
+        g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD, "Unknown method %s", method_name);
+        return;
+    }
 }
 
 static void _obex_agent_g_destroy_notify(gpointer data)
@@ -317,4 +343,13 @@ void obex_agent_clear_approved_callback(ObexAgent *self)
     g_assert(OBEX_AGENT_IS(self));
     self->priv->agent_approved_callback = NULL;
     self->priv->approved_user_data = NULL;
-}
\ No newline at end of file
+}
+
+void obex_agent_set_object_model(ObexAgent *self, ObjectModel *model)
+{
+    g_assert(OBEX_AGENT_IS(self));
+    if (model)
+        g_object_ref(model);
+    g_clear_object(&self->priv->model);
+    self->priv->model = model;
+}
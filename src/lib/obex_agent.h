@@ -30,6 +30,8 @@ extern "C" {
 
 #include <glib-object.h>
 
+#include "object-model.h"
+
 #define OBEX_AGENT_DBUS_SERVICE "org.blueztools"
 #define OBEX_AGENT_DBUS_INTERFACE "org.bluez.obex.Agent1"
 #define OBEX_AGENT_DBUS_PATH "/org/blueztools/obex"
@@ -84,6 +86,9 @@ void obex_agent_clear_release_callback(ObexAgent *self);
 void obex_agent_set_approved_callback(ObexAgent *self, ObexAgentApprovedCallback callback_function, gpointer user_data);
 void obex_agent_clear_approved_callback(ObexAgent *self);
 
+/* Transfers known to the model are described without querying obexd */
+void obex_agent_set_object_model(ObexAgent *self, ObjectModel *model);
+
 #ifdef	__cplusplus
 }
 #endif
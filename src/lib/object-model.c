@@ -0,0 +1,433 @@
+#include <gio/gio.h>
+#include <string.h>
+#include "bluez-api.h"
+#include "dbus-common.h"
+#include "object-model.h"
+
+struct _ObjectModelPrivate
+{
+    GDBusConnection *connection;
+    gchar *service_name;
+    /* object path => (interface name => (property name => GVariant)) */
+    GHashTable *objects;
+    /* "<type name>:<object path>" => GObject */
+    GHashTable *proxies;
+    guint added_sub_id;
+    guint removed_sub_id;
+    guint changed_sub_id;
+    guint name_watch_id;
+    gboolean stale;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE(ObjectModel, object_model, G_TYPE_OBJECT)
+
+enum
+{
+    OBJECT_ADDED,
+    OBJECT_REMOVED,
+    PROPERTIES_CHANGED,
+    LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = {0};
+
+static ObjectModel *default_model = NULL;
+
+static GHashTable *_object_model_new_interfaces()
+{
+    return g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_hash_table_unref);
+}
+
+static GHashTable *_object_model_new_properties()
+{
+    return g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_variant_unref);
+}
+
+static void _object_model_merge_properties(GHashTable *properties, GVariant *changed)
+{
+    const gchar *name;
+    GVariant *value;
+    GVariantIter i;
+
+    g_variant_iter_init(&i, changed);
+    while (g_variant_iter_next(&i, "{&sv}", &name, &value))
+        g_hash_table_replace(properties, g_strdup(name), value);
+}
+
+/* Merge an a{sa{sv}} interfaces dictionary into the object at object_path */
+static void _object_model_add_interfaces(ObjectModel *self, const gchar *object_path, GVariant *ifaces_and_properties, gboolean notify)
+{
+    GHashTable *interfaces = g_hash_table_lookup(self->priv->objects, object_path);
+    if (interfaces == NULL)
+    {
+        interfaces = _object_model_new_interfaces();
+        g_hash_table_insert(self->priv->objects, g_strdup(object_path), interfaces);
+    }
+
+    const gchar *interface_name;
+    GVariant *properties;
+    GVariantIter i;
+
+    g_variant_iter_init(&i, ifaces_and_properties);
+    while (g_variant_iter_next(&i, "{&s@a{sv}}", &interface_name, &properties))
+    {
+        GHashTable *props = _object_model_new_properties();
+        _object_model_merge_properties(props, properties);
+        g_hash_table_replace(interfaces, g_strdup(interface_name), props);
+        if (notify)
+            g_signal_emit(self, signals[OBJECT_ADDED], 0, object_path, interface_name, properties);
+        g_variant_unref(properties);
+    }
+}
+
+static void _object_model_drop_proxies(ObjectModel *self, const gchar *object_path)
+{
+    gchar *suffix = g_strconcat(":", object_path, NULL);
+    GHashTableIter iter;
+    gpointer key;
+
+    g_hash_table_iter_init(&iter, self->priv->proxies);
+    while (g_hash_table_iter_next(&iter, &key, NULL))
+    {
+        if (g_str_has_suffix(key, suffix))
+            g_hash_table_iter_remove(&iter);
+    }
+    g_free(suffix);
+}
+
+static void _object_model_interfaces_added(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    ObjectModel *self = OBJECT_MODEL(user_data);
+
+    const gchar *path = NULL;
+    GVariant *ifaces_and_properties = NULL;
+    g_variant_get(parameters, "(&o@a{sa{sv}})", &path, &ifaces_and_properties);
+    _object_model_add_interfaces(self, path, ifaces_and_properties, TRUE);
+    g_variant_unref(ifaces_and_properties);
+}
+
+static void _object_model_interfaces_removed(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    ObjectModel *self = OBJECT_MODEL(user_data);
+
+    const gchar *path = NULL;
+    GVariantIter *interfaces_iter = NULL;
+    g_variant_get(parameters, "(&oas)", &path, &interfaces_iter);
+
+    GHashTable *interfaces = g_hash_table_lookup(self->priv->objects, path);
+    if (interfaces != NULL)
+    {
+        const gchar *name;
+        while (g_variant_iter_next(interfaces_iter, "&s", &name))
+        {
+            if (g_hash_table_remove(interfaces, name))
+                g_signal_emit(self, signals[OBJECT_REMOVED], 0, path, name);
+        }
+
+        if (g_hash_table_size(interfaces) == 0)
+        {
+            g_hash_table_remove(self->priv->objects, path);
+            _object_model_drop_proxies(self, path);
+        }
+    }
+    g_variant_iter_free(interfaces_iter);
+}
+
+static void _object_model_properties_changed(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    ObjectModel *self = OBJECT_MODEL(user_data);
+
+    const gchar *changed_interface = NULL;
+    GVariant *changed = NULL;
+    GVariantIter *invalidated_iter = NULL;
+    g_variant_get(parameters, "(&s@a{sv}as)", &changed_interface, &changed, &invalidated_iter);
+
+    GHashTable *interfaces = g_hash_table_lookup(self->priv->objects, object_path);
+    GHashTable *properties = interfaces ? g_hash_table_lookup(interfaces, changed_interface) : NULL;
+    if (properties != NULL)
+    {
+        _object_model_merge_properties(properties, changed);
+
+        const gchar *name;
+        while (g_variant_iter_next(invalidated_iter, "&s", &name))
+            g_hash_table_remove(properties, name);
+
+        g_signal_emit(self, signals[PROPERTIES_CHANGED], 0, object_path, changed_interface, changed);
+    }
+
+    g_variant_unref(changed);
+    g_variant_iter_free(invalidated_iter);
+}
+
+static gboolean _object_model_fetch(ObjectModel *self, GError **error)
+{
+    GVariant *reply = g_dbus_connection_call_sync(self->priv->connection, self->priv->service_name, MANAGER_DBUS_PATH, MANAGER_DBUS_INTERFACE, "GetManagedObjects", NULL, G_VARIANT_TYPE("(a{oa{sa{sv}}})"), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
+    if (reply == NULL)
+        return FALSE;
+
+    GVariant *objects = g_variant_get_child_value(reply, 0);
+    g_variant_unref(reply);
+
+    const gchar *object_path;
+    GVariant *ifaces_and_properties;
+    GVariantIter i;
+
+    g_hash_table_remove_all(self->priv->objects);
+    g_variant_iter_init(&i, objects);
+    while (g_variant_iter_next(&i, "{&o@a{sa{sv}}}", &object_path, &ifaces_and_properties))
+    {
+        _object_model_add_interfaces(self, object_path, ifaces_and_properties, FALSE);
+        g_variant_unref(ifaces_and_properties);
+    }
+    g_variant_unref(objects);
+
+    self->priv->stale = FALSE;
+    return TRUE;
+}
+
+static void _object_model_name_appeared(GDBusConnection *connection, const gchar *name, const gchar *name_owner, gpointer user_data)
+{
+    ObjectModel *self = OBJECT_MODEL(user_data);
+    GError *error = NULL;
+
+    if (!self->priv->stale)
+        return;
+
+    if (!_object_model_fetch(self, &error))
+    {
+        g_critical("%s", error->message);
+        g_error_free(error);
+    }
+}
+
+static void _object_model_name_vanished(GDBusConnection *connection, const gchar *name, gpointer user_data)
+{
+    ObjectModel *self = OBJECT_MODEL(user_data);
+
+    /* bluetoothd went away: everything we know about is gone with it */
+    g_hash_table_remove_all(self->priv->objects);
+    g_hash_table_remove_all(self->priv->proxies);
+    self->priv->stale = TRUE;
+}
+
+static void object_model_dispose(GObject *gobject)
+{
+    ObjectModel *self = OBJECT_MODEL(gobject);
+
+    if (self->priv->name_watch_id)
+    {
+        g_bus_unwatch_name(self->priv->name_watch_id);
+        self->priv->name_watch_id = 0;
+    }
+    if (self->priv->connection && self->priv->added_sub_id)
+    {
+        g_dbus_connection_signal_unsubscribe(self->priv->connection, self->priv->added_sub_id);
+        g_dbus_connection_signal_unsubscribe(self->priv->connection, self->priv->removed_sub_id);
+        g_dbus_connection_signal_unsubscribe(self->priv->connection, self->priv->changed_sub_id);
+        self->priv->added_sub_id = 0;
+        self->priv->removed_sub_id = 0;
+        self->priv->changed_sub_id = 0;
+    }
+    if (self->priv->proxies)
+        g_hash_table_remove_all(self->priv->proxies);
+    g_clear_object(&self->priv->connection);
+
+    G_OBJECT_CLASS(object_model_parent_class)->dispose(gobject);
+}
+
+static void object_model_finalize(GObject *gobject)
+{
+    ObjectModel *self = OBJECT_MODEL(gobject);
+
+    g_hash_table_unref(self->priv->objects);
+    g_hash_table_unref(self->priv->proxies);
+    g_free(self->priv->service_name);
+
+    G_OBJECT_CLASS(object_model_parent_class)->finalize(gobject);
+}
+
+static void object_model_class_init(ObjectModelClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    gobject_class->dispose = object_model_dispose;
+    gobject_class->finalize = object_model_finalize;
+
+    signals[OBJECT_ADDED] = g_signal_new("object-added", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 3, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_VARIANT);
+    signals[OBJECT_REMOVED] = g_signal_new("object-removed", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_STRING);
+    signals[PROPERTIES_CHANGED] = g_signal_new("properties-changed", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 3, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_VARIANT);
+}
+
+static void object_model_init(ObjectModel *self)
+{
+    self->priv = object_model_get_instance_private(self);
+    self->priv->objects = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_hash_table_unref);
+    self->priv->proxies = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+    self->priv->stale = TRUE;
+}
+
+ObjectModel *object_model_new(GError **error)
+{
+    g_assert(system_conn != NULL);
+    return object_model_new_for_connection(system_conn, BLUEZ_DBUS_SERVICE_NAME, error);
+}
+
+ObjectModel *object_model_new_for_connection(GDBusConnection *connection, const gchar *service_name, GError **error)
+{
+    g_assert(connection != NULL && service_name != NULL);
+
+    ObjectModel *self = g_object_new(OBJECT_MODEL_TYPE, NULL);
+    self->priv->connection = g_object_ref(connection);
+    self->priv->service_name = g_strdup(service_name);
+
+    self->priv->added_sub_id = g_dbus_connection_signal_subscribe(connection, service_name, "org.freedesktop.DBus.ObjectManager", "InterfacesAdded", NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, _object_model_interfaces_added, self, NULL);
+    self->priv->removed_sub_id = g_dbus_connection_signal_subscribe(connection, service_name, "org.freedesktop.DBus.ObjectManager", "InterfacesRemoved", NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, _object_model_interfaces_removed, self, NULL);
+    self->priv->changed_sub_id = g_dbus_connection_signal_subscribe(connection, service_name, "org.freedesktop.DBus.Properties", "PropertiesChanged", NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, _object_model_properties_changed, self, NULL);
+    self->priv->name_watch_id = g_bus_watch_name_on_connection(connection, service_name, G_BUS_NAME_WATCHER_FLAGS_NONE, _object_model_name_appeared, _object_model_name_vanished, self, NULL);
+
+    /* Signals are already subscribed, so nothing is lost between the snapshot and the first update */
+    if (!_object_model_fetch(self, error))
+    {
+        g_object_unref(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+void object_model_set_default(ObjectModel *model)
+{
+    if (model)
+        g_object_ref(model);
+    if (default_model)
+        g_object_unref(default_model);
+    default_model = model;
+}
+
+ObjectModel *object_model_get_default()
+{
+    return default_model;
+}
+
+GVariant *object_model_get_managed_objects(ObjectModel *self)
+{
+    g_assert(OBJECT_MODEL_IS(self));
+
+    GVariantBuilder builder;
+    GHashTableIter objects_iter;
+    gpointer object_path, interfaces;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a{oa{sa{sv}}}"));
+    g_hash_table_iter_init(&objects_iter, self->priv->objects);
+    while (g_hash_table_iter_next(&objects_iter, &object_path, &interfaces))
+    {
+        GHashTableIter interfaces_iter;
+        gpointer interface_name, properties;
+
+        g_variant_builder_open(&builder, G_VARIANT_TYPE("{oa{sa{sv}}}"));
+        g_variant_builder_add(&builder, "o", object_path);
+        g_variant_builder_open(&builder, G_VARIANT_TYPE("a{sa{sv}}"));
+        g_hash_table_iter_init(&interfaces_iter, interfaces);
+        while (g_hash_table_iter_next(&interfaces_iter, &interface_name, &properties))
+        {
+            GVariant *props = object_model_get_properties(self, object_path, interface_name);
+            g_variant_builder_add(&builder, "{s@a{sv}}", interface_name, props);
+            g_variant_unref(props);
+        }
+        g_variant_builder_close(&builder);
+        g_variant_builder_close(&builder);
+    }
+
+    return g_variant_ref_sink(g_variant_builder_end(&builder));
+}
+
+GVariant *object_model_get_properties(ObjectModel *self, const gchar *object_path, const gchar *interface_name)
+{
+    g_assert(OBJECT_MODEL_IS(self));
+    g_assert(object_path != NULL && interface_name != NULL);
+
+    GHashTable *interfaces = g_hash_table_lookup(self->priv->objects, object_path);
+    GHashTable *properties = interfaces ? g_hash_table_lookup(interfaces, interface_name) : NULL;
+    if (properties == NULL)
+        return NULL;
+
+    GVariantBuilder builder;
+    GHashTableIter iter;
+    gpointer name, value;
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sv}"));
+    g_hash_table_iter_init(&iter, properties);
+    while (g_hash_table_iter_next(&iter, &name, &value))
+        g_variant_builder_add(&builder, "{sv}", name, value);
+
+    return g_variant_ref_sink(g_variant_builder_end(&builder));
+}
+
+gpointer object_model_get_proxy(ObjectModel *self, GType type, const gchar *object_path)
+{
+    g_assert(OBJECT_MODEL_IS(self));
+    g_assert(object_path != NULL);
+
+    gchar *key = g_strdup_printf("%s:%s", g_type_name(type), object_path);
+    GObject *proxy = g_hash_table_lookup(self->priv->proxies, key);
+    if (proxy == NULL)
+    {
+        proxy = g_object_new(type, "DBusObjectPath", object_path, NULL);
+        g_hash_table_insert(self->priv->proxies, key, proxy);
+    }
+    else
+    {
+        g_free(key);
+    }
+
+    /* Callers own the returned reference, the pool keeps its own */
+    return g_object_ref(proxy);
+}
+
+static GVariant *_object_model_lookup(ObjectModel *self, const gchar *object_path, const gchar *interface_name, const gchar *property_name)
+{
+    g_assert(OBJECT_MODEL_IS(self));
+
+    GHashTable *interfaces = g_hash_table_lookup(self->priv->objects, object_path);
+    GHashTable *properties = interfaces ? g_hash_table_lookup(interfaces, interface_name) : NULL;
+    return properties ? g_hash_table_lookup(properties, property_name) : NULL;
+}
+
+gboolean object_model_has_interface(ObjectModel *self, const gchar *object_path, const gchar *interface_name)
+{
+    g_assert(OBJECT_MODEL_IS(self));
+
+    GHashTable *interfaces = g_hash_table_lookup(self->priv->objects, object_path);
+    return interfaces != NULL && g_hash_table_contains(interfaces, interface_name);
+}
+
+GVariant *object_model_get_property(ObjectModel *self, const gchar *object_path, const gchar *interface_name, const gchar *property_name)
+{
+    GVariant *value = _object_model_lookup(self, object_path, interface_name, property_name);
+    return value ? g_variant_ref(value) : NULL;
+}
+
+const gchar *object_model_get_string(ObjectModel *self, const gchar *object_path, const gchar *interface_name, const gchar *property_name)
+{
+    GVariant *value = _object_model_lookup(self, object_path, interface_name, property_name);
+    if (value && (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING) || g_variant_is_of_type(value, G_VARIANT_TYPE_OBJECT_PATH)))
+        return g_variant_get_string(value, NULL);
+    return NULL;
+}
+
+gboolean object_model_get_boolean(ObjectModel *self, const gchar *object_path, const gchar *interface_name, const gchar *property_name)
+{
+    GVariant *value = _object_model_lookup(self, object_path, interface_name, property_name);
+    if (value && g_variant_is_of_type(value, G_VARIANT_TYPE_BOOLEAN))
+        return g_variant_get_boolean(value);
+    return FALSE;
+}
+
+guint64 object_model_get_uint64(ObjectModel *self, const gchar *object_path, const gchar *interface_name, const gchar *property_name)
+{
+    GVariant *value = _object_model_lookup(self, object_path, interface_name, property_name);
+    if (value && g_variant_is_of_type(value, G_VARIANT_TYPE_UINT64))
+        return g_variant_get_uint64(value);
+    if (value && g_variant_is_of_type(value, G_VARIANT_TYPE_UINT32))
+        return g_variant_get_uint32(value);
+    return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef OBJECT_MODEL_H
+#define	OBJECT_MODEL_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <glib-object.h>
+#include <gio/gio.h>
+    /*
+     * Potentially, include other headers on which this header depends.
+     */
+
+    /*
+     * Type macros.
+     */
+#define OBJECT_MODEL_TYPE                  (object_model_get_type ())
+#define OBJECT_MODEL(obj)                  (G_TYPE_CHECK_INSTANCE_CAST ((obj), OBJECT_MODEL_TYPE, ObjectModel))
+#define OBJECT_MODEL_IS(obj)               (G_TYPE_CHECK_INSTANCE_TYPE ((obj), OBJECT_MODEL_TYPE))
+#define OBJECT_MODEL_CLASS(klass)          (G_TYPE_CHECK_CLASS_CAST ((klass), OBJECT_MODEL_TYPE, ObjectModelClass))
+#define OBJECT_MODEL_IS_CLASS(klass)       (G_TYPE_CHECK_CLASS_TYPE ((klass), OBJECT_MODEL_TYPE))
+#define OBJECT_MODEL_GET_CLASS(obj)        (G_TYPE_INSTANCE_GET_CLASS ((obj), OBJECT_MODEL_TYPE, ObjectModelClass))
+
+    typedef struct _ObjectModel ObjectModel;
+    typedef struct _ObjectModelPrivate ObjectModelPrivate;
+    typedef struct _ObjectModelClass ObjectModelClass;
+
+    struct _ObjectModel {
+        /* Parent instance structure */
+        GObject parent_instance;
+
+        /* instance members */
+        ObjectModelPrivate *priv;
+    };
+
+    struct _ObjectModelClass {
+        /* Parent class structure */
+        GObjectClass parent_class;
+
+        /* class members */
+    };
+
+    /* used by OBJECT_MODEL_TYPE */
+    GType object_model_get_type(void);
+
+    /*
+     * Constructors
+     *
+     * Fetch the object tree of a service once and keep it up to date from the
+     * InterfacesAdded/InterfacesRemoved/PropertiesChanged signals.
+     * object_model_new() watches bluetoothd on the system bus.
+     */
+    ObjectModel *object_model_new(GError **error);
+    ObjectModel *object_model_new_for_connection(GDBusConnection *connection, const gchar *service_name, GError **error);
+
+    /*
+     * Process wide model. When set, Manager answers GetManagedObjects from
+     * the model and the find_* helpers reuse pooled proxies.
+     */
+    void object_model_set_default(ObjectModel *model);
+    ObjectModel *object_model_get_default();
+
+    /*
+     * Method definitions.
+     */
+    GVariant *object_model_get_managed_objects(ObjectModel *self);
+    GVariant *object_model_get_properties(ObjectModel *self, const gchar *object_path, const gchar *interface_name);
+    gpointer object_model_get_proxy(ObjectModel *self, GType type, const gchar *object_path);
+
+    /*
+     * Lookups answered from memory.
+     * Returned strings belong to the model and stay valid until the property
+     * changes, copy them if they have to outlive the current callback.
+     */
+    gboolean object_model_has_interface(ObjectModel *self, const gchar *object_path, const gchar *interface_name);
+    GVariant *object_model_get_property(ObjectModel *self, const gchar *object_path, const gchar *interface_name, const gchar *property_name);
+    const gchar *object_model_get_string(ObjectModel *self, const gchar *object_path, const gchar *interface_name, const gchar *property_name);
+    gboolean object_model_get_boolean(ObjectModel *self, const gchar *object_path, const gchar *interface_name, const gchar *property_name);
+    guint64 object_model_get_uint64(ObjectModel *self, const gchar *object_path, const gchar *interface_name, const gchar *property_name);
+
+    /*
+     * Signals, emitted once the model is up to date:
+     *   "object-added"       (const gchar *object_path, const gchar *interface_name, GVariant *properties)
+     *   "object-removed"     (const gchar *object_path, const gchar *interface_name)
+     *   "properties-changed" (const gchar *object_path, const gchar *interface_name, GVariant *changed_properties)
+     */
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* OBJECT_MODEL_H */
+
@@ -0,0 +1,276 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "pin-db.h"
+
+#define PIN_DB_HEADER_SIZE 32
+#define PIN_DB_SLOT_SIZE 12
+
+typedef struct {
+    gchar magic[8];
+    guint32 version;
+    guint32 entries;
+    guint32 slots;
+    guint32 slots_offset;
+    guint32 strings_offset;
+    guint32 strings_size;
+} PinDbHeader;
+
+typedef struct {
+    guint32 hash;
+    guint32 key;
+    guint32 value;
+} PinDbSlot;
+
+G_STATIC_ASSERT(sizeof(PinDbHeader) == PIN_DB_HEADER_SIZE);
+G_STATIC_ASSERT(sizeof(PinDbSlot) == PIN_DB_SLOT_SIZE);
+
+struct _PinDb {
+    GMappedFile *file;
+    const PinDbSlot *slots;
+    guint32 mask;
+    guint32 entries;
+    const gchar *strings;
+    guint32 strings_size;
+};
+
+static guint32 _pin_db_hash(const gchar *key)
+{
+    guint32 h = 2166136261u;
+    for (const guchar *p = (const guchar *) key; *p; p++)
+    {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+gboolean pin_db_file_is_compiled(const gchar *filename)
+{
+    gchar magic[sizeof(PIN_DB_MAGIC) - 1];
+    gboolean compiled = FALSE;
+
+    int fd = g_open(filename, O_RDONLY, 0);
+    if (fd < 0)
+        return FALSE;
+    if (read(fd, magic, sizeof(magic)) == sizeof(magic))
+        compiled = memcmp(magic, PIN_DB_MAGIC, sizeof(magic)) == 0;
+    close(fd);
+
+    return compiled;
+}
+
+static guint32 _pin_db_add_string(GString *strings, const gchar *s)
+{
+    guint32 offset = strings->len;
+    g_string_append_len(strings, s, strlen(s) + 1);
+    return offset;
+}
+
+gboolean pin_db_write(GHashTable *pins, const gchar *filename, GError **error)
+{
+    g_assert(pins != NULL && filename != NULL);
+
+    guint entries = g_hash_table_size(pins);
+    guint32 slots = 8;
+    /* Keep the table at most half full so probe sequences stay short */
+    while (slots < entries * 2)
+        slots <<= 1;
+
+    PinDbSlot *table = g_new0(PinDbSlot, slots);
+    GString *strings = g_string_new(NULL);
+    g_string_append_c(strings, '\0');
+
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, pins);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        guint32 h = _pin_db_hash(key);
+        guint32 i = h & (slots - 1);
+        while (table[i].key != 0)
+            i = (i + 1) & (slots - 1);
+
+        table[i].hash = GUINT32_TO_LE(h);
+        table[i].key = GUINT32_TO_LE(_pin_db_add_string(strings, key));
+        table[i].value = GUINT32_TO_LE(_pin_db_add_string(strings, value));
+    }
+
+    PinDbHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PIN_DB_MAGIC, sizeof(header.magic));
+    header.version = GUINT32_TO_LE(PIN_DB_VERSION);
+    header.entries = GUINT32_TO_LE(entries);
+    header.slots = GUINT32_TO_LE(slots);
+    header.slots_offset = GUINT32_TO_LE(PIN_DB_HEADER_SIZE);
+    header.strings_offset = GUINT32_TO_LE(PIN_DB_HEADER_SIZE + slots * PIN_DB_SLOT_SIZE);
+    header.strings_size = GUINT32_TO_LE(strings->len);
+
+    /* Written next to the target and renamed over it, so a running agent never maps a partial file */
+    gchar *tmp_filename = g_strdup_printf("%s.XXXXXX", filename);
+    gboolean ok = FALSE;
+    int fd = g_mkstemp_full(tmp_filename, O_WRONLY, 0600);
+
+    if (fd < 0)
+    {
+        g_set_error(error, g_quark_from_string("bluez-tools"), 1, "%s: %s", filename, g_strerror(errno));
+        goto out;
+    }
+
+    if (write(fd, &header, sizeof(header)) != sizeof(header) ||
+        write(fd, table, slots * PIN_DB_SLOT_SIZE) != (ssize_t) (slots * PIN_DB_SLOT_SIZE) ||
+        write(fd, strings->str, strings->len) != (ssize_t) strings->len ||
+        fsync(fd) != 0)
+    {
+        g_set_error(error, g_quark_from_string("bluez-tools"), 1, "%s: %s", tmp_filename, g_strerror(errno));
+        close(fd);
+        g_unlink(tmp_filename);
+        goto out;
+    }
+    close(fd);
+
+    if (g_rename(tmp_filename, filename) != 0)
+    {
+        g_set_error(error, g_quark_from_string("bluez-tools"), 1, "%s: %s", filename, g_strerror(errno));
+        g_unlink(tmp_filename);
+        goto out;
+    }
+    ok = TRUE;
+
+out:
+    g_free(tmp_filename);
+    g_string_free(strings, TRUE);
+    g_free(table);
+    return ok;
+}
+
+PinDb *pin_db_open(const gchar *filename, GError **error)
+{
+    g_assert(filename != NULL);
+
+    GMappedFile *file = g_mapped_file_new(filename, FALSE, error);
+    if (file == NULL)
+        return NULL;
+
+    const gchar *contents = g_mapped_file_get_contents(file);
+    guint64 size = g_mapped_file_get_length(file);
+    PinDbHeader header;
+
+    if (size < sizeof(header))
+        goto invalid;
+    memcpy(&header, contents, sizeof(header));
+
+    guint32 slots = GUINT32_FROM_LE(header.slots);
+    guint32 slots_offset = GUINT32_FROM_LE(header.slots_offset);
+    guint32 strings_offset = GUINT32_FROM_LE(header.strings_offset);
+    guint32 strings_size = GUINT32_FROM_LE(header.strings_size);
+
+    /* Everything a lookup relies on is checked once here */
+    if (memcmp(header.magic, PIN_DB_MAGIC, sizeof(header.magic)) != 0 ||
+        GUINT32_FROM_LE(header.version) != PIN_DB_VERSION ||
+        slots == 0 || (slots & (slots - 1)) != 0 ||
+        GUINT32_FROM_LE(header.entries) >= slots ||
+        slots_offset % 4 != 0 ||
+        (guint64) slots_offset + (guint64) slots * PIN_DB_SLOT_SIZE > size ||
+        strings_size == 0 ||
+        (guint64) strings_offset + strings_size > size ||
+        contents[strings_offset + strings_size - 1] != '\0')
+        goto invalid;
+
+    PinDb *db = g_new0(PinDb, 1);
+    db->file = file;
+    db->slots = (const PinDbSlot *) (contents + slots_offset);
+    db->mask = slots - 1;
+    db->entries = GUINT32_FROM_LE(header.entries);
+    db->strings = contents + strings_offset;
+    db->strings_size = strings_size;
+    return db;
+
+invalid:
+    g_set_error(error, g_quark_from_string("bluez-tools"), 2, "%s: Invalid PIN database", filename);
+    g_mapped_file_unref(file);
+    return NULL;
+}
+
+void pin_db_free(PinDb *db)
+{
+    if (db == NULL)
+        return;
+    g_mapped_file_unref(db->file);
+    g_free(db);
+}
+
+guint pin_db_size(PinDb *db)
+{
+    g_assert(db != NULL);
+    return db->entries;
+}
+
+const gchar *pin_db_lookup(PinDb *db, const gchar *key)
+{
+    g_assert(db != NULL);
+
+    if (key == NULL)
+        return NULL;
+
+    guint32 h = _pin_db_hash(key);
+    for (guint32 i = h & db->mask, n = 0; n <= db->mask; i = (i + 1) & db->mask, n++)
+    {
+        guint32 key_offset = GUINT32_FROM_LE(db->slots[i].key);
+        if (key_offset == 0)
+            return NULL;
+        if (GUINT32_FROM_LE(db->slots[i].hash) != h || key_offset >= db->strings_size)
+            continue;
+        if (strcmp(db->strings + key_offset, key) == 0)
+        {
+            guint32 value_offset = GUINT32_FROM_LE(db->slots[i].value);
+            return value_offset < db->strings_size ? db->strings + value_offset : NULL;
+        }
+    }
+    return NULL;
+}
+
+void pin_db_foreach(PinDb *db, GHFunc func, gpointer user_data)
+{
+    g_assert(db != NULL && func != NULL);
+
+    for (guint32 i = 0; i <= db->mask; i++)
+    {
+        guint32 key_offset = GUINT32_FROM_LE(db->slots[i].key);
+        guint32 value_offset = GUINT32_FROM_LE(db->slots[i].value);
+        if (key_offset != 0 && key_offset < db->strings_size && value_offset < db->strings_size)
+            func((gpointer) (db->strings + key_offset), (gpointer) (db->strings + value_offset), user_data);
+    }
+}
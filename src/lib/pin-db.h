@@ -0,0 +1,70 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __PIN_DB_H
+#define __PIN_DB_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+/*
+ * Compiled PIN database, as produced by `bt-agent --compile-pins`.
+ *
+ * The file is mapped read-only and holds an open addressing hash table
+ * (FNV-1a, linear probing) of "MAC or device name" => PIN, so a lookup
+ * costs one hash and usually one string compare, and returns a pointer
+ * into the mapping. All integers are little-endian.
+ *
+ *   header   "BTPINDB1", version, entries, slots (power of 2),
+ *            slots offset, strings offset, strings size   (32 bytes)
+ *   slots    { hash, key offset, value offset } x slots, key offset 0 = empty
+ *   strings  NUL terminated keys and values, starting with an empty string
+ */
+#define PIN_DB_MAGIC "BTPINDB1"
+#define PIN_DB_VERSION 1
+
+typedef struct _PinDb PinDb;
+
+/* TRUE if filename starts with the compiled database magic */
+gboolean pin_db_file_is_compiled(const gchar *filename);
+
+/* Writes pins (gchar * => gchar *) to filename atomically, readable by the owner only */
+gboolean pin_db_write(GHashTable *pins, const gchar *filename, GError **error);
+
+PinDb *pin_db_open(const gchar *filename, GError **error);
+void pin_db_free(PinDb *db);
+
+guint pin_db_size(PinDb *db);
+/* The returned string lives in the mapping, valid until pin_db_free() */
+const gchar *pin_db_lookup(PinDb *db, const gchar *key);
+/* Calls func(key, pin, user_data) for every entry, strings as above */
+void pin_db_foreach(PinDb *db, GHFunc func, gpointer user_data);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __PIN_DB_H */
@@ -0,0 +1,332 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "pin-rules.h"
+
+typedef struct {
+    guint32 child[16];
+    const gchar *pin;
+    GArray *globs;      /* glob tries: ranks of the globs whose literal ends here */
+} PinTrieNode;
+
+typedef struct {
+    GPatternSpec *spec;
+    const gchar *pattern;
+    guint literal;
+    const gchar *pin;
+} PinGlob;
+
+struct _PinRules {
+    /* Node 0 is the root, a child index of 0 means no child */
+    GArray *mac_trie;
+    GArray *name_trie;
+    GPtrArray *globs;           /* most specific first, a glob's rank is its index */
+    GArray *glob_prefix_trie;   /* by the literal before the first wildcard */
+    GArray *glob_suffix_trie;   /* by the literal after the last one, reversed */
+    GArray *glob_others;        /* ranks of globs with wildcards at both ends */
+    guint size;
+};
+
+static GArray *_trie_new()
+{
+    GArray *trie = g_array_new(FALSE, TRUE, sizeof(PinTrieNode));
+    g_array_set_size(trie, 1);
+    return trie;
+}
+
+static void _trie_free(GArray *trie)
+{
+    for (guint i = 0; i < trie->len; i++)
+        if (g_array_index(trie, PinTrieNode, i).globs)
+            g_array_unref(g_array_index(trie, PinTrieNode, i).globs);
+    g_array_unref(trie);
+}
+
+static guint32 _trie_child(GArray *trie, guint32 node, guint8 nibble, gboolean create)
+{
+    guint32 child = g_array_index(trie, PinTrieNode, node).child[nibble];
+    if (child == 0 && create)
+    {
+        child = trie->len;
+        g_array_set_size(trie, trie->len + 1);
+        /* g_array_set_size() may have moved the nodes */
+        g_array_index(trie, PinTrieNode, node).child[nibble] = child;
+    }
+    return child;
+}
+
+/* "00:1A:7D:*": one to five octets followed by a star */
+static gboolean _is_mac_prefix(const gchar *key)
+{
+    guint octets = 0;
+    const gchar *p = key;
+
+    while (g_ascii_xdigit_value(p[0]) >= 0 && g_ascii_xdigit_value(p[1]) >= 0 && p[2] == ':')
+    {
+        octets++;
+        p += 3;
+    }
+    return octets > 0 && octets < 6 && g_strcmp0(p, "*") == 0;
+}
+
+/* "Name*": a literal followed by a single trailing star */
+static gboolean _is_name_prefix(const gchar *key)
+{
+    gsize len = strlen(key);
+    return len > 1 && key[len - 1] == '*' && strpbrk(key, "*?") == key + len - 1;
+}
+
+gboolean pin_rules_is_pattern(const gchar *key)
+{
+    return g_strcmp0(key, "*") != 0 && strpbrk(key, "*?") != NULL;
+}
+
+static gint _glob_compare(gconstpointer a, gconstpointer b)
+{
+    const PinGlob *ga = *(const PinGlob **) a;
+    const PinGlob *gb = *(const PinGlob **) b;
+
+    if (ga->literal != gb->literal)
+        return ga->literal > gb->literal ? -1 : 1;
+    return strcmp(ga->pattern, gb->pattern);
+}
+
+static void _glob_free(gpointer data)
+{
+    PinGlob *glob = data;
+    g_pattern_spec_free(glob->spec);
+    g_free(glob);
+}
+
+/* Files the glob under `literal`, read backwards for the suffix trie */
+static void _glob_trie_add(GArray *trie, const gchar *literal, gsize len, gboolean backwards, guint rank)
+{
+    guint32 node = 0;
+    for (gsize i = 0; i < len; i++)
+    {
+        guchar c = literal[backwards ? len - 1 - i : i];
+        node = _trie_child(trie, node, c >> 4, TRUE);
+        node = _trie_child(trie, node, c & 0xf, TRUE);
+    }
+
+    PinTrieNode *n = &g_array_index(trie, PinTrieNode, node);
+    if (!n->globs)
+        n->globs = g_array_new(FALSE, FALSE, sizeof(guint));
+    g_array_append_val(n->globs, rank);
+}
+
+/* Ranks of the globs whose literal prefix (suffix when `backwards`) `string` has */
+static void _glob_trie_collect(GArray *trie, const gchar *string, gboolean backwards, GArray *ranks)
+{
+    gsize len = strlen(string);
+    guint32 node = 0;
+    for (gsize i = 0; i < len; i++)
+    {
+        guchar c = string[backwards ? len - 1 - i : i];
+        if ((node = _trie_child(trie, node, c >> 4, FALSE)) == 0 ||
+            (node = _trie_child(trie, node, c & 0xf, FALSE)) == 0)
+            break;
+
+        GArray *globs = g_array_index(trie, PinTrieNode, node).globs;
+        if (globs)
+            g_array_append_vals(ranks, globs->data, globs->len);
+    }
+}
+
+static gint _rank_compare(gconstpointer a, gconstpointer b)
+{
+    guint ra = *(const guint *) a;
+    guint rb = *(const guint *) b;
+    return ra < rb ? -1 : ra > rb;
+}
+
+PinRules *pin_rules_new(GHashTable *pins)
+{
+    g_assert(pins != NULL);
+
+    PinRules *rules = g_new0(PinRules, 1);
+    rules->mac_trie = _trie_new();
+    rules->name_trie = _trie_new();
+    rules->globs = g_ptr_array_new_with_free_func(_glob_free);
+    rules->glob_prefix_trie = _trie_new();
+    rules->glob_suffix_trie = _trie_new();
+    rules->glob_others = g_array_new(FALSE, FALSE, sizeof(guint));
+
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, pins);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        const gchar *pattern = key;
+        if (!pin_rules_is_pattern(pattern))
+            continue;
+
+        rules->size++;
+
+        if (_is_mac_prefix(pattern))
+        {
+            guint32 node = 0;
+            for (const gchar *p = pattern; *p != '*'; p++)
+                if (*p != ':')
+                    node = _trie_child(rules->mac_trie, node, g_ascii_xdigit_value(*p), TRUE);
+            g_array_index(rules->mac_trie, PinTrieNode, node).pin = value;
+        }
+        else if (_is_name_prefix(pattern))
+        {
+            guint32 node = 0;
+            for (const guchar *p = (const guchar *) pattern; *p != '*'; p++)
+            {
+                node = _trie_child(rules->name_trie, node, *p >> 4, TRUE);
+                node = _trie_child(rules->name_trie, node, *p & 0xf, TRUE);
+            }
+            g_array_index(rules->name_trie, PinTrieNode, node).pin = value;
+        }
+        else
+        {
+            PinGlob *glob = g_new0(PinGlob, 1);
+            glob->spec = g_pattern_spec_new(pattern);
+            glob->pattern = pattern;
+            glob->pin = value;
+            for (const gchar *p = pattern; *p; p++)
+                if (*p != '*' && *p != '?')
+                    glob->literal++;
+            g_ptr_array_add(rules->globs, glob);
+        }
+    }
+
+    g_ptr_array_sort(rules->globs, _glob_compare);
+
+    /* A string can only match globs whose literal ends it starts or ends with */
+    for (guint i = 0; i < rules->globs->len; i++)
+    {
+        const gchar *pattern = ((PinGlob *) g_ptr_array_index(rules->globs, i))->pattern;
+        gsize prefix = strcspn(pattern, "*?");
+        const gchar *suffix = pattern + strlen(pattern);
+        while (suffix > pattern && suffix[-1] != '*' && suffix[-1] != '?')
+            suffix--;
+
+        if (prefix > 0)
+            _glob_trie_add(rules->glob_prefix_trie, pattern, prefix, FALSE, i);
+        else if (*suffix)
+            _glob_trie_add(rules->glob_suffix_trie, suffix, strlen(suffix), TRUE, i);
+        else
+            g_array_append_val(rules->glob_others, i);
+    }
+
+    return rules;
+}
+
+void pin_rules_free(PinRules *rules)
+{
+    if (rules == NULL)
+        return;
+    _trie_free(rules->mac_trie);
+    _trie_free(rules->name_trie);
+    g_ptr_array_unref(rules->globs);
+    _trie_free(rules->glob_prefix_trie);
+    _trie_free(rules->glob_suffix_trie);
+    g_array_unref(rules->glob_others);
+    g_free(rules);
+}
+
+guint pin_rules_size(PinRules *rules)
+{
+    g_assert(rules != NULL);
+    return rules->size;
+}
+
+static const gchar *_glob_lookup(PinRules *rules, const gchar *string)
+{
+    if (rules->globs->len == 0)
+        return NULL;
+
+    /* Only the candidates the tries give, in order of specificity */
+    GArray *ranks = g_array_new(FALSE, FALSE, sizeof(guint));
+    _glob_trie_collect(rules->glob_prefix_trie, string, FALSE, ranks);
+    _glob_trie_collect(rules->glob_suffix_trie, string, TRUE, ranks);
+    g_array_append_vals(ranks, rules->glob_others->data, rules->glob_others->len);
+    g_array_sort(ranks, _rank_compare);
+
+    const gchar *pin = NULL;
+    for (guint i = 0; i < ranks->len && !pin; i++)
+    {
+        PinGlob *glob = g_ptr_array_index(rules->globs, g_array_index(ranks, guint, i));
+        if (g_pattern_match_string(glob->spec, string))
+            pin = glob->pin;
+    }
+
+    g_array_unref(ranks);
+    return pin;
+}
+
+const gchar *pin_rules_lookup_address(PinRules *rules, const gchar *address)
+{
+    g_assert(rules != NULL);
+
+    if (address == NULL)
+        return NULL;
+
+    const gchar *pin = NULL;
+    guint32 node = 0;
+    for (const gchar *p = address; *p; p++)
+    {
+        if (*p == ':')
+            continue;
+        gint nibble = g_ascii_xdigit_value(*p);
+        if (nibble < 0 || (node = _trie_child(rules->mac_trie, node, nibble, FALSE)) == 0)
+            break;
+        if (g_array_index(rules->mac_trie, PinTrieNode, node).pin)
+            pin = g_array_index(rules->mac_trie, PinTrieNode, node).pin;
+    }
+
+    return pin ? pin : _glob_lookup(rules, address);
+}
+
+const gchar *pin_rules_lookup_name(PinRules *rules, const gchar *name)
+{
+    g_assert(rules != NULL);
+
+    if (name == NULL)
+        return NULL;
+
+    const gchar *pin = NULL;
+    guint32 node = 0;
+    for (const guchar *p = (const guchar *) name; *p; p++)
+    {
+        if ((node = _trie_child(rules->name_trie, node, *p >> 4, FALSE)) == 0 ||
+            (node = _trie_child(rules->name_trie, node, *p & 0xf, FALSE)) == 0)
+            break;
+        if (g_array_index(rules->name_trie, PinTrieNode, node).pin)
+            pin = g_array_index(rules->name_trie, PinTrieNode, node).pin;
+    }
+
+    return pin ? pin : _glob_lookup(rules, name);
+}
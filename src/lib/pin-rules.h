@@ -0,0 +1,67 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __PIN_RULES_H
+#define __PIN_RULES_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+/*
+ * Wildcard entries of the PIN's file:
+ *   00:1A:7D:*      MAC prefix (whole octets), kept in a nibble trie
+ *   Keyboard*       name prefix, kept in a nibble trie over the name bytes
+ *   *Headset?       any other glob, in a trie by the literal it starts with,
+ *                   or else ends with (reversed); globs with wildcards at
+ *                   both ends in a list
+ * A lookup walks the tries once (at most 12 steps for a MAC, two per name
+ * byte) and keeps the longest match. Globs are only tried when no prefix
+ * rule matched, and only those the glob tries (and the list) give for the
+ * string, most specific first (most literal characters, then alphabetical
+ * order), against the address and then the name.
+ * The plain `*` catch-all is not a rule, callers handle it as before.
+ */
+typedef struct _PinRules PinRules;
+
+/* TRUE for keys handled here rather than by exact lookup */
+gboolean pin_rules_is_pattern(const gchar *key);
+
+/*
+ * Builds the rules from the wildcard keys of pins (gchar * => gchar *).
+ * The PIN strings are not copied: pins must outlive the rules.
+ */
+PinRules *pin_rules_new(GHashTable *pins);
+void pin_rules_free(PinRules *rules);
+
+guint pin_rules_size(PinRules *rules);
+const gchar *pin_rules_lookup_address(PinRules *rules, const gchar *address);
+const gchar *pin_rules_lookup_name(PinRules *rules, const gchar *name);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __PIN_RULES_H */
@@ -0,0 +1,294 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "progress.h"
+
+/* Time constant of the speed average: about the last few seconds count */
+#define PROGRESS_EWMA_TAU 3.0
+/* Samples closer than this are merged, so bursts of signals do not swing the average */
+#define PROGRESS_MIN_SAMPLE (G_USEC_PER_SEC / 10)
+
+typedef struct {
+    gchar *key;
+    gchar *label;
+    guint64 total;
+    guint64 done;
+    /* Last sample the speed was computed from */
+    guint64 sample_done;
+    gint64 sample_time;
+    gdouble speed;          /* bytes/sec */
+    gint64 logged;          /* last log line, when not on a terminal */
+} ProgressEntry;
+
+struct _Progress {
+    gboolean tty;
+    guint interval;         /* msec between redraws */
+    GPtrArray *entries;     /* in start order, which is the order of the lines */
+    guint drawn;            /* lines currently on screen */
+    gboolean dirty;
+    guint timeout_id;
+    GPrintFunc saved_print;
+    GPrintFunc saved_printerr;
+};
+
+/* There is one terminal, so one renderer at a time takes over g_print() */
+static Progress *_progress_active = NULL;
+
+static void _entry_free(gpointer data)
+{
+    ProgressEntry *entry = data;
+    g_free(entry->key);
+    g_free(entry->label);
+    g_free(entry);
+}
+
+static ProgressEntry *_progress_find(Progress *progress, const gchar *key, guint *index)
+{
+    for (guint i = 0; i < progress->entries->len; i++)
+    {
+        ProgressEntry *entry = g_ptr_array_index(progress->entries, i);
+        if (g_strcmp0(entry->key, key) == 0)
+        {
+            if (index)
+                *index = i;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static gchar *_entry_format(const ProgressEntry *entry)
+{
+    GString *line = g_string_new(NULL);
+    gchar *done = g_format_size(entry->done);
+
+    g_string_append_printf(line, "[Transfer#%s] ", entry->label);
+    if (entry->total)
+    {
+        gchar *total = g_format_size(entry->total);
+        g_string_append_printf(line, "%3u%% %s/%s", (guint) (entry->done * 100 / entry->total), done, total);
+        g_free(total);
+    }
+    else
+        g_string_append(line, done);
+
+    if (entry->speed > 0)
+    {
+        gchar *speed = g_format_size((guint64) entry->speed);
+        g_string_append_printf(line, " %s/s", speed);
+        g_free(speed);
+
+        if (entry->total > entry->done)
+        {
+            guint64 eta = (entry->total - entry->done) / entry->speed + 0.5;
+            g_string_append_printf(line, " ETA %" G_GUINT64_FORMAT ":%02u", eta / 60, (guint) (eta % 60));
+        }
+    }
+
+    g_free(done);
+    return g_string_free(line, FALSE);
+}
+
+static void _progress_erase(Progress *progress)
+{
+    /* Up to the first line, then clear to the end of the screen */
+    if (progress->drawn > 0)
+        fprintf(stdout, "\r\033[%uA\033[J", progress->drawn);
+    progress->drawn = 0;
+}
+
+static void _progress_draw(Progress *progress)
+{
+    _progress_erase(progress);
+    for (guint i = 0; i < progress->entries->len; i++)
+    {
+        gchar *line = _entry_format(g_ptr_array_index(progress->entries, i));
+        fprintf(stdout, "%s\n", line);
+        g_free(line);
+    }
+    progress->drawn = progress->entries->len;
+    progress->dirty = FALSE;
+    fflush(stdout);
+}
+
+/* Other output goes above the progress lines */
+static void _progress_output(FILE *stream, const gchar *string)
+{
+    Progress *progress = _progress_active;
+
+    _progress_erase(progress);
+    fflush(stdout);
+    fputs(string, stream);
+    fflush(stream);
+    /* Lines stay away until the message is complete */
+    if (string[0] != '\0' && string[strlen(string) - 1] == '\n')
+        _progress_draw(progress);
+}
+
+static void _progress_print(const gchar *string)
+{
+    _progress_output(stdout, string);
+}
+
+static void _progress_printerr(const gchar *string)
+{
+    _progress_output(stderr, string);
+}
+
+static gboolean _progress_timeout(gpointer user_data)
+{
+    Progress *progress = user_data;
+
+    if (progress->dirty)
+        _progress_draw(progress);
+
+    if (progress->entries->len == 0)
+    {
+        progress->timeout_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+Progress *progress_new(guint rate)
+{
+    Progress *progress = g_new0(Progress, 1);
+    progress->tty = isatty(STDOUT_FILENO);
+    progress->interval = 1000 / MAX(rate, 1);
+    progress->entries = g_ptr_array_new_with_free_func(_entry_free);
+
+    if (progress->tty && !_progress_active)
+    {
+        _progress_active = progress;
+        progress->saved_print = g_set_print_handler(_progress_print);
+        progress->saved_printerr = g_set_printerr_handler(_progress_printerr);
+    }
+    else
+        progress->tty = FALSE;
+
+    return progress;
+}
+
+void progress_free(Progress *progress)
+{
+    if (!progress)
+        return;
+
+    if (progress->tty)
+    {
+        if (progress->dirty)
+            _progress_draw(progress);
+        g_set_print_handler(progress->saved_print);
+        g_set_printerr_handler(progress->saved_printerr);
+        _progress_active = NULL;
+    }
+    if (progress->timeout_id)
+        g_source_remove(progress->timeout_id);
+    g_ptr_array_unref(progress->entries);
+    g_free(progress);
+}
+
+void progress_start(Progress *progress, const gchar *key, const gchar *label, guint64 total)
+{
+    g_assert(progress != NULL && key != NULL);
+
+    if (_progress_find(progress, key, NULL))
+        return;
+
+    ProgressEntry *entry = g_new0(ProgressEntry, 1);
+    entry->key = g_strdup(key);
+    entry->label = g_strdup(label ? label : key);
+    entry->total = total;
+    entry->sample_time = g_get_monotonic_time();
+    entry->logged = entry->sample_time;
+    g_ptr_array_add(progress->entries, entry);
+
+    progress->dirty = TRUE;
+    if (progress->tty && !progress->timeout_id)
+        progress->timeout_id = g_timeout_add(progress->interval, _progress_timeout, progress);
+}
+
+void progress_update(Progress *progress, const gchar *key, guint64 done, guint64 total)
+{
+    g_assert(progress != NULL && key != NULL);
+
+    ProgressEntry *entry = _progress_find(progress, key, NULL);
+    if (!entry)
+        return;
+
+    gint64 now = g_get_monotonic_time();
+    gint64 elapsed = now - entry->sample_time;
+
+    if (total)
+        entry->total = total;
+    entry->done = done;
+
+    if (elapsed >= PROGRESS_MIN_SAMPLE && done >= entry->sample_done)
+    {
+        gdouble seconds = (gdouble) elapsed / G_USEC_PER_SEC;
+        gdouble speed = (done - entry->sample_done) / seconds;
+        /* Weight by elapsed time, so irregular signal spacing does not skew it */
+        gdouble alpha = seconds / (seconds + PROGRESS_EWMA_TAU);
+        entry->speed = entry->speed > 0 ? entry->speed + alpha * (speed - entry->speed) : speed;
+        entry->sample_done = done;
+        entry->sample_time = now;
+    }
+
+    if (progress->tty)
+        progress->dirty = TRUE;
+    else if (now - entry->logged >= PROGRESS_LOG_INTERVAL * G_USEC_PER_SEC)
+    {
+        gchar *line = _entry_format(entry);
+        g_print("%s\n", line);
+        g_free(line);
+        entry->logged = now;
+    }
+}
+
+void progress_stop(Progress *progress, const gchar *key, const gchar *message)
+{
+    g_assert(progress != NULL && key != NULL);
+
+    guint index = 0;
+    if (_progress_find(progress, key, &index))
+    {
+        g_ptr_array_remove_index(progress->entries, index);
+        progress->dirty = TRUE;
+    }
+
+    /* Through g_print(), which redraws the remaining lines below it */
+    if (message)
+        g_print("%s\n", message);
+    else if (progress->tty && progress->dirty)
+        _progress_draw(progress);
+}
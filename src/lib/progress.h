@@ -0,0 +1,58 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __PROGRESS_H
+#define __PROGRESS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+/*
+ * Progress of concurrent transfers. On a terminal every transfer has its
+ * own line, redrawn in place at most `rate` times a second; g_print()
+ * output in between is written above them. Otherwise each transfer gets
+ * a log line every PROGRESS_LOG_INTERVAL seconds. Speed is an
+ * exponentially weighted moving average, the ETA is derived from it.
+ */
+#define PROGRESS_DEFAULT_RATE 4          /* redraws per second */
+#define PROGRESS_LOG_INTERVAL 5          /* sec, when not on a terminal */
+
+typedef struct _Progress Progress;
+
+Progress *progress_new(guint rate);
+void progress_free(Progress *progress);
+
+/* `key` identifies the transfer, `label` is shown; `total` may be 0 if unknown */
+void progress_start(Progress *progress, const gchar *key, const gchar *label, guint64 total);
+void progress_update(Progress *progress, const gchar *key, guint64 done, guint64 total);
+/* Removes the transfer's line; `message` (may be NULL) is printed in its place */
+void progress_stop(Progress *progress, const gchar *key, const gchar *message);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __PROGRESS_H */
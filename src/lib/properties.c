@@ -208,12 +208,12 @@ static void _properties_create_gdbus_proxy(Properties *self, GError **error)
         if(g_ascii_strcasecmp(g_ascii_strdown(self->priv->dbus_type, -1), "system") == 0)
         {
             g_assert(system_conn != NULL);
-            self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, self->priv->dbus_service_name, self->priv->dbus_object_path, PROPERTIES_DBUS_INTERFACE, NULL, error);
+            self->priv->proxy = g_dbus_proxy_new_sync(system_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, self->priv->dbus_service_name, self->priv->dbus_object_path, PROPERTIES_DBUS_INTERFACE, dbus_call_cancellable(), error);
         }
         else if(g_ascii_strcasecmp(g_ascii_strdown(self->priv->dbus_type, -1), "session") == 0)
         {
             g_assert(session_conn != NULL);
-            self->priv->proxy = g_dbus_proxy_new_sync(session_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, self->priv->dbus_service_name, self->priv->dbus_object_path, PROPERTIES_DBUS_INTERFACE, NULL, error);
+            self->priv->proxy = g_dbus_proxy_new_sync(session_conn, G_DBUS_PROXY_FLAGS_NONE, NULL, self->priv->dbus_service_name, self->priv->dbus_object_path, PROPERTIES_DBUS_INTERFACE, dbus_call_cancellable(), error);
         }
         else
             g_error("Invalid DBus connection type: %s", self->priv->dbus_type);
@@ -244,7 +244,7 @@ const gchar *properties_get_dbus_object_path(Properties *self)
 GVariant *properties_get(Properties *self, const gchar *interface_name, const gchar *property_name, GError **error)
 {
     g_assert(PROPERTIES_IS(self));
-    GVariant *retVal = g_dbus_proxy_call_sync(self->priv->proxy, "Get", g_variant_new("(ss)", interface_name, property_name), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+    GVariant *retVal = g_dbus_proxy_call_sync(self->priv->proxy, "Get", g_variant_new("(ss)", interface_name, property_name), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
     if (retVal == NULL)
         return NULL;
     retVal = g_variant_get_child_value(retVal, 0);
@@ -255,13 +255,13 @@ GVariant *properties_get(Properties *self, const gchar *interface_name, const gc
 void properties_set(Properties *self, const gchar *interface_name, const gchar *property_name, const GVariant *value, GError **error)
 {
     g_assert(PROPERTIES_IS(self));
-    g_dbus_proxy_call_sync(self->priv->proxy, "Set", g_variant_new("(ssv)", interface_name, property_name, value), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+    g_dbus_proxy_call_sync(self->priv->proxy, "Set", g_variant_new("(ssv)", interface_name, property_name, value), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
 }
 
 GVariant *properties_get_all(Properties *self, const gchar *interface_name, GError **error)
 {
     g_assert(PROPERTIES_IS(self));
-    GVariant *retVal = g_dbus_proxy_call_sync(self->priv->proxy, "GetAll", g_variant_new("(s)", interface_name), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+    GVariant *retVal = g_dbus_proxy_call_sync(self->priv->proxy, "GetAll", g_variant_new("(s)", interface_name), G_DBUS_CALL_FLAGS_NONE, dbus_call_timeout(), dbus_call_cancellable(), error);
     if (retVal == NULL)
         return NULL;
     retVal = g_variant_get_child_value(retVal, 0);
@@ -0,0 +1,160 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "dbus-common.h"
+#include "retry.h"
+
+struct _RetryState {
+    RetryPolicy policy;
+    guint attempt;
+    gint64 started;
+};
+
+/* BlueZ errors that mean "not now" rather than "no" */
+static const gchar *transient_errors[] = {
+    "org.bluez.Error.InProgress",
+    "org.bluez.Error.NotReady",
+    "org.bluez.Error.ConnectionAttemptFailed",
+    NULL
+};
+
+/* org.bluez.Error.Failed (org.bluez.obex.Error.Failed from obexd) messages coming from the kernel/controller */
+static const gchar *transient_messages[] = {
+    "Page Timeout",
+    "page-timeout",
+    "Host is down",
+    "Operation already in progress",
+    "Resource temporarily unavailable",
+    "Device or resource busy",
+    "Software caused connection abort",
+    "Connection timed out",
+    NULL
+};
+
+gboolean retry_error_is_transient(const GError *error)
+{
+    if (error == NULL)
+        return FALSE;
+
+    /* A call that ran out of time used up what --timeout allowed: trying again would multiply it */
+    if (error->domain != G_DBUS_ERROR || !g_dbus_error_is_remote_error(error))
+        return FALSE;
+
+    gchar *name = g_dbus_error_get_remote_error(error);
+    gboolean transient = FALSE;
+
+    for (int i = 0; name && transient_errors[i] != NULL && !transient; i++)
+        transient = g_strcmp0(name, transient_errors[i]) == 0;
+
+    if (!transient && (g_strcmp0(name, "org.bluez.Error.Failed") == 0 || g_strcmp0(name, "org.bluez.obex.Error.Failed") == 0))
+    {
+        for (int i = 0; transient_messages[i] != NULL && !transient; i++)
+            transient = strstr(error->message, transient_messages[i]) != NULL;
+    }
+
+    g_free(name);
+    return transient;
+}
+
+RetryState *retry_state_new(const RetryPolicy *policy)
+{
+    g_assert(policy != NULL);
+
+    RetryState *state = g_new0(RetryState, 1);
+    state->policy = *policy;
+    state->attempt = 1;
+    state->started = g_get_monotonic_time();
+    return state;
+}
+
+void retry_state_free(RetryState *state)
+{
+    g_free(state);
+}
+
+gboolean retry_state_next(RetryState *state, const GError *error, guint *delay)
+{
+    g_assert(state != NULL && delay != NULL);
+
+    if (!retry_error_is_transient(error))
+        return FALSE;
+
+    return retry_state_next_any(state, delay);
+}
+
+gboolean retry_state_next_any(RetryState *state, guint *delay)
+{
+    g_assert(state != NULL && delay != NULL);
+
+    if (state->attempt >= state->policy.max_attempts)
+        return FALSE;
+
+    gdouble full = state->policy.initial_delay;
+    for (guint i = 1; i < state->attempt && full < state->policy.max_delay; i++)
+        full *= state->policy.multiplier;
+    if (full > state->policy.max_delay)
+        full = state->policy.max_delay;
+
+    /* Equal jitter: at least half the backoff, never more than all of it */
+    guint half = (guint) full / 2;
+    *delay = half + g_random_int_range(0, (gint) ((guint) full - half) + 1);
+
+    gint64 next = g_get_monotonic_time() + (gint64) *delay * 1000;
+    if (state->policy.budget > 0 && next >= state->started + (gint64) state->policy.budget * 1000)
+        return FALSE;
+    if (dbus_call_deadline() > 0 && next >= dbus_call_deadline())
+        return FALSE;
+
+    state->attempt++;
+    return TRUE;
+}
+
+gboolean retry_run(const RetryPolicy *policy, RetryFunc func, gpointer user_data, GError **error)
+{
+    RetryState *state = retry_state_new(policy);
+    GError *attempt_error = NULL;
+    gboolean ok;
+    guint delay = 0;
+
+    while (!(ok = func(user_data, &attempt_error)) && retry_state_next(state, attempt_error, &delay))
+    {
+        g_printerr("%s, retrying in %u ms\n", attempt_error->message, delay);
+        g_clear_error(&attempt_error);
+        g_usleep((gulong) delay * 1000);
+    }
+
+    if (!ok)
+        g_propagate_error(error, attempt_error);
+
+    retry_state_free(state);
+    return ok;
+}
@@ -0,0 +1,80 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __RETRY_H
+#define __RETRY_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+/*
+ * Retry policy for BlueZ calls that fail for reasons which go away on their
+ * own (busy controller, page timeout, another operation in progress).
+ * Delays grow exponentially from initial_delay up to max_delay, each one
+ * randomised between half and the full value so that several clients do
+ * not retry in lockstep.
+ */
+typedef struct {
+    guint max_attempts;     /* including the first one, 1 disables retrying */
+    guint initial_delay;    /* msec */
+    guint max_delay;        /* msec */
+    gdouble multiplier;
+    guint budget;           /* msec for all attempts together, 0 for no limit */
+} RetryPolicy;
+
+/*
+ * Retrying is opt-in (--retries); the attempts also stop at the call
+ * deadline (see dbus_set_call_deadline()) when one is set, so a bounded
+ * command stays bounded.
+ */
+#define RETRY_DEFAULT_ATTEMPTS 3
+#define RETRY_POLICY_DEFAULT {RETRY_DEFAULT_ATTEMPTS, 250, 4000, 2.0, 0}
+
+typedef struct _RetryState RetryState;
+
+/* TRUE for errors worth another attempt; our own call timing out is not one */
+gboolean retry_error_is_transient(const GError *error);
+
+/* Tracks attempts and elapsed time of one operation */
+RetryState *retry_state_new(const RetryPolicy *policy);
+void retry_state_free(RetryState *state);
+/*
+ * Called after a failed attempt: returns TRUE and the delay to wait before
+ * the next one, or FALSE when the error is permanent or the budget is spent.
+ */
+gboolean retry_state_next(RetryState *state, const GError *error, guint *delay);
+/* The same for failures known to be worth another attempt, without a GError to judge by */
+gboolean retry_state_next_any(RetryState *state, guint *delay);
+
+/* Runs func until it succeeds or retry_state_next() gives up */
+typedef gboolean (*RetryFunc)(gpointer user_data, GError **error);
+gboolean retry_run(const RetryPolicy *policy, RetryFunc func, gpointer user_data, GError **error);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __RETRY_H */
@@ -0,0 +1,433 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "dbus-common.h"
+#include "helpers.h"
+#include "bluez-api.h"
+#include "transfer-manager.h"
+
+typedef struct {
+    gchar *path;
+    gchar *address;
+    gchar *device;      /* "dev_AA_BB_CC_DD_EE_FF", the last element of the device's path */
+    gboolean watched;   /* discovery asked for on its adapter */
+    gboolean weak;      /* RSSI below the threshold */
+    gint64 rssi_time;   /* of the last RSSI report while weak */
+} ManagedSession;
+
+typedef struct {
+    ManagedSession *session;
+    ObexTransfer *transfer;     /* made when first needed */
+    gboolean active;            /* past queued: obexd only suspends transfers in progress */
+    gboolean suspended;
+    gboolean refused;           /* obexd would not suspend or resume it, left alone */
+} ManagedTransfer;
+
+struct _TransferManager {
+    GHashTable *sessions;       /* path -> ManagedSession */
+    GHashTable *transfers;      /* path -> ManagedTransfer */
+    gboolean held;
+    gint threshold;
+    GHashTable *discovering;    /* adapter path -> Adapter, discoveries we started */
+    guint stale_id;
+    guint added_id;
+    guint properties_id;
+    guint removed_id;
+    guint rssi_id;
+};
+
+static void _session_free(ManagedSession *session)
+{
+    g_free(session->path);
+    g_free(session->address);
+    g_free(session->device);
+    g_free(session);
+}
+
+static void _transfer_free(ManagedTransfer *transfer)
+{
+    if (transfer->transfer)
+        g_object_unref(transfer->transfer);
+    g_free(transfer);
+}
+
+static ManagedSession *_session_of(TransferManager *manager, const gchar *transfer_path)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init(&iter, manager->sessions);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        gsize len = strlen(key);
+        if (strncmp(transfer_path, key, len) == 0 && transfer_path[len] == '/')
+            return value;
+    }
+    return NULL;
+}
+
+/* Suspends or resumes the transfer as the user and the link want it */
+static void _apply(TransferManager *manager, const gchar *transfer_path, ManagedTransfer *transfer)
+{
+    gboolean hold = manager->held || transfer->session->weak;
+    if (!transfer->active || transfer->refused || hold == transfer->suspended)
+        return;
+
+    GError *error = NULL;
+    if (!transfer->transfer)
+        transfer->transfer = obex_transfer_new(transfer_path);
+    if (hold)
+        obex_transfer_suspend(transfer->transfer, &error);
+    else
+        obex_transfer_resume(transfer->transfer, &error);
+
+    if (error)
+    {
+        g_printerr("%s: can not %s: %s\n", transfer_path, hold ? "suspend" : "resume", error->message);
+        g_error_free(error);
+        transfer->refused = TRUE;
+        return;
+    }
+    transfer->suspended = hold;
+}
+
+static void _apply_all(TransferManager *manager)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+
+    /* Sync calls dispatch no signals, so the table stays as it is meanwhile */
+    g_hash_table_iter_init(&iter, manager->transfers);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        _apply(manager, key, value);
+}
+
+static void _track(TransferManager *manager, const gchar *transfer_path, const gchar *status)
+{
+    if (g_strcmp0(status, "complete") == 0 || g_strcmp0(status, "error") == 0)
+    {
+        g_hash_table_remove(manager->transfers, transfer_path);
+        return;
+    }
+
+    ManagedTransfer *transfer = g_hash_table_lookup(manager->transfers, transfer_path);
+    if (!transfer)
+    {
+        ManagedSession *session = _session_of(manager, transfer_path);
+        if (!session)
+            return;
+        transfer = g_new0(ManagedTransfer, 1);
+        transfer->session = session;
+        g_hash_table_insert(manager->transfers, g_strdup(transfer_path), transfer);
+    }
+
+    if (g_strcmp0(status, "active") == 0)
+    {
+        transfer->active = TRUE;
+        transfer->suspended = FALSE;
+    }
+    else if (g_strcmp0(status, "suspended") == 0)
+    {
+        transfer->active = TRUE;
+        transfer->suspended = TRUE;
+    }
+    _apply(manager, transfer_path, transfer);
+}
+
+static void _interfaces_added(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    const gchar *transfer_path = NULL;
+    GVariant *interfaces = NULL;
+    GVariant *properties = NULL;
+    const gchar *status = "queued";
+
+    g_variant_get(parameters, "(&o@a{sa{sv}})", &transfer_path, &interfaces);
+    if (g_variant_lookup(interfaces, OBEX_TRANSFER_DBUS_INTERFACE, "@a{sv}", &properties))
+    {
+        g_variant_lookup(properties, "Status", "&s", &status);
+        _track(user_data, transfer_path, status);
+        g_variant_unref(properties);
+    }
+    g_variant_unref(interfaces);
+}
+
+static void _properties_changed(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    GVariant *changed = g_variant_get_child_value(parameters, 1);
+    const gchar *status = NULL;
+
+    if (g_variant_lookup(changed, "Status", "&s", &status))
+        _track(user_data, object_path, status);
+    g_variant_unref(changed);
+}
+
+static void _interfaces_removed(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    TransferManager *manager = user_data;
+    const gchar *transfer_path = NULL;
+
+    g_variant_get(parameters, "(&o@as)", &transfer_path, NULL);
+    g_hash_table_remove(manager->transfers, transfer_path);
+}
+
+static void _rssi_changed(GDBusConnection *connection, const gchar *sender_name, const gchar *object_path, const gchar *interface_name, const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+    TransferManager *manager = user_data;
+    GVariant *changed = g_variant_get_child_value(parameters, 1);
+    gint16 rssi = 0;
+
+    if (manager->threshold != 0 && g_variant_lookup(changed, "RSSI", "n", &rssi))
+    {
+        const gchar *device = strrchr(object_path, '/') + 1;
+        gboolean any = FALSE;
+        GHashTableIter iter;
+        gpointer value;
+
+        g_hash_table_iter_init(&iter, manager->sessions);
+        while (g_hash_table_iter_next(&iter, NULL, &value))
+        {
+            ManagedSession *session = value;
+            if (g_strcmp0(session->device, device) != 0)
+                continue;
+
+            /* Not resumed until clearly better, so a link on the edge does not flap */
+            gboolean weak = rssi < manager->threshold + (session->weak ? TRANSFER_MANAGER_HYSTERESIS : 0);
+            session->rssi_time = g_get_monotonic_time();
+            if (weak == session->weak)
+                continue;
+
+            session->weak = weak;
+            g_print("%s: link %s (%d dBm), %s transfers\n", session->address, weak ? "weak" : "recovered", rssi, weak ? "suspending" : "resuming");
+            any = TRUE;
+        }
+        if (any)
+            _apply_all(manager);
+    }
+    g_variant_unref(changed);
+}
+
+/*
+ * Reports stop when discovery does (someone else stopped it, or the device
+ * no longer answers): don't hold transfers on a reading that old.
+ */
+static gboolean _rssi_stale(gpointer user_data)
+{
+    TransferManager *manager = user_data;
+    gint64 now = g_get_monotonic_time();
+    gboolean any = FALSE;
+    GHashTableIter iter;
+    gpointer value;
+
+    g_hash_table_iter_init(&iter, manager->sessions);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+        ManagedSession *session = value;
+        if (!session->weak || now - session->rssi_time < (gint64) TRANSFER_MANAGER_RSSI_STALE * G_USEC_PER_SEC)
+            continue;
+
+        session->weak = FALSE;
+        g_print("%s: no RSSI for %d sec, resuming transfers\n", session->address, TRANSFER_MANAGER_RSSI_STALE);
+        any = TRUE;
+    }
+    if (any)
+        _apply_all(manager);
+
+    return G_SOURCE_CONTINUE;
+}
+
+/* BlueZ only reports the RSSI while discovering: make sure the session's adapter is */
+static void _watch_link(TransferManager *manager, ManagedSession *session)
+{
+    if (session->watched || !system_conn)
+        return;
+    session->watched = TRUE;
+
+    GError *error = NULL;
+    ObexSession *obex_session = obex_session_new(session->path);
+    const gchar *source = obex_session_get_source(obex_session, &error);
+    Adapter *adapter = source ? find_adapter(source, &error) : NULL;
+    g_object_unref(obex_session);
+
+    if (adapter && !g_hash_table_contains(manager->discovering, adapter_get_dbus_object_path(adapter)))
+    {
+        adapter_start_discovery(adapter, &error);
+        if (!error)
+        {
+            g_hash_table_insert(manager->discovering, g_strdup(adapter_get_dbus_object_path(adapter)), adapter);
+            adapter = NULL;
+        }
+    }
+
+    if (error)
+    {
+        g_printerr("%s: can not discover, the RSSI may not be reported: %s\n", session->address, error->message);
+        g_error_free(error);
+    }
+    if (adapter)
+        g_object_unref(adapter);
+}
+
+static void _unwatch_links(TransferManager *manager)
+{
+    GHashTableIter iter;
+    gpointer value;
+
+    g_hash_table_iter_init(&iter, manager->discovering);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+        /* Nothing more to do if it stopped already */
+        adapter_stop_discovery(value, NULL);
+    }
+    g_hash_table_remove_all(manager->discovering);
+
+    g_hash_table_iter_init(&iter, manager->sessions);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+        ((ManagedSession *) value)->watched = FALSE;
+}
+
+TransferManager *transfer_manager_new()
+{
+    g_assert(session_conn != NULL);
+
+    TransferManager *manager = g_new0(TransferManager, 1);
+    manager->sessions = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) _session_free);
+    manager->transfers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) _transfer_free);
+    manager->discovering = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+
+    manager->added_id = g_dbus_connection_signal_subscribe(session_conn, BLUEZ_OBEX_DBUS_SERVICE_NAME, "org.freedesktop.DBus.ObjectManager", "InterfacesAdded", NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, _interfaces_added, manager, NULL);
+    manager->properties_id = g_dbus_connection_signal_subscribe(session_conn, BLUEZ_OBEX_DBUS_SERVICE_NAME, "org.freedesktop.DBus.Properties", "PropertiesChanged", NULL, OBEX_TRANSFER_DBUS_INTERFACE, G_DBUS_SIGNAL_FLAGS_NONE, _properties_changed, manager, NULL);
+    manager->removed_id = g_dbus_connection_signal_subscribe(session_conn, BLUEZ_OBEX_DBUS_SERVICE_NAME, "org.freedesktop.DBus.ObjectManager", "InterfacesRemoved", NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE, _interfaces_removed, manager, NULL);
+
+    return manager;
+}
+
+void transfer_manager_free(TransferManager *manager)
+{
+    if (!manager)
+        return;
+
+    g_dbus_connection_signal_unsubscribe(session_conn, manager->added_id);
+    g_dbus_connection_signal_unsubscribe(session_conn, manager->properties_id);
+    g_dbus_connection_signal_unsubscribe(session_conn, manager->removed_id);
+    if (manager->rssi_id)
+        g_dbus_connection_signal_unsubscribe(system_conn, manager->rssi_id);
+    if (manager->stale_id)
+        g_source_remove(manager->stale_id);
+    _unwatch_links(manager);
+
+    g_hash_table_unref(manager->discovering);
+    g_hash_table_unref(manager->transfers);
+    g_hash_table_unref(manager->sessions);
+    g_free(manager);
+}
+
+void transfer_manager_add_session(TransferManager *manager, const gchar *session_path, const gchar *address)
+{
+    g_assert(manager != NULL && session_path != NULL && address != NULL);
+
+    ManagedSession *session = g_new0(ManagedSession, 1);
+    session->path = g_strdup(session_path);
+    session->address = g_ascii_strup(address, -1);
+    session->device = g_strconcat("dev_", session->address, NULL);
+    g_strdelimit(session->device, ":", '_');
+    g_hash_table_insert(manager->sessions, g_strdup(session_path), session);
+
+    if (manager->threshold != 0)
+        _watch_link(manager, session);
+}
+
+void transfer_manager_remove_session(TransferManager *manager, const gchar *session_path)
+{
+    g_assert(manager != NULL && session_path != NULL);
+
+    ManagedSession *session = g_hash_table_lookup(manager->sessions, session_path);
+    if (!session)
+        return;
+
+    /* Its transfers go with it */
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, manager->transfers);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+        if (((ManagedTransfer *) value)->session == session)
+            g_hash_table_iter_remove(&iter);
+    }
+    g_hash_table_remove(manager->sessions, session_path);
+}
+
+void transfer_manager_suspend(TransferManager *manager)
+{
+    g_assert(manager != NULL);
+    manager->held = TRUE;
+    _apply_all(manager);
+}
+
+void transfer_manager_resume(TransferManager *manager)
+{
+    g_assert(manager != NULL);
+    manager->held = FALSE;
+    _apply_all(manager);
+}
+
+void transfer_manager_set_rssi_threshold(TransferManager *manager, gint threshold)
+{
+    g_assert(manager != NULL);
+
+    manager->threshold = threshold;
+    if (threshold != 0 && !manager->rssi_id && system_conn)
+        manager->rssi_id = g_dbus_connection_signal_subscribe(system_conn, BLUEZ_DBUS_SERVICE_NAME, "org.freedesktop.DBus.Properties", "PropertiesChanged", NULL, DEVICE_DBUS_INTERFACE, G_DBUS_SIGNAL_FLAGS_NONE, _rssi_changed, manager, NULL);
+
+    GHashTableIter iter;
+    gpointer value;
+
+    if (threshold != 0)
+    {
+        if (!manager->stale_id)
+            manager->stale_id = g_timeout_add_seconds(1, _rssi_stale, manager);
+        g_hash_table_iter_init(&iter, manager->sessions);
+        while (g_hash_table_iter_next(&iter, NULL, &value))
+            _watch_link(manager, value);
+    }
+    else
+    {
+        if (manager->stale_id)
+            g_source_remove(manager->stale_id);
+        manager->stale_id = 0;
+        _unwatch_links(manager);
+
+        g_hash_table_iter_init(&iter, manager->sessions);
+        while (g_hash_table_iter_next(&iter, NULL, &value))
+            ((ManagedSession *) value)->weak = FALSE;
+        _apply_all(manager);
+    }
+}
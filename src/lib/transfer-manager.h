@@ -0,0 +1,72 @@
+/*
+ *
+ *  bluez-tools - a set of tools to manage bluetooth devices for linux
+ *
+ *  Copyright (C) 2010  Alexander Orlenko <zxteam@gmail.com>
+ *
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __TRANSFER_MANAGER_H
+#define __TRANSFER_MANAGER_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+/*
+ * Suspends and resumes the transfers of our own obexd client sessions,
+ * on demand or while the link to the device is poor. Transfers are found
+ * from obexd's signals: a transfer belongs to a session when its object
+ * path is below the session's. A suspended transfer carries on where it
+ * stopped when resumed, as long as the device keeps the session up; if it
+ * drops it, the transfer fails like any interrupted one. Transfers that
+ * obexd refuses to suspend are left running.
+ *
+ * The link is judged by the RSSI BlueZ reports for the device, which it
+ * only does while discovering (or for advertising LE devices), so the
+ * adapters of the sessions are kept discovering meanwhile: below the
+ * threshold transfers are suspended, and resumed once the RSSI is
+ * TRANSFER_MANAGER_HYSTERESIS dB above it, or once no report came for
+ * TRANSFER_MANAGER_RSSI_STALE seconds.
+ */
+#define TRANSFER_MANAGER_HYSTERESIS 6
+#define TRANSFER_MANAGER_RSSI_STALE 30
+
+typedef struct _TransferManager TransferManager;
+
+TransferManager *transfer_manager_new();
+void transfer_manager_free(TransferManager *manager);
+
+/* Manages the transfers of `session_path`, a session with the device at `address` */
+void transfer_manager_add_session(TransferManager *manager, const gchar *session_path, const gchar *address);
+void transfer_manager_remove_session(TransferManager *manager, const gchar *session_path);
+
+/* Keeps every transfer suspended, whatever the link, until transfer_manager_resume() */
+void transfer_manager_suspend(TransferManager *manager);
+void transfer_manager_resume(TransferManager *manager);
+
+/* In dBm, 0 to not watch the link (and stop the discoveries started for it) */
+void transfer_manager_set_rssi_threshold(TransferManager *manager, gint threshold);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* __TRANSFER_MANAGER_H */